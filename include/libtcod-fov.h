@@ -36,11 +36,17 @@
 #include "libtcod-fov/bresenham.h"
 #include "libtcod-fov/error.h"
 #include "libtcod-fov/fov.h"
+#include "libtcod-fov/fov_cache.h"
+#include "libtcod-fov/fov_resumable.h"
+#include "libtcod-fov/fov_tracker.h"
 #include "libtcod-fov/fov_triage.h"
 #include "libtcod-fov/logging.h"
 #include "libtcod-fov/map_inline.h"
 #include "libtcod-fov/map_types.h"
+#include "libtcod-fov/thread_pool.h"
 #include "libtcod-fov/version.h"
+#include "libtcod-fov/visibility.h"
+#include "libtcod-fov/workspace.h"
 
 #ifdef __cplusplus
 #include "libtcod-fov/bresenham.hpp"
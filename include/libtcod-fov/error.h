@@ -85,6 +85,9 @@ extern "C" {
 /***************************************************************************
     @brief Return the last error message.  If there is no error then the string will have a length of zero.
 
+    Error messages are stored separately for each thread, so this is the last error of the calling thread.
+    Errors from the tasks of a thread pool are reported to the thread which started them.
+
     \rst
     .. versionadded:: 1.12
     \endrst
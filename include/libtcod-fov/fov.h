@@ -85,6 +85,9 @@ TCODFOV_PUBLIC void TCODFOV_map_delete(TCODFOV_Map* map);
     After this call you may check if a cell is within the field-of-view by
     calling :any:`TCODFOV_map_is_in_fov`.
 
+    This writes to `map`, so one map can't be shared by threads computing different points-of-view.
+    Use :any:`TCODFOV_map_compute_fov_into` to write to a separate output instead.
+
     Returns an error code on failure.  See :any:`TCODFOV_get_error` for details.
     \endrst
  */
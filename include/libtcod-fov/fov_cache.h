@@ -0,0 +1,138 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_FOV_CACHE_H_
+#define TCODFOV_FOV_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef __cplusplus
+#include <memory>
+#endif  // __cplusplus
+#include "config.h"
+#include "error.h"
+#include "fov_types.h"
+#include "map_types.h"
+#include "workspace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+    A least-recently-used cache of field-of-view results for one map.
+
+    \rst
+    Results are keyed on the point-of-view, radius, algorithm, and `light_walls`.  Viewers which stand still compute
+    the same query over and over, and only the first one is computed while the map around them stays the same.
+
+    The cache does not watch the map.  Pass the tiles which changed transparency to
+    :any:`TCODFOV_fov_cache_mark_changed`, which removes exactly the results whose radius covers one of those tiles.
+    A field-of-view never depends on tiles outside of its radius, so every other result stays valid.
+
+    Each result is stored as run lengths of its area within the radius, or as bits when those would be smaller.
+    The least recently used results are evicted to keep the memory used within the limit given to
+    :any:`TCODFOV_fov_cache_new`.
+
+    A cache must not be used by more than one thread at a time.
+    \endrst
+ */
+typedef struct TCODFOV_FovCache TCODFOV_FovCache;
+/**
+    Counters of a field-of-view cache.
+ */
+typedef struct TCODFOV_FovCacheStats {
+  int64_t hits;  // Queries which were copied from a stored result.
+  int64_t misses;  // Queries which were computed.
+  int64_t evictions;  // Results removed to stay within the memory limit.
+  int64_t invalidations;  // Results removed by `TCODFOV_fov_cache_mark_changed`.
+  int count;  // Number of stored results.
+  size_t bytes;  // Memory used by the stored results, including their bookkeeping.
+} TCODFOV_FovCacheStats;
+/**
+    Return a new empty cache for maps of `width` by `height` tiles, or NULL on failure.
+
+    Stored results are evicted to keep them within `max_bytes`.  A result larger than `max_bytes` is never stored.
+ */
+TCODFOV_PUBLIC TCODFOV_FovCache* TCODFOV_fov_cache_new(int width, int height, size_t max_bytes);
+/**
+    Free a cache.  Does nothing if `cache` is NULL.
+ */
+TCODFOV_PUBLIC void TCODFOV_fov_cache_delete(TCODFOV_FovCache* cache);
+/**
+    Compute the field-of-view of `transparent` into `fov`, or copy it from a stored result.
+
+    \rst
+    The parameters are the same as :any:`TCODFOV_map_compute_fov_2d`.  Both maps must be the size of the cache.
+    Unlike that function the `dirty` area is always overwritten: afterwards it holds exactly the field-of-view and
+    tiles outside of it are left as they were.
+
+    On a miss the result is computed and then stored, evicting older results if needed.
+    If there is no memory to store it then the computed result is still returned and is left uncached.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_fov_cache_compute(
+    TCODFOV_FovCache* __restrict cache,
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_Workspace* __restrict workspace,
+    TCODFOV_Rect* __restrict dirty);
+/**
+    Remove the stored results which could see any of the `count` tiles in `points`.
+
+    Call this after changing the transparency of those tiles.  All tiles are checked before any results are removed.
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_fov_cache_mark_changed(
+    TCODFOV_FovCache* __restrict cache, int count, const TCODFOV_Point* __restrict points);
+/**
+    Remove every stored result, for example after the whole map was replaced.  Does nothing if `cache` is NULL.
+ */
+TCODFOV_PUBLIC void TCODFOV_fov_cache_clear(TCODFOV_FovCache* cache);
+/**
+    Return the counters of `cache`, or all zeros if `cache` is NULL.
+ */
+TCODFOV_PUBLIC TCODFOV_FovCacheStats TCODFOV_fov_cache_get_stats(const TCODFOV_FovCache* cache);
+#ifdef __cplusplus
+}  // extern "C"
+namespace tcod::fov {
+struct FovCacheDeleter_ {
+  void operator()(TCODFOV_FovCache* cache) const { TCODFOV_fov_cache_delete(cache); }
+};
+typedef std::unique_ptr<TCODFOV_FovCache, FovCacheDeleter_> FovCachePtr_;
+}  // namespace tcod::fov
+#endif  // __cplusplus
+#endif  // TCODFOV_FOV_CACHE_H_
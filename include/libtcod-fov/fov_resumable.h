@@ -0,0 +1,100 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_FOV_RESUMABLE_H_
+#define TCODFOV_FOV_RESUMABLE_H_
+
+#include <stdbool.h>
+#ifdef __cplusplus
+#include <memory>
+#endif  // __cplusplus
+#include "config.h"
+#include "error.h"
+#include "map_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+    A recursive shadowcasting field-of-view which is computed a few rows at a time.
+
+    \rst
+    This gives the same results as :any:`TCODFOV_map_compute_fov_recursive_shadowcasting`, but the work is split into
+    steps of a limited number of rows.  Each row is one distance of one view of an octant, so a step never marks more
+    than `max_rows` times the radius in tiles.  Views which are still pending between steps are kept on a stack owned
+    by the job, so a large field-of-view can be spread over many frames.
+
+    Like :any:`TCODFOV_map_compute_fov_2d` the output map is not cleared.  Both maps are read and written by each
+    step, so they must stay alive and must not be resized or edited until the job is done.
+
+    A job must not be used by more than one thread at a time.
+    \endrst
+ */
+typedef struct TCODFOV_ResumableFov TCODFOV_ResumableFov;
+/**
+    Return a new job computing the field-of-view of `transparent` into `fov`, or NULL on failure.
+
+    No tiles are marked until the first step.
+ */
+TCODFOV_PUBLIC TCODFOV_ResumableFov* TCODFOV_resumable_fov_new(
+    const TCODFOV_Map2D* transparent, TCODFOV_Map2D* fov, int pov_x, int pov_y, int max_radius, bool light_walls);
+/**
+    Free a job.  Does nothing if `job` is NULL.
+
+    A job may be freed before it is done, which leaves its output map partly computed.
+ */
+TCODFOV_PUBLIC void TCODFOV_resumable_fov_delete(TCODFOV_ResumableFov* job);
+/**
+    Cast at most `max_rows` more rows of `job`.
+
+    \rst
+    Use :any:`TCODFOV_resumable_fov_is_done` to check if the field-of-view is complete.  Steps after that do nothing.
+    `max_rows` must be at least 1.
+
+    On failure the output map is incomplete and the job can only be deleted.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_resumable_fov_step(TCODFOV_ResumableFov* job, int max_rows);
+/**
+    Return true if every row of `job` has been cast and its output map holds the whole field-of-view.
+ */
+TCODFOV_PUBLIC bool TCODFOV_resumable_fov_is_done(const TCODFOV_ResumableFov* job);
+#ifdef __cplusplus
+}  // extern "C"
+namespace tcod::fov {
+struct ResumableFovDeleter_ {
+  void operator()(TCODFOV_ResumableFov* job) const { TCODFOV_resumable_fov_delete(job); }
+};
+typedef std::unique_ptr<TCODFOV_ResumableFov, ResumableFovDeleter_> ResumableFovPtr_;
+}  // namespace tcod::fov
+#endif  // __cplusplus
+#endif  // TCODFOV_FOV_RESUMABLE_H_
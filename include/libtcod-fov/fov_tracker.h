@@ -0,0 +1,118 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_FOV_TRACKER_H_
+#define TCODFOV_FOV_TRACKER_H_
+
+#include <stdbool.h>
+#ifdef __cplusplus
+#include <memory>
+#endif  // __cplusplus
+#include "config.h"
+#include "error.h"
+#include "fov_types.h"
+#include "map_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+    The field-of-view of one moving point-of-view, and the tiles which entered or left it on the last move.
+
+    \rst
+    A tracker keeps the results of its last point-of-view.  Each update only clears and compares the area which
+    either result could cover, so the cost of an update depends on the radius instead of the size of the map.
+    This makes it cheap to follow a viewer which moves one tile at a time and to react to the tiles which came into
+    or went out of view.
+
+    :any:`TCODFOV_SYMMETRIC_SHADOWCAST` is the fastest algorithm on open maps, since rows of its quadrants which
+    have no walls are marked 64 tiles at a time.
+
+    A tracker must not be used by more than one thread at a time.
+    \endrst
+ */
+typedef struct TCODFOV_FovTracker TCODFOV_FovTracker;
+/**
+    Return a new tracker for maps of `width` by `height` tiles, or NULL on failure.
+
+    Every update uses `max_radius`, `light_walls`, and `algo`.  The tracker starts with no tiles in view.
+ */
+TCODFOV_PUBLIC TCODFOV_FovTracker* TCODFOV_fov_tracker_new(
+    int width, int height, int max_radius, bool light_walls, TCODFOV_fov_algorithm_t algo);
+/**
+    Free a tracker.  Does nothing if `tracker` is NULL.
+ */
+TCODFOV_PUBLIC void TCODFOV_fov_tracker_delete(TCODFOV_FovTracker* tracker);
+/**
+    Compute the field-of-view of `transparent` from `pov_x`, `pov_y` and replace the previous result.
+
+    \rst
+    `transparent` must be the same size as the tracker.  Afterwards :any:`TCODFOV_fov_tracker_get_entered` and
+    :any:`TCODFOV_fov_tracker_get_left` return the tiles which changed compared to the previous update.  The
+    point-of-view may move any distance, or stay in place after the map changed.
+
+    On failure the changes are incomplete.  If the field-of-view itself could not be computed then the tracker is
+    left with no tiles in view, so the next update reports every visible tile as entered.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_fov_tracker_update(
+    TCODFOV_FovTracker* __restrict tracker, const TCODFOV_Map2D* __restrict transparent, int pov_x, int pov_y);
+/**
+    Return the current field-of-view of `tracker` as a bitpacked map.
+
+    The map is owned by the tracker and is only valid until the next update.
+ */
+TCODFOV_PUBLIC const TCODFOV_Map2D* TCODFOV_fov_tracker_get_fov(const TCODFOV_FovTracker* tracker);
+/**
+    Set `points` to the tiles which came into view on the last update and return how many there are.
+
+    The points are sorted by row then column and are only valid until the next update.
+ */
+TCODFOV_PUBLIC int TCODFOV_fov_tracker_get_entered(
+    const TCODFOV_FovTracker* __restrict tracker, const TCODFOV_Point** __restrict points);
+/**
+    Set `points` to the tiles which went out of view on the last update and return how many there are.
+
+    The points are sorted by row then column and are only valid until the next update.
+ */
+TCODFOV_PUBLIC int TCODFOV_fov_tracker_get_left(
+    const TCODFOV_FovTracker* __restrict tracker, const TCODFOV_Point** __restrict points);
+#ifdef __cplusplus
+}  // extern "C"
+namespace tcod::fov {
+struct FovTrackerDeleter_ {
+  void operator()(TCODFOV_FovTracker* tracker) const { TCODFOV_fov_tracker_delete(tracker); }
+};
+typedef std::unique_ptr<TCODFOV_FovTracker, FovTrackerDeleter_> FovTrackerPtr_;
+}  // namespace tcod::fov
+#endif  // __cplusplus
+#endif  // TCODFOV_FOV_TRACKER_H_
@@ -8,6 +8,7 @@
 #include "config.h"
 #include "error.h"
 #include "map_types.h"
+#include "workspace.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,6 +16,17 @@ extern "C" {
 
 TCODFOV_PUBLIC TCODFOV_Error
 TCODFOV_triage_2d(const TCODFOV_Map2D* __restrict transparent, TCODFOV_Map2D* __restrict out, int pov_x, int pov_y);
+/**
+    Same as :any:`TCODFOV_triage_2d` but takes its row buffers from `workspace`.
+
+    `workspace` may be NULL, in which case temporary buffers are allocated for this call only.
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_triage_2d_ex(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict out,
+    int pov_x,
+    int pov_y,
+    TCODFOV_Workspace* __restrict workspace);
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -33,25 +33,24 @@
 #ifndef TCODFOV_FOV_TYPES_H_
 #define TCODFOV_FOV_TYPES_H_
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "config.h"
 
-/**
- *  Private map cell struct.
- */
-struct TCODFOV_MapCell {
-  bool transparent;
-  bool walkable;
-  bool fov;
-};
 /**
  *  Private map struct.
+ *
+ *  Each property is stored in its own bitpacked plane, all three planes share a single allocation.
  */
 typedef struct TCODFOV_Map {
   int width;
   int height;
   int nbcells;
-  struct TCODFOV_MapCell* __restrict cells;
+  ptrdiff_t y_stride;  // Byte stride of each plane along the y-axis.
+  uint8_t* __restrict transparent;  // Bitpacked transparency plane, owns the allocation.
+  uint8_t* __restrict walkable;  // Bitpacked walkable plane.
+  uint8_t* __restrict fov;  // Bitpacked field-of-view plane.
 } TCODFOV_Map;
 /**
     \rst
@@ -39,6 +39,8 @@
 #include "fov.h"
 #include "fov_types.h"
 #include "map_types.h"
+#include "thread_pool.h"
+#include "workspace.h"
 
 /* tcodlib internal stuff */
 #ifdef __cplusplus
@@ -89,6 +91,163 @@ TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_compute_fov_symmetric_shadowcast(
     int pov_y,
     int max_radius,
     bool light_walls);
+/**
+    Add the symmetric shadowcasting field-of-view of several points-of-view to `fov`.
+
+    \rst
+    The output map is not cleared, each point-of-view at `pov_x[i]`, `pov_y[i]` with radius `max_radius[i]` marks
+    the tiles it can see in addition to those which are already set.
+    The result is the same as calling :any:`TCODFOV_map_compute_fov_symmetric_shadowcast` for each point-of-view
+    on the same output map.
+
+    When both maps are bitpacked then areas which are already fully visible are skipped for radii from 1 to 31.
+    This is much faster than separate calls for groups of points-of-view which are near each other.
+
+    All points-of-view are checked before any are computed.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_compute_fov_symmetric_shadowcast_union(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int count,
+    const int* __restrict pov_x,
+    const int* __restrict pov_y,
+    const int* __restrict max_radius,
+    bool light_walls);
+/**
+    Update a symmetric shadowcasting field-of-view after the transparency of some tiles changed.
+
+    \rst
+    `fov` must hold the result of :any:`TCODFOV_map_compute_fov_symmetric_shadowcast` with the same point-of-view,
+    `max_radius`, and `light_walls` on a cleared output map, computed before the tiles in `changed` were edited.
+    `transparent` is the map after those edits.  Afterwards `fov` is the same as computing the field-of-view again.
+
+    Each changed tile can only affect the tiles behind it within the slopes of its edges.  Only those tiles are
+    cleared and scanned again, everything else in `fov` is left as it was.  A door far from the point-of-view only
+    repairs a narrow sector, which is much cheaper than a full computation.  Changed tiles which are close together
+    are repaired by the same scan, and tiles which are out of `max_radius` are ignored.
+
+    All changed tiles are checked before any are repaired.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_repair_fov_symmetric_shadowcast(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int count,
+    const TCODFOV_Point* __restrict changed);
+/**
+    Compute the field-of-view of `transparent` into `fov` using the given algorithm.
+
+    \rst
+    Unlike :any:`TCODFOV_map_compute_fov` the output map is not cleared first.
+
+    If `workspace` is not NULL then scratch memory is taken from it instead of being allocated for this call.
+    Pass the same workspace to repeated calls to avoid allocating on every call.
+
+    If `dirty` is not NULL then it is set to a rectangle containing every tile which this call could have marked as
+    visible.  This is the area around the point-of-view within `max_radius`, clipped to the map.
+    Tiles outside of this rectangle are never set, so clearing or comparing only this rectangle is enough to reset
+    or diff the output between calls, see :any:`TCODFOV_map2d_clear_rect`.
+
+    This function is reentrant.  Any number of threads may compute from the same `transparent` map at once as long
+    as each of them has its own `fov` map and `workspace`.  No global lock is needed, since errors are reported
+    through a thread-local message.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_compute_fov_2d(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_Workspace* __restrict workspace,
+    TCODFOV_Rect* __restrict dirty);
+/**
+    Compute the field-of-view of a :any:`TCODFOV_Map` into a separate output map.
+
+    \rst
+    This gives the same results as :any:`TCODFOV_map_compute_fov`, but `map` is only read from and its own
+    field-of-view is left as it was.  One map can be shared between any number of threads computing different
+    points-of-view at once, each with its own `fov` and `workspace`.
+
+    `fov` must be the same size as `map`, for example a bitpacked map or a contiguous array of bytes.  It is cleared
+    before the field-of-view is computed.  `workspace` may be NULL.
+
+    A `TCODFOV_MAP2D_EPOCH` output is cleared by advancing its epoch.  Other outputs are cleared within `dirty`, which
+    must hold the rectangle reported by the previous call with this `fov`, or the whole map before the first call.
+    `dirty` is then set to the rectangle this call could have marked as visible.
+    If `dirty` is NULL then the whole output is cleared instead.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_compute_fov_into(
+    const TCODFOV_Map* __restrict map,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_Workspace* __restrict workspace,
+    TCODFOV_Rect* __restrict dirty);
+/**
+    Compute the field-of-view of `transparent` from many points-of-view at once.
+
+    \rst
+    Query `i` computes `fov[i]` from `pov_x[i]`, `pov_y[i]` within `max_radius[i]`, the same as
+    :any:`TCODFOV_map_compute_fov_2d`.  The `dirty` area of each query is cleared first, so after this call that area
+    holds exactly the field-of-view and tiles outside of it are left as they were.
+
+    Every output map must be the same size as `transparent`.  Output maps of different points-of-view or radii must
+    not share memory, since they may be written at the same time.  Queries with the same point-of-view and radius are
+    only computed once, their results are copied to the other output maps.
+
+    The queries are split between the threads of `pool`.  If `pool` is NULL then they are computed on the calling
+    thread.  All queries are checked before any of them are computed, so on invalid arguments no map is modified.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_compute_fov_batch(
+    const TCODFOV_Map2D* __restrict transparent,
+    int count,
+    const int* __restrict pov_x,
+    const int* __restrict pov_y,
+    const int* __restrict max_radius,
+    TCODFOV_Map2D* const* __restrict fov,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_ThreadPool* __restrict pool);
+/**
+    Compute the field-of-view of one point-of-view by splitting it between the threads of `pool`.
+
+    \rst
+    `TCODFOV_SHADOW` is split into its 8 octants and `TCODFOV_SYMMETRIC_SHADOWCAST` into its 4 quadrants.  Each part
+    is computed into its own buffer, then they are merged into `fov` on the calling thread, so the results are the
+    same as :any:`TCODFOV_map_compute_fov_2d`.  Like that function the output map is not cleared first.
+
+    Other algorithms, input maps which are not bitpacked, and radii from 1 to 63 are computed on the calling thread.
+    If `pool` is NULL then the parts are computed one after another on the calling thread.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_compute_fov_parallel(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_ThreadPool* __restrict pool);
+/**
+    Set every tile of `map` within `rect` to false.
+
+    `rect` is clipped to the bounds of `map`.
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map2d_clear_rect(TCODFOV_Map2D* __restrict map, TCODFOV_Rect rect);
 TCODFOV_PUBLIC TCODFOV_Error TCODFOV_map_postprocess(
     const TCODFOV_Map2D* __restrict transparent, TCODFOV_Map2D* __restrict fov, int pov_x, int pov_y, int radius);
 /**
@@ -81,6 +81,9 @@ TCODFOV_PUBLIC void TCODFOV_set_log_level(int level);
         Can be NULL to disable logging.
     @param userdata Userdata to be passed to the log function.
 
+    The callback may be called from any thread which reports an error, including the threads of a thread pool.
+    The logger is shared by all threads, so set it before starting any threads which use this library.
+
     \rst
     .. versionadded:: 1.19
     \endrst
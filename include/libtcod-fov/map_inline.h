@@ -3,6 +3,7 @@
 #define TCODFOV_MAP_INLINE_H_
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "fov_types.h"
 #include "map_types.h"
@@ -23,11 +24,48 @@ static inline TCODFOV_Map2D* TCODFOV_map2d_new_bitpacked(int width, int height)
   return map;
 }
 
+/// @brief Return a new epoch-stamped map of the given size with all tiles set to false.
+/// @return The new map, or NULL if memory could not be allocated.
+static inline TCODFOV_Map2D* TCODFOV_map2d_new_epoch(int width, int height) {
+  TCODFOV_Map2D* map = (TCODFOV_Map2D*)calloc(1, sizeof(*map) + sizeof(uint32_t) * width * height);
+  if (!map) return NULL;
+  map->epoch.type = TCODFOV_MAP2D_EPOCH;
+  map->epoch.shape[0] = height;
+  map->epoch.shape[1] = width;
+  map->epoch.data = (uint32_t*)((uint8_t*)map + sizeof(*map));
+  map->epoch.epoch = 1;
+  return map;
+}
+
+/// @brief Set every tile of an epoch-stamped map to false by advancing its epoch.
+///
+/// This is constant time except when the epoch counter wraps around, then the stamps are reset.
+/// @param map Map union pointer, does nothing unless this is a `TCODFOV_MAP2D_EPOCH` map.
+static inline void TCODFOV_map2d_epoch_advance(TCODFOV_Map2D* __restrict map) {
+  if (!map || map->type != TCODFOV_MAP2D_EPOCH) return;
+  if (++map->epoch.epoch != 0) return;
+  memset(map->epoch.data, 0, sizeof(*map->epoch.data) * map->epoch.shape[0] * map->epoch.shape[1]);
+  map->epoch.epoch = 1;
+}
+
 /// @brief Delete a map created by any TCODFOV_map2d_new function.
 static inline void TCODFOV_map2d_delete(TCODFOV_Map2D* map) {
   if (map) free(map);
 }
 
+/// @brief Return the bitpacked plane of a deprecated map view selected by `select`.
+static inline uint8_t* TCODFOV_map2d_deprecated_plane_(const struct TCODFOV_Map2DDeprecated* __restrict map) {
+  switch (map->select) {
+    default:
+    case 0:
+      return map->map.transparent;
+    case 1:
+      return map->map.walkable;
+    case 2:
+      return map->map.fov;
+  }
+}
+
 /// @brief Return the width of a 2D map.
 /// @param map Map union pointer, can be NULL.
 /// @return The map width in tiles, or zero if `map` is NULL.
@@ -37,6 +75,7 @@ static inline int TCODFOV_map2d_get_width(const TCODFOV_Map2D* __restrict map) {
     case TCODFOV_MAP2D_CALLBACK:
     case TCODFOV_MAP2D_BITPACKED:
     case TCODFOV_MAP2D_CONTIGIOUS:
+    case TCODFOV_MAP2D_EPOCH:
       // Multiple structs share the same shape format
       return map->bool_callback.shape[1];
     case TCODFOV_MAP2D_DEPRECATED:
@@ -54,6 +93,7 @@ static inline int TCODFOV_map2d_get_height(const TCODFOV_Map2D* __restrict map)
     case TCODFOV_MAP2D_CALLBACK:
     case TCODFOV_MAP2D_BITPACKED:
     case TCODFOV_MAP2D_CONTIGIOUS:
+    case TCODFOV_MAP2D_EPOCH:
       return map->bool_callback.shape[0];
     case TCODFOV_MAP2D_DEPRECATED:
       return map->deprecated_map.map.height;
@@ -84,23 +124,16 @@ static inline bool TCODFOV_map2d_get_bool(const TCODFOV_Map2D* __restrict map, i
       if (!map->bool_callback.get) return 0;
       return map->bool_callback.get(map->bool_callback.userdata, x, y);
     case TCODFOV_MAP2D_DEPRECATED: {
-      const struct TCODFOV_MapCell* cell = &map->deprecated_map.map.cells[map->deprecated_map.map.width * y + x];
-      switch (map->deprecated_map.select) {
-        default:
-        case 0:
-          return cell->transparent;
-        case 1:
-          return cell->walkable;
-        case 2:
-          return cell->fov;
-      }
+      const uint8_t active_bit = 1 << (x % 8);
+      const uint8_t* plane = TCODFOV_map2d_deprecated_plane_(&map->deprecated_map);
+      return (plane[map->deprecated_map.map.y_stride * y + (x / 8)] & active_bit) != 0;
     }
     case TCODFOV_MAP2D_BITPACKED: {
       const uint8_t active_bit = 1 << (x % 8);
       return (map->bitpacked.data[map->bitpacked.y_stride * y + (x / 8)] & active_bit) != 0;
     }
     case TCODFOV_MAP2D_CONTIGIOUS: {
-      const ptrdiff_t index = map->contigious.shape[0] * y + x;
+      const ptrdiff_t index = (ptrdiff_t)map->contigious.shape[1] * y + x;
       switch (map->contigious.item_type) {
         case TCODFOV_DATATYPE_BOOL:
           return ((bool*)map->contigious.data)[index];
@@ -114,6 +147,8 @@ static inline bool TCODFOV_map2d_get_bool(const TCODFOV_Map2D* __restrict map, i
           return 0;
       }
     };
+    case TCODFOV_MAP2D_EPOCH:
+      return map->epoch.data[(ptrdiff_t)map->epoch.shape[1] * y + x] == map->epoch.epoch;
     default:
       return 0;
   }
@@ -132,19 +167,11 @@ static inline void TCODFOV_map2d_set_bool(TCODFOV_Map2D* __restrict map, int x,
       map->bool_callback.set(map->bool_callback.userdata, x, y, value);
       return;
     case TCODFOV_MAP2D_DEPRECATED: {
-      struct TCODFOV_MapCell* cell = &map->deprecated_map.map.cells[map->deprecated_map.map.width * y + x];
-      switch (map->deprecated_map.select) {
-        default:
-        case 0:
-          cell->transparent = value;
-          return;
-        case 1:
-          cell->walkable = value;
-          return;
-        case 2:
-          cell->fov = value;
-          return;
-      }
+      const uint8_t active_bit = 1 << (x % 8);
+      uint8_t* plane = TCODFOV_map2d_deprecated_plane_(&map->deprecated_map);
+      const ptrdiff_t index = map->deprecated_map.map.y_stride * y + (x / 8);
+      plane[index] = (plane[index] & ~active_bit) | (value ? active_bit : 0);
+      return;
     }
     case TCODFOV_MAP2D_BITPACKED: {
       const uint8_t active_bit = 1 << (x % 8);
@@ -153,7 +180,7 @@ static inline void TCODFOV_map2d_set_bool(TCODFOV_Map2D* __restrict map, int x,
       return;
     }
     case TCODFOV_MAP2D_CONTIGIOUS: {
-      const ptrdiff_t index = map->contigious.shape[0] * y + x;
+      const ptrdiff_t index = (ptrdiff_t)map->contigious.shape[1] * y + x;
       switch (map->contigious.item_type) {
         case TCODFOV_DATATYPE_BOOL:
           ((bool*)map->contigious.data)[index] = value;
@@ -171,6 +198,9 @@ static inline void TCODFOV_map2d_set_bool(TCODFOV_Map2D* __restrict map, int x,
           return;
       }
     };
+    case TCODFOV_MAP2D_EPOCH:
+      map->epoch.data[(ptrdiff_t)map->epoch.shape[1] * y + x] = value ? map->epoch.epoch : 0;
+      return;
     default:
       return;
   }
@@ -180,7 +210,7 @@ static inline uint8_t TCODFOV_map2d_get_u8(TCODFOV_Map2D* __restrict map, int x,
   if (!TCODFOV_map2d_in_bounds(map, x, y)) return 0;
   switch (map->type) {
     case TCODFOV_MAP2D_CONTIGIOUS: {
-      const ptrdiff_t index = map->contigious.shape[0] * y + x;
+      const ptrdiff_t index = (ptrdiff_t)map->contigious.shape[1] * y + x;
       switch (map->contigious.item_type) {
         case TCODFOV_DATATYPE_BOOL:
           return ((bool*)map->contigious.data)[index] ? 255 : 0;
@@ -208,7 +238,7 @@ static inline void TCODFOV_map2d_set_u8(TCODFOV_Map2D* __restrict map, int x, in
   if (!TCODFOV_map2d_in_bounds(map, x, y)) return;
   switch (map->type) {
     case TCODFOV_MAP2D_CONTIGIOUS: {
-      const ptrdiff_t index = map->contigious.shape[0] * y + x;
+      const ptrdiff_t index = (ptrdiff_t)map->contigious.shape[1] * y + x;
       switch (map->contigious.item_type) {
         case TCODFOV_DATATYPE_BOOL:
           ((bool*)map->contigious.data)[index] = value > 0;
@@ -236,7 +266,7 @@ static inline double TCODFOV_map2d_get_d(const TCODFOV_Map2D* __restrict map, in
   if (!TCODFOV_map2d_in_bounds(map, x, y)) return 0;
   switch (map->type) {
     case TCODFOV_MAP2D_CONTIGIOUS: {
-      const ptrdiff_t index = map->contigious.shape[0] * y + x;
+      const ptrdiff_t index = (ptrdiff_t)map->contigious.shape[1] * y + x;
       switch (map->contigious.item_type) {
         case TCODFOV_DATATYPE_BOOL:
           return ((bool*)map->contigious.data)[index] ? 1.0 : 0.0;
@@ -259,7 +289,7 @@ static inline void TCODFOV_map2d_set_d(TCODFOV_Map2D* __restrict map, int x, int
   if (!TCODFOV_map2d_in_bounds(map, x, y)) return;
   switch (map->type) {
     case TCODFOV_MAP2D_CONTIGIOUS: {
-      const ptrdiff_t index = map->contigious.shape[0] * y + x;
+      const ptrdiff_t index = (ptrdiff_t)map->contigious.shape[1] * y + x;
       switch (map->contigious.item_type) {
         case TCODFOV_DATATYPE_BOOL:
           ((bool*)map->contigious.data)[index] = value >= 0.5;
@@ -15,6 +15,7 @@ typedef enum TCODFOV_Map2DType {
   TCODFOV_MAP2D_DEPRECATED = 2,
   TCODFOV_MAP2D_BITPACKED = 3,
   TCODFOV_MAP2D_CONTIGIOUS = 4,
+  TCODFOV_MAP2D_EPOCH = 5,
 } TCODFOV_Map2DType;
 
 typedef enum TCODFOV_DataType {
@@ -56,6 +57,31 @@ struct TCODFOV_Map2DContigious {
   TCODFOV_DataType item_type;
 };
 
+/// @brief Epoch-stamped boolean 2D grid.
+///
+/// A tile is true when its stamp equals the current epoch.
+/// The whole grid is cleared in constant time by advancing the epoch with `TCODFOV_map2d_epoch_advance`.
+struct TCODFOV_Map2DEpoch {
+  TCODFOV_Map2DType type;  // Must be TCODFOV_MAP2D_EPOCH
+  int shape[2];  // {height, width}
+  uint32_t* __restrict data;  // Epoch stamp of each tile
+  uint32_t epoch;  // Current epoch, never zero
+};
+
+/// @brief An axis-aligned rectangle of tiles.
+typedef struct TCODFOV_Rect {
+  int x;  // Left-most column.
+  int y;  // Top-most row.
+  int width;  // Width in tiles, zero for an empty rectangle.
+  int height;  // Height in tiles, zero for an empty rectangle.
+} TCODFOV_Rect;
+
+/// @brief The position of a tile.
+typedef struct TCODFOV_Point {
+  int x;
+  int y;
+} TCODFOV_Point;
+
 /// @brief Union type for 2D maps.
 typedef union TCODFOV_Map2D {
   TCODFOV_Map2DType type;
@@ -63,5 +89,6 @@ typedef union TCODFOV_Map2D {
   struct TCODFOV_Map2DDeprecated deprecated_map;
   struct TCODFOV_Map2DBitpacked bitpacked;
   struct TCODFOV_Map2DContigious contigious;
+  struct TCODFOV_Map2DEpoch epoch;
 } TCODFOV_Map2D;
 #endif  // TCODFOV_MAP_TYPES_H_
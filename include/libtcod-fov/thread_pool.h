@@ -0,0 +1,81 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_THREAD_POOL_H_
+#define TCODFOV_THREAD_POOL_H_
+
+#ifdef __cplusplus
+#include <memory>
+#endif  // __cplusplus
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+    A pool of worker threads for computing many fields-of-view at once.
+
+    \rst
+    The calling thread works alongside the pool's threads, so a pool of `thread_count` threads starts
+    `thread_count - 1` new threads.  Each thread keeps its own :any:`TCODFOV_Workspace`.
+
+    Work is split evenly between the threads at the start of each call.  Threads which run out of work take half of
+    the remaining work of another thread, so uneven workloads still keep every thread busy.
+
+    A pool must not be used by more than one call at a time.
+    \endrst
+ */
+typedef struct TCODFOV_ThreadPool TCODFOV_ThreadPool;
+/**
+    Return a new pool of `thread_count` threads, or NULL if the pool could not be created.
+
+    If `thread_count` is zero or less then one thread is used per processor.
+ */
+TCODFOV_PUBLIC TCODFOV_ThreadPool* TCODFOV_thread_pool_new(int thread_count);
+/**
+    Stop the threads of a pool and free it.  Does nothing if `pool` is NULL.
+ */
+TCODFOV_PUBLIC void TCODFOV_thread_pool_delete(TCODFOV_ThreadPool* pool);
+/**
+    Return the number of threads of `pool`, including the calling thread.  Returns 1 if `pool` is NULL.
+ */
+TCODFOV_PUBLIC int TCODFOV_thread_pool_get_thread_count(const TCODFOV_ThreadPool* pool);
+#ifdef __cplusplus
+}  // extern "C"
+namespace tcod::fov {
+struct ThreadPoolDeleter_ {
+  void operator()(TCODFOV_ThreadPool* pool) const { TCODFOV_thread_pool_delete(pool); }
+};
+typedef std::unique_ptr<TCODFOV_ThreadPool, ThreadPoolDeleter_> ThreadPoolPtr_;
+}  // namespace tcod::fov
+#endif  // __cplusplus
+#endif  // TCODFOV_THREAD_POOL_H_
@@ -0,0 +1,174 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_VISIBILITY_H_
+#define TCODFOV_VISIBILITY_H_
+
+#include <stdbool.h>
+#ifdef __cplusplus
+#include <memory>
+#endif  // __cplusplus
+#include "config.h"
+#include "error.h"
+#include "fov_types.h"
+#include "map_types.h"
+#include "thread_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+    A transparency map with viewers whose fields-of-view are recomputed only when the map changes around them.
+
+    \rst
+    The system owns the transparency map, the viewers, and the last field-of-view of each viewer.  Each viewer only
+    depends on the tiles within its radius, so a change to a tile only marks the viewers whose radius covers that
+    tile.  The viewers covering each area of the map are kept in a grid, so finding them does not depend on the
+    total number of viewers.  :any:`TCODFOV_visibility_update` then recomputes only the marked viewers.
+
+    The results of a viewer only cover the tiles within its radius, so many viewers with a small radius use little
+    memory even on a large map.
+
+    A system must not be used by more than one thread at a time.
+    \endrst
+ */
+typedef struct TCODFOV_Visibility TCODFOV_Visibility;
+/**
+    Return a new system for a map of `width` by `height` tiles, or NULL on failure.
+
+    Every viewer is computed with `light_walls` and `algo`.  All tiles start out opaque and there are no viewers.
+ */
+TCODFOV_PUBLIC TCODFOV_Visibility* TCODFOV_visibility_new(
+    int width, int height, bool light_walls, TCODFOV_fov_algorithm_t algo);
+/**
+    Free a system and all of its viewers.  Does nothing if `visibility` is NULL.
+ */
+TCODFOV_PUBLIC void TCODFOV_visibility_delete(TCODFOV_Visibility* visibility);
+/**
+    Return the transparency map of `visibility`.
+
+    \rst
+    Tiles are read and changed with the usual functions such as :any:`TCODFOV_map2d_set_bool`.  Setting a tile to a
+    different value marks every viewer whose radius covers it.  The map is owned by the system and stays valid until
+    it is deleted.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Map2D* TCODFOV_visibility_get_map(TCODFOV_Visibility* visibility);
+/**
+    Set the transparency of `count` tiles, tile `points[i]` is set to `transparent[i]`.
+
+    All points are checked before any tile is changed.
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_visibility_set_tiles(
+    TCODFOV_Visibility* __restrict visibility,
+    int count,
+    const TCODFOV_Point* __restrict points,
+    const bool* __restrict transparent);
+/**
+    Add a viewer at `pov_x`, `pov_y` which sees up to `max_radius` tiles away, or the whole map if it is zero.
+
+    Returns the index of the new viewer, or a negative error code on failure.  Indexes of removed viewers are reused.
+    The new viewer sees nothing until the next update.
+ */
+TCODFOV_PUBLIC int TCODFOV_visibility_add_viewer(
+    TCODFOV_Visibility* visibility, int pov_x, int pov_y, int max_radius);
+/**
+    Move a viewer to `pov_x`, `pov_y`.  Like a new viewer it sees nothing until the next update.
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_visibility_move_viewer(
+    TCODFOV_Visibility* visibility, int viewer, int pov_x, int pov_y);
+/**
+    Remove a viewer and free its field-of-view.
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_visibility_remove_viewer(TCODFOV_Visibility* visibility, int viewer);
+/**
+    Recompute the viewers which were added, moved, or had tiles within their radius changed since the last update.
+
+    \rst
+    The viewers are split between the threads of `pool`.  If `pool` is NULL then they are computed on the calling
+    thread.  On failure every viewer which needed an update is tried again on the next update.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_visibility_update(
+    TCODFOV_Visibility* __restrict visibility, TCODFOV_ThreadPool* __restrict pool);
+/**
+    Recompute dirty viewers on the calling thread until `budget_us` microseconds would be used up.
+
+    \rst
+    Dirty viewers are computed in order of their priority from :any:`TCODFOV_visibility_set_priority`, highest
+    first, then by how long they have been out of date.  The time a viewer takes is estimated from the area within
+    its radius and the speed of earlier viewers.  The update stops at the first viewer which would go over the budget,
+    and it and the viewers after it are carried over to later updates.  At least one viewer is always computed, so
+    a budget of zero computes exactly one.
+
+    This spreads the work of many viewers which became dirty at once over several updates.
+    \endrst
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_visibility_update_budget(TCODFOV_Visibility* visibility, int budget_us);
+/**
+    Set the priority of a viewer for budgeted updates.  Viewers start with a priority of zero.
+ */
+TCODFOV_PUBLIC TCODFOV_Error TCODFOV_visibility_set_priority(
+    TCODFOV_Visibility* visibility, int viewer, int priority);
+/**
+    Return how many updates ago the field-of-view of a viewer went out of date.
+
+    Returns zero if it is up to date, or a negative error code if `viewer` is not a valid index.
+ */
+TCODFOV_PUBLIC int TCODFOV_visibility_get_staleness(const TCODFOV_Visibility* visibility, int viewer);
+/**
+    Return the number of viewers which the next update will recompute.
+ */
+TCODFOV_PUBLIC int TCODFOV_visibility_get_dirty_count(const TCODFOV_Visibility* visibility);
+/**
+    Return the field-of-view of a viewer as a bitpacked map, or NULL if `viewer` is not a valid index.
+
+    \rst
+    The map only covers the tiles of the full map within `window`, tile `x`, `y` is at `x - window->x`,
+    `y - window->y` of the returned map.  Tiles outside of the window are never visible.  `window` may be NULL.
+
+    The map is owned by the system and is valid until the viewer is moved or removed.  It is updated in place by
+    :any:`TCODFOV_visibility_update`.
+    \endrst
+ */
+TCODFOV_PUBLIC const TCODFOV_Map2D* TCODFOV_visibility_get_fov(
+    const TCODFOV_Visibility* __restrict visibility, int viewer, TCODFOV_Rect* __restrict window);
+#ifdef __cplusplus
+}  // extern "C"
+namespace tcod::fov {
+struct VisibilityDeleter_ {
+  void operator()(TCODFOV_Visibility* visibility) const { TCODFOV_visibility_delete(visibility); }
+};
+typedef std::unique_ptr<TCODFOV_Visibility, VisibilityDeleter_> VisibilityPtr_;
+}  // namespace tcod::fov
+#endif  // __cplusplus
+#endif  // TCODFOV_VISIBILITY_H_
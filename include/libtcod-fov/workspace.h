@@ -0,0 +1,77 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_WORKSPACE_H_
+#define TCODFOV_WORKSPACE_H_
+
+#ifdef __cplusplus
+#include <memory>
+#endif  // __cplusplus
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+    Reusable scratch memory for field-of-view computations.
+
+    \rst
+    Algorithms which need temporary buffers take them from a workspace instead of allocating them on every call.
+    The buffers grow on demand and are kept until the workspace is deleted, so repeated calls on maps of a similar
+    size do not allocate at all.
+
+    A workspace also caches data which only depends on the shape of the area being computed.
+    :any:`TCODFOV_BASIC` keeps a trie of its rays for each of the last 4 radii it was called with, which is reused by
+    any point-of-view with that radius.  Tries are only built for radii up to 127, where one takes about 2 MB.
+
+    A workspace must not be used by more than one thread at a time.  Create one workspace per worker thread.
+    \endrst
+ */
+typedef struct TCODFOV_Workspace TCODFOV_Workspace;
+/**
+    Return a new empty workspace, or NULL if memory could not be allocated.
+ */
+TCODFOV_PUBLIC TCODFOV_Workspace* TCODFOV_workspace_new(void);
+/**
+    Free a workspace and all of its buffers.  Does nothing if `workspace` is NULL.
+ */
+TCODFOV_PUBLIC void TCODFOV_workspace_delete(TCODFOV_Workspace* workspace);
+#ifdef __cplusplus
+}  // extern "C"
+namespace tcod::fov {
+struct WorkspaceDeleter_ {
+  void operator()(TCODFOV_Workspace* workspace) const { TCODFOV_workspace_delete(workspace); }
+};
+typedef std::unique_ptr<TCODFOV_Workspace, WorkspaceDeleter_> WorkspacePtr_;
+}  // namespace tcod::fov
+#endif  // __cplusplus
+#endif  // TCODFOV_WORKSPACE_H_
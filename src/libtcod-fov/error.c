@@ -36,11 +36,20 @@
 #include <string.h>
 
 #include "logging.h"
+#include "parallel.h"
 
+// Storage class of variables which have a separate instance for each thread.
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
 // Maximum error length in bytes.
 #define MAX_ERROR_LENGTH 1024
-// Current error message.
-static char error_msg_[MAX_ERROR_LENGTH] = "";
+// Current error message of the calling thread.
+static THREAD_LOCAL char error_msg_[MAX_ERROR_LENGTH] = "";
 
 const char* TCODFOV_get_error(void) { return error_msg_; }
 TCODFOV_Error TCODFOV_set_error(const char* msg) {
@@ -57,3 +66,4 @@ TCODFOV_Error TCODFOV_set_errorf(const char* fmt, ...) {
   return TCODFOV_E_ERROR;
 }
 void TCODFOV_clear_error(void) { error_msg_[0] = '\0'; }
+void TCODFOV_restore_error_(const char* msg) { strncpy(error_msg_, msg, sizeof(error_msg_) - 1); }
@@ -0,0 +1,211 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/** \file
+    Field-of-view for many points-of-view of one map at once.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "fov.h"
+#include "libtcod_int.h"
+#include "map_access.h"
+#include "map_inline.h"
+#include "map_types.h"
+#include "parallel.h"
+#include "scratch.h"
+/**
+    A point-of-view and radius of a batch, sorted so that identical queries are next to each other.
+ */
+typedef struct BatchQuery {
+  int pov_x;
+  int pov_y;
+  int max_radius;  // As given by the caller, some algorithms give different results for each negative radius.
+  int index;  // Index of the query in the arrays passed to the batch.
+} BatchQuery;
+/**
+    The arguments of a batch shared by all of its tasks.
+ */
+typedef struct Batch {
+  const TCODFOV_Map2D* __restrict transparent;
+  TCODFOV_Map2D* const* __restrict fov;
+  bool light_walls;
+  TCODFOV_fov_algorithm_t algo;
+  const BatchQuery* __restrict queries;  // Sorted queries.
+  const int* __restrict groups;  // Index of the first query of each group of identical queries, and the end.
+} Batch;
+/**
+    Order queries by point-of-view then radius, ties are kept in their original order.
+ */
+static int compare_queries(const void* a_ptr, const void* b_ptr) {
+  const BatchQuery* a = a_ptr;
+  const BatchQuery* b = b_ptr;
+  if (a->pov_y != b->pov_y) return a->pov_y < b->pov_y ? -1 : 1;
+  if (a->pov_x != b->pov_x) return a->pov_x < b->pov_x ? -1 : 1;
+  if (a->max_radius != b->max_radius) return a->max_radius < b->max_radius ? -1 : 1;
+  return (a->index > b->index) - (a->index < b->index);
+}
+/**
+    Return true if `a` and `b` have the same results.
+ */
+static bool same_query(const BatchQuery* a, const BatchQuery* b) {
+  return a->pov_x == b->pov_x && a->pov_y == b->pov_y && a->max_radius == b->max_radius;
+}
+/**
+    Copy the tiles of `source` within `rect` to `dest`.  Both maps must be the same size.
+ */
+static void copy_rect(const TCODFOV_Map2D* __restrict source, TCODFOV_Map2D* __restrict dest, TCODFOV_Rect rect) {
+  TCODFOV_MapAccess source_access;
+  TCODFOV_MapAccess dest_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&source_access, &dest_access, source, dest);
+  for (int y = rect.y; y < rect.y + rect.height; ++y) {
+    if (kind == TCODFOV_MAP_KIND_BITPACKED) {
+      TCODFOV_bitpacked_row_fill(&dest_access, rect.x, rect.x + rect.width, y, false);
+      for (int x = rect.x; x < rect.x + rect.width; x += 64) {
+        uint64_t tiles = TCODFOV_bitpacked_row_load64(&source_access, x, y);
+        if (rect.x + rect.width - x < 64) tiles &= ((uint64_t)1 << (rect.x + rect.width - x)) - 1;
+        TCODFOV_bitpacked_row_or64(&dest_access, x, y, tiles);
+      }
+      continue;
+    }
+    for (int x = rect.x; x < rect.x + rect.width; ++x) {
+      TCODFOV_map2d_set_bool(dest, x, y, TCODFOV_map2d_get_bool(source, x, y));
+    }
+  }
+}
+/**
+    Compute the first query of a group, then copy its results to the other queries of the group.
+ */
+static TCODFOV_Error batch_run_group(void* userdata, int group, TCODFOV_Workspace* __restrict workspace) {
+  const Batch* batch = userdata;
+  const BatchQuery* first = &batch->queries[batch->groups[group]];
+  TCODFOV_Map2D* first_fov = batch->fov[first->index];
+  const TCODFOV_Rect bounds = TCODFOV_map2d_fov_bounds_(first_fov, first->pov_x, first->pov_y, first->max_radius);
+  TCODFOV_Error err = TCODFOV_map2d_clear_rect(first_fov, bounds);
+  if (err < 0) return err;
+  err = TCODFOV_map_compute_fov_2d(
+      batch->transparent,
+      first_fov,
+      first->pov_x,
+      first->pov_y,
+      first->max_radius,
+      batch->light_walls,
+      batch->algo,
+      workspace,
+      NULL);
+  if (err < 0) return err;
+  for (int i = batch->groups[group] + 1; i < batch->groups[group + 1]; ++i) {
+    TCODFOV_Map2D* other_fov = batch->fov[batch->queries[i].index];
+    if (other_fov != first_fov) copy_rect(first_fov, other_fov, bounds);
+  }
+  return TCODFOV_E_OK;
+}
+TCODFOV_Error TCODFOV_map_compute_fov_batch(
+    const TCODFOV_Map2D* __restrict transparent,
+    int count,
+    const int* __restrict pov_x,
+    const int* __restrict pov_y,
+    const int* __restrict max_radius,
+    TCODFOV_Map2D* const* __restrict fov,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_ThreadPool* __restrict pool) {
+  if (!transparent) {
+    TCODFOV_set_errorv("Input map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count < 0) {
+    TCODFOV_set_errorvf("Count must not be negative, got %i.", count);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count == 0) return TCODFOV_E_OK;
+  if (!pov_x || !pov_y || !max_radius || !fov) {
+    TCODFOV_set_errorv("Query arrays must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if ((int)algo < 0 || algo >= NB_FOV_ALGORITHMS) {
+    TCODFOV_set_errorvf("Invalid field-of-view algorithm %i.", (int)algo);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  // Check every query before any work starts, so that worker threads only fail on allocations.
+  const int width = TCODFOV_map2d_get_width(transparent);
+  const int height = TCODFOV_map2d_get_height(transparent);
+  for (int i = 0; i < count; ++i) {
+    if (!fov[i]) {
+      TCODFOV_set_errorvf("Output map %i must not be NULL.", i);
+      return TCODFOV_E_INVALID_ARGUMENT;
+    }
+    if (TCODFOV_map2d_get_width(fov[i]) != width || TCODFOV_map2d_get_height(fov[i]) != height) {
+      TCODFOV_set_errorvf(
+          "Output map %i must be the same size as the input map {%i, %i}, got {%i, %i}.",
+          i,
+          width,
+          height,
+          TCODFOV_map2d_get_width(fov[i]),
+          TCODFOV_map2d_get_height(fov[i]));
+      return TCODFOV_E_INVALID_ARGUMENT;
+    }
+    if (!TCODFOV_map2d_in_bounds(fov[i], pov_x[i], pov_y[i])) {
+      TCODFOV_set_errorvf("Point of view %i {%i, %i} is out of bounds.", i, pov_x[i], pov_y[i]);
+      return TCODFOV_E_INVALID_ARGUMENT;
+    }
+  }
+  BatchQuery* queries = malloc(sizeof(*queries) * (size_t)count);
+  int* groups = malloc(sizeof(*groups) * ((size_t)count + 1));
+  if (!queries || !groups) {
+    free(queries);
+    free(groups);
+    TCODFOV_set_errorv("Out of memory.");
+    return TCODFOV_E_OUT_OF_MEMORY;
+  }
+  for (int i = 0; i < count; ++i) {
+    queries[i] = (BatchQuery){pov_x[i], pov_y[i], max_radius[i], i};
+  }
+  qsort(queries, (size_t)count, sizeof(*queries), compare_queries);
+  int group_count = 0;
+  for (int i = 0; i < count; ++i) {
+    if (i == 0 || !same_query(&queries[i - 1], &queries[i])) groups[group_count++] = i;
+  }
+  groups[group_count] = count;
+  Batch batch = {
+      .transparent = transparent,
+      .fov = fov,
+      .light_walls = light_walls,
+      .algo = algo,
+      .queries = queries,
+      .groups = groups,
+  };
+  const TCODFOV_Error err = TCODFOV_thread_pool_run_(pool, group_count, batch_run_group, &batch);
+  free(groups);
+  free(queries);
+  return err;
+}
@@ -34,19 +34,48 @@
 
 #include "fov.h"
 #include "libtcod_int.h"
+#include "map_access.h"
 #include "map_inline.h"
 #include "map_types.h"
+#include "scratch.h"
 #include "utility.h"
 
+/// @brief Return the size in bytes of each bitpacked plane of `map`.
+static size_t TCODFOV_map_plane_size(const TCODFOV_Map* __restrict map) { return (size_t)map->y_stride * map->height; }
+/// @brief Return the bit at `x`, `y` of a map plane.  `x`, `y` must be in bounds.
+static bool TCODFOV_map_plane_get(const TCODFOV_Map* __restrict map, const uint8_t* __restrict plane, int x, int y) {
+  return (plane[map->y_stride * y + (x >> 3)] >> (x & 7)) & 1;
+}
+/// @brief Assign the bit at `x`, `y` of a map plane.  `x`, `y` must be in bounds.
+static void TCODFOV_map_plane_set(
+    const TCODFOV_Map* __restrict map, uint8_t* __restrict plane, int x, int y, bool value) {
+  uint8_t* byte = &plane[map->y_stride * y + (x >> 3)];
+  const uint8_t active_bit = (uint8_t)(1 << (x & 7));
+  *byte = (uint8_t)((*byte & ~active_bit) | (value ? active_bit : 0));
+}
+/// @brief Point the walkable and fov planes into the allocation owned by the transparent plane.
+static void TCODFOV_map_assign_planes(TCODFOV_Map* __restrict map) {
+  map->walkable = map->transparent + TCODFOV_map_plane_size(map);
+  map->fov = map->walkable + TCODFOV_map_plane_size(map);
+}
 struct TCODFOV_Map* TCODFOV_map_new(int width, int height) {
   if (width <= 0 || height <= 0) {
     return NULL;
   }
   struct TCODFOV_Map* map = calloc(1, sizeof(*map));
+  if (!map) {
+    return NULL;
+  }
   map->width = width;
   map->height = height;
   map->nbcells = width * height;
-  map->cells = calloc(map->nbcells, sizeof(*map->cells));
+  map->y_stride = TCODFOV_round_to_byte_(width);
+  map->transparent = calloc(3, TCODFOV_map_plane_size(map));
+  if (!map->transparent) {
+    free(map);
+    return NULL;
+  }
+  TCODFOV_map_assign_planes(map);
   return map;
 }
 TCODFOV_Error TCODFOV_map_copy(const struct TCODFOV_Map* __restrict source, struct TCODFOV_Map* __restrict dest) {
@@ -54,44 +83,43 @@ TCODFOV_Error TCODFOV_map_copy(const struct TCODFOV_Map* __restrict source, stru
     TCODFOV_set_errorv("source and dest must be non-NULL.");
     return TCODFOV_E_INVALID_ARGUMENT;
   }
-  if (dest->nbcells != source->nbcells) {
-    struct TCODFOV_MapCell* new_cells = malloc(sizeof(*dest->cells) * dest->nbcells);
-    if (!new_cells) {
+  if (TCODFOV_map_plane_size(dest) != TCODFOV_map_plane_size(source)) {
+    uint8_t* new_planes = malloc(3 * TCODFOV_map_plane_size(source));
+    if (!new_planes) {
       TCODFOV_set_errorv("Out of memory while reallocating dest.");
       return TCODFOV_E_OUT_OF_MEMORY;
     }
-    free(dest->cells);
-    dest->cells = new_cells;
+    free(dest->transparent);
+    dest->transparent = new_planes;
   }
   dest->width = source->width;
   dest->height = source->height;
   dest->nbcells = source->nbcells;
-  memcpy(dest->cells, source->cells, sizeof(*dest->cells) * source->nbcells);
+  dest->y_stride = source->y_stride;
+  TCODFOV_map_assign_planes(dest);
+  memcpy(dest->transparent, source->transparent, 3 * TCODFOV_map_plane_size(source));
   return TCODFOV_E_OK;
 }
 void TCODFOV_map_clear(struct TCODFOV_Map* map, bool transparent, bool walkable) {
-  int i;
   if (!map) {
     return;
   }
-  for (i = 0; i < map->nbcells; ++i) {
-    map->cells[i].transparent = transparent;
-    map->cells[i].walkable = walkable;
-    map->cells[i].fov = 0;
-  }
+  memset(map->transparent, transparent ? 0xFF : 0, TCODFOV_map_plane_size(map));
+  memset(map->walkable, walkable ? 0xFF : 0, TCODFOV_map_plane_size(map));
+  memset(map->fov, 0, TCODFOV_map_plane_size(map));
 }
 void TCODFOV_map_set_properties(struct TCODFOV_Map* map, int x, int y, bool is_transparent, bool is_walkable) {
   if (!TCODFOV_map_in_bounds(map, x, y)) {
     return;
   }
-  map->cells[x + y * map->width].transparent = is_transparent;
-  map->cells[x + y * map->width].walkable = is_walkable;
+  TCODFOV_map_plane_set(map, map->transparent, x, y, is_transparent);
+  TCODFOV_map_plane_set(map, map->walkable, x, y, is_walkable);
 }
 void TCODFOV_map_delete(struct TCODFOV_Map* map) {
   if (!map) {
     return;
   }
-  free(map->cells);
+  free(map->transparent);
   free(map);
 }
 /**
@@ -101,15 +129,16 @@ void TCODFOV_map_delete(struct TCODFOV_Map* map) {
 
     `dx`, `dy` is the cast direction.
  */
-static void TCODFOV_map_postprocess_quadrant(
-    const TCODFOV_Map2D* __restrict transparent,
-    TCODFOV_Map2D* __restrict fov,
+TCODFOV_FORCE_INLINE void TCODFOV_map_postprocess_quadrant(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
     int x0,
     int y0,
     int x1,
     int y1,
     int dx,
-    int dy) {
+    int dy,
+    const TCODFOV_MapKind kind) {
   if (abs(dx) != 1 || abs(dy) != 1) {
     return;  // Bad parameters.
   }
@@ -117,26 +146,44 @@ static void TCODFOV_map_postprocess_quadrant(
     for (int cx = x0; cx <= x1; cx++) {
       const int x2 = cx + dx;
       const int y2 = cy + dy;
-      if (TCODFOV_map2d_get_bool(fov, cx, cy) && TCODFOV_map2d_get_bool(transparent, cx, cy)) {
+      if (TCODFOV_access_get(fov, kind, cx, cy) && TCODFOV_access_get(transparent, kind, cx, cy)) {
         if (x2 >= x0 && x2 <= x1) {
-          if (TCODFOV_map2d_in_bounds(fov, x2, cy) && !TCODFOV_map2d_get_bool(transparent, x2, cy)) {
-            TCODFOV_map2d_set_bool(fov, x2, cy, true);
+          if (TCODFOV_access_in_bounds(fov, x2, cy) && !TCODFOV_access_get(transparent, kind, x2, cy)) {
+            TCODFOV_access_set(fov, kind, x2, cy, true);
           }
         }
         if (y2 >= y0 && y2 <= y1) {
-          if (TCODFOV_map2d_in_bounds(fov, cx, y2) && !TCODFOV_map2d_get_bool(transparent, cx, y2)) {
-            TCODFOV_map2d_set_bool(fov, cx, y2, true);
+          if (TCODFOV_access_in_bounds(fov, cx, y2) && !TCODFOV_access_get(transparent, kind, cx, y2)) {
+            TCODFOV_access_set(fov, kind, cx, y2, true);
           }
         }
         if (x2 >= x0 && x2 <= x1 && y2 >= y0 && y2 <= y1) {
-          if (TCODFOV_map2d_in_bounds(fov, x2, y2) && !TCODFOV_map2d_get_bool(transparent, x2, y2)) {
-            TCODFOV_map2d_set_bool(fov, x2, y2, true);
+          if (TCODFOV_access_in_bounds(fov, x2, y2) && !TCODFOV_access_get(transparent, kind, x2, y2)) {
+            TCODFOV_access_set(fov, kind, x2, y2, true);
           }
         }
       }
     }
   }
 }
+/**
+    Spread lighting to walls for all four quadrants around the POV.
+ */
+TCODFOV_FORCE_INLINE void TCODFOV_map_postprocess_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int x_min,
+    int y_min,
+    int x_max,
+    int y_max,
+    const TCODFOV_MapKind kind) {
+  TCODFOV_map_postprocess_quadrant(transparent, fov, x_min, y_min, pov_x, pov_y, -1, -1, kind);
+  TCODFOV_map_postprocess_quadrant(transparent, fov, pov_x, y_min, x_max - 1, pov_y, 1, -1, kind);
+  TCODFOV_map_postprocess_quadrant(transparent, fov, x_min, pov_y, pov_x, y_max - 1, -1, 1, kind);
+  TCODFOV_map_postprocess_quadrant(transparent, fov, pov_x, pov_y, x_max - 1, y_max - 1, 1, 1, kind);
+}
 /**
     Spread lighting to walls to avoid lighting artifacts.
  */
@@ -152,12 +199,141 @@ TCODFOV_Error TCODFOV_map_postprocess(
     x_max = TCODFOV_MIN(x_max, pov_x + radius + 1);
     y_max = TCODFOV_MIN(y_max, pov_y + radius + 1);
   }
-  TCODFOV_map_postprocess_quadrant(transparent, fov, x_min, y_min, pov_x, pov_y, -1, -1);
-  TCODFOV_map_postprocess_quadrant(transparent, fov, pov_x, y_min, x_max - 1, pov_y, 1, -1);
-  TCODFOV_map_postprocess_quadrant(transparent, fov, x_min, pov_y, pov_x, y_max - 1, -1, 1);
-  TCODFOV_map_postprocess_quadrant(transparent, fov, pov_x, pov_y, x_max - 1, y_max - 1, 1, 1);
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  TCODFOV_MAP_KIND_SWITCH(
+      kind,
+      K,
+      TCODFOV_map_postprocess_kind(&transparent_access, &fov_access, pov_x, pov_y, x_min, y_min, x_max, y_max, K));
   return TCODFOV_E_OK;
 }
+TCODFOV_Rect TCODFOV_map2d_fov_bounds_(const TCODFOV_Map2D* __restrict fov, int pov_x, int pov_y, int max_radius) {
+  int x_min = 0;
+  int y_min = 0;
+  int x_max = TCODFOV_map2d_get_width(fov);
+  int y_max = TCODFOV_map2d_get_height(fov);
+  if (max_radius > 0) {
+    x_min = TCODFOV_MAX(x_min, pov_x - max_radius);
+    y_min = TCODFOV_MAX(y_min, pov_y - max_radius);
+    x_max = TCODFOV_MIN(x_max, pov_x + max_radius + 1);
+    y_max = TCODFOV_MIN(y_max, pov_y + max_radius + 1);
+  }
+  return (TCODFOV_Rect){x_min, y_min, x_max - x_min, y_max - y_min};
+}
+/**
+    Call the field-of-view function for `algo`.  `workspace` must not be NULL.
+ */
+static TCODFOV_Error TCODFOV_map_compute_fov_2d_dispatch(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_Workspace* __restrict workspace) {
+  switch (algo) {
+    case TCODFOV_BASIC:
+      return TCODFOV_map_compute_fov_circular_raycasting_(
+          transparent, fov, pov_x, pov_y, max_radius, light_walls, workspace);
+    case TCODFOV_DIAMOND:
+      return TCODFOV_map_compute_fov_diamond_raycasting_(
+          transparent, fov, pov_x, pov_y, max_radius, light_walls, workspace);
+    case TCODFOV_SHADOW:
+      return TCODFOV_map_compute_fov_recursive_shadowcasting(transparent, fov, pov_x, pov_y, max_radius, light_walls);
+    case TCODFOV_PERMISSIVE_0:
+    case TCODFOV_PERMISSIVE_1:
+    case TCODFOV_PERMISSIVE_2:
+    case TCODFOV_PERMISSIVE_3:
+    case TCODFOV_PERMISSIVE_4:
+    case TCODFOV_PERMISSIVE_5:
+    case TCODFOV_PERMISSIVE_6:
+    case TCODFOV_PERMISSIVE_7:
+    case TCODFOV_PERMISSIVE_8:
+      return TCODFOV_map_compute_fov_permissive2_(
+          transparent, fov, pov_x, pov_y, max_radius, light_walls, algo - TCODFOV_PERMISSIVE_0, workspace);
+    case TCODFOV_RESTRICTIVE:
+      return TCODFOV_map_compute_fov_restrictive_shadowcasting_(
+          transparent, fov, pov_x, pov_y, max_radius, light_walls, workspace);
+    case TCODFOV_SYMMETRIC_SHADOWCAST:
+      return TCODFOV_map_compute_fov_symmetric_shadowcast(transparent, fov, pov_x, pov_y, max_radius, light_walls);
+    default:
+      TCODFOV_set_errorvf("Invalid field-of-view algorithm %i.", (int)algo);
+      return TCODFOV_E_INVALID_ARGUMENT;
+  }
+}
+TCODFOV_Error TCODFOV_map_compute_fov_2d(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_Workspace* __restrict workspace,
+    TCODFOV_Rect* __restrict dirty) {
+  if (dirty) *dirty = (TCODFOV_Rect){0, 0, 0, 0};
+  TCODFOV_Workspace temp_workspace = {0};
+  const TCODFOV_Error err = TCODFOV_map_compute_fov_2d_dispatch(
+      transparent, fov, pov_x, pov_y, max_radius, light_walls, algo, workspace ? workspace : &temp_workspace);
+  TCODFOV_workspace_release_(&temp_workspace);
+  if (err < 0 || !dirty) return err;
+  *dirty = TCODFOV_map2d_fov_bounds_(fov, pov_x, pov_y, max_radius);
+  return err;
+}
+/**
+    Set the tiles of `map` in `[x_begin, x_end)` of row `y` to false.
+ */
+TCODFOV_FORCE_INLINE void TCODFOV_map2d_clear_row(
+    TCODFOV_MapAccess* __restrict map, int x_begin, int x_end, int y, const TCODFOV_MapKind kind) {
+  switch (kind) {
+    case TCODFOV_MAP_KIND_BITPACKED:
+      TCODFOV_bitpacked_row_fill(map, x_begin, x_end, y, false);
+      return;
+    case TCODFOV_MAP_KIND_BOOL:
+    case TCODFOV_MAP_KIND_UINT8:
+      memset(map->data + map->y_stride * y + x_begin, 0, (size_t)(x_end - x_begin));
+      return;
+    case TCODFOV_MAP_KIND_EPOCH:
+      memset((uint32_t*)map->data + map->y_stride * y + x_begin, 0, sizeof(uint32_t) * (size_t)(x_end - x_begin));
+      return;
+    default:
+      for (int x = x_begin; x < x_end; ++x) TCODFOV_access_set(map, kind, x, y, false);
+      return;
+  }
+}
+TCODFOV_Error TCODFOV_map2d_clear_rect(TCODFOV_Map2D* __restrict map, TCODFOV_Rect rect) {
+  if (!map) {
+    TCODFOV_set_errorv("Map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  TCODFOV_MapAccess access;
+  TCODFOV_map_access_init(&access, map);
+  TCODFOV_MapKind kind = TCODFOV_map_kind_of_(map);
+  if (map->type == TCODFOV_MAP2D_EPOCH) kind = TCODFOV_MAP_KIND_EPOCH;
+  const int x_begin = TCODFOV_MAX(rect.x, 0);
+  const int y_begin = TCODFOV_MAX(rect.y, 0);
+  const int x_end = TCODFOV_MIN(rect.x + rect.width, access.width);
+  const int y_end = TCODFOV_MIN(rect.y + rect.height, access.height);
+  if (x_begin >= x_end) return TCODFOV_E_OK;
+  for (int y = y_begin; y < y_end; ++y) {
+    TCODFOV_map2d_clear_row(&access, x_begin, x_end, y, kind);
+  }
+  return TCODFOV_E_OK;
+}
+/**
+    Return a bitpacked view of one of the planes of `map`.  The view is only read from when `map` is const.
+ */
+static TCODFOV_Map2D TCODFOV_map_plane_view(const TCODFOV_Map* __restrict map, uint8_t* plane) {
+  return (TCODFOV_Map2D){
+      .bitpacked = {
+          .type = TCODFOV_MAP2D_BITPACKED,
+          .shape = {map->height, map->width},
+          .data = plane,
+          .y_stride = map->y_stride,
+      }};
+}
 /**
     Reset the map FOV flag to zeros.
  */
@@ -165,9 +341,7 @@ static void TCODFOV_map_clear_fov(TCODFOV_Map* __restrict map) {
   if (!map) {
     return;
   }
-  for (int i = 0; i < map->nbcells; ++i) {
-    map->cells[i].fov = 0;
-  }
+  memset(map->fov, 0, TCODFOV_map_plane_size(map));
 }
 TCODFOV_Error TCODFOV_map_compute_fov(
     struct TCODFOV_Map* __restrict map,
@@ -185,58 +359,74 @@ TCODFOV_Error TCODFOV_map_compute_fov(
     return TCODFOV_E_INVALID_ARGUMENT;
   }
   TCODFOV_map_clear_fov(map);
-  const TCODFOV_Map2D transparent = {.deprecated_map = {.type = TCODFOV_MAP2D_DEPRECATED, .map = *map, .select = 0}};
-  TCODFOV_Map2D fov = {.deprecated_map = {.type = TCODFOV_MAP2D_DEPRECATED, .map = *map, .select = 2}};
-  switch (algo) {
-    case TCODFOV_BASIC:
-      return TCODFOV_map_compute_fov_circular_raycasting(&transparent, &fov, pov_x, pov_y, max_radius, light_walls);
-    case TCODFOV_DIAMOND:
-      return TCODFOV_map_compute_fov_diamond_raycasting(&transparent, &fov, pov_x, pov_y, max_radius, light_walls);
-    case TCODFOV_SHADOW:
-      return TCODFOV_map_compute_fov_recursive_shadowcasting(&transparent, &fov, pov_x, pov_y, max_radius, light_walls);
-    case TCODFOV_PERMISSIVE_0:
-    case TCODFOV_PERMISSIVE_1:
-    case TCODFOV_PERMISSIVE_2:
-    case TCODFOV_PERMISSIVE_3:
-    case TCODFOV_PERMISSIVE_4:
-    case TCODFOV_PERMISSIVE_5:
-    case TCODFOV_PERMISSIVE_6:
-    case TCODFOV_PERMISSIVE_7:
-    case TCODFOV_PERMISSIVE_8:
-      return TCODFOV_map_compute_fov_permissive2(
-          &transparent, &fov, pov_x, pov_y, max_radius, light_walls, algo - TCODFOV_PERMISSIVE_0);
-    case TCODFOV_RESTRICTIVE:
-      return TCODFOV_map_compute_fov_restrictive_shadowcasting(
-          &transparent, &fov, pov_x, pov_y, max_radius, light_walls);
-    case TCODFOV_SYMMETRIC_SHADOWCAST:
-      return TCODFOV_map_compute_fov_symmetric_shadowcast(&transparent, &fov, pov_x, pov_y, max_radius, light_walls);
-    default:
-      return TCODFOV_E_INVALID_ARGUMENT;
+  const TCODFOV_Map2D transparent = TCODFOV_map_plane_view(map, map->transparent);
+  TCODFOV_Map2D fov = TCODFOV_map_plane_view(map, map->fov);
+  return TCODFOV_map_compute_fov_2d(&transparent, &fov, pov_x, pov_y, max_radius, light_walls, algo, NULL, NULL);
+}
+TCODFOV_Error TCODFOV_map_compute_fov_into(
+    const struct TCODFOV_Map* __restrict map,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_Workspace* __restrict workspace,
+    TCODFOV_Rect* __restrict dirty) {
+  if (!map || !fov) {
+    TCODFOV_set_errorv("Map and output map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (TCODFOV_map2d_get_width(fov) != map->width || TCODFOV_map2d_get_height(fov) != map->height) {
+    TCODFOV_set_errorvf(
+        "Output map must be the same size as the map {%i, %i}, got {%i, %i}.",
+        map->width,
+        map->height,
+        TCODFOV_map2d_get_width(fov),
+        TCODFOV_map2d_get_height(fov));
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!TCODFOV_map_in_bounds(map, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (fov->type == TCODFOV_MAP2D_EPOCH) {
+    TCODFOV_map2d_epoch_advance(fov);
+  } else {
+    const TCODFOV_Error clear_err =
+        TCODFOV_map2d_clear_rect(fov, dirty ? *dirty : (TCODFOV_Rect){0, 0, map->width, map->height});
+    if (clear_err < 0) return clear_err;
   }
+  const TCODFOV_Map2D transparent = TCODFOV_map_plane_view(map, map->transparent);
+  const TCODFOV_Error err =
+      TCODFOV_map_compute_fov_2d(&transparent, fov, pov_x, pov_y, max_radius, light_walls, algo, workspace, dirty);
+  // A failed call may have written anywhere, so the next call must clear everything.
+  if (err < 0 && dirty) *dirty = (TCODFOV_Rect){0, 0, map->width, map->height};
+  return err;
 }
 bool TCODFOV_map_is_in_fov(const struct TCODFOV_Map* map, int x, int y) {
   if (!TCODFOV_map_in_bounds(map, x, y)) {
     return 0;
   }
-  return map->cells[x + y * map->width].fov;
+  return TCODFOV_map_plane_get(map, map->fov, x, y);
 }
 void TCODFOV_map_set_in_fov(struct TCODFOV_Map* map, int x, int y, bool fov) {
   if (!TCODFOV_map_in_bounds(map, x, y)) {
     return;
   }
-  map->cells[x + y * map->width].fov = fov;
+  TCODFOV_map_plane_set(map, map->fov, x, y, fov);
 }
 bool TCODFOV_map_is_transparent(const struct TCODFOV_Map* map, int x, int y) {
   if (!TCODFOV_map_in_bounds(map, x, y)) {
     return 0;
   }
-  return map->cells[x + y * map->width].transparent;
+  return TCODFOV_map_plane_get(map, map->transparent, x, y);
 }
 bool TCODFOV_map_is_walkable(struct TCODFOV_Map* map, int x, int y) {
   if (!TCODFOV_map_in_bounds(map, x, y)) {
     return 0;
   }
-  return map->cells[x + y * map->width].walkable;
+  return TCODFOV_map_plane_get(map, map->walkable, x, y);
 }
 int TCODFOV_map_get_width(const struct TCODFOV_Map* map) {
   if (!map) {
@@ -0,0 +1,608 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/** \file
+    A least-recently-used cache of field-of-view results.
+ */
+#include "fov_cache.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libtcod_int.h"
+#include "map_access.h"
+#include "map_inline.h"
+#include "map_types.h"
+#include "scratch.h"
+#include "utility.h"
+/**
+    Stored results are indexed by square cells of `1 << GRID_CELL_SHIFT` tiles on each side.
+ */
+#define GRID_CELL_SHIFT 5
+/**
+    The number of hash buckets of a new cache, always a power of two.
+ */
+#define INITIAL_BUCKET_COUNT 64
+/**
+    The most bytes a run length can take, enough for any `int`.
+ */
+#define VARINT_MAX_SIZE 5
+/**
+    A growable array of entry indexes.
+ */
+typedef struct IndexList {
+  int* items;
+  int count;
+  int capacity;
+} IndexList;
+/**
+    One stored field-of-view and its key.
+ */
+typedef struct CacheEntry {
+  bool active;  // False if this entry was removed and its index is free.
+  bool run_length;  // True if `data` holds run lengths, false if it holds the bits of `bounds`.
+  bool light_walls;
+  TCODFOV_fov_algorithm_t algo;
+  int pov_x;
+  int pov_y;
+  int max_radius;
+  uint32_t hash;
+  int next_in_bucket;  // The next entry of the same hash bucket, or -1.
+  int newer;  // The next more recently used entry, or -1 if this is the newest.
+  int older;  // The next less recently used entry, or -1 if this is the oldest.
+  TCODFOV_Rect bounds;  // The area within the radius, clipped to the map.
+  uint8_t* data;  // The tiles of `bounds`, row by row.
+  size_t size;  // Bytes of `data`.
+} CacheEntry;
+struct TCODFOV_FovCache {
+  int width;
+  int height;
+  size_t max_bytes;
+  CacheEntry* entries;
+  int entry_count;  // Number of entry indexes in use, including removed entries.
+  int entry_capacity;
+  IndexList free_entries;  // Indexes of removed entries.  Its capacity is always `entry_capacity`.
+  int* buckets;  // The first entry of each hash bucket, or -1.
+  int bucket_mask;  // The number of buckets minus one.
+  int newest;  // The most recently used entry, or -1 if the cache is empty.
+  int oldest;  // The least recently used entry, evicted first.
+  int grid_width;
+  int grid_height;
+  IndexList* grid;  // The entries whose bounds overlap each cell.
+  uint8_t* scratch;  // Buffer for encoding a result before it is stored.
+  size_t scratch_capacity;
+  TCODFOV_FovCacheStats stats;
+};
+/**
+    Grow `list` so that it can hold at least `capacity` items.
+ */
+static TCODFOV_Error index_list_reserve(IndexList* __restrict list, int capacity) {
+  if (capacity <= list->capacity) return TCODFOV_E_OK;
+  const int new_capacity = TCODFOV_MAX(capacity, list->capacity * 2);
+  int* new_items = realloc(list->items, sizeof(*new_items) * (size_t)new_capacity);
+  if (!new_items) {
+    TCODFOV_set_errorv("Out of memory.");
+    return TCODFOV_E_OUT_OF_MEMORY;
+  }
+  list->items = new_items;
+  list->capacity = new_capacity;
+  return TCODFOV_E_OK;
+}
+/**
+    Remove `item` from `list` if it is there.  The last item takes its place.
+ */
+static void index_list_remove(IndexList* __restrict list, int item) {
+  for (int i = 0; i < list->count; ++i) {
+    if (list->items[i] != item) continue;
+    list->items[i] = list->items[--list->count];
+    return;
+  }
+}
+/**
+    Return true if `x`, `y` is within `rect`.
+ */
+static bool rect_contains(TCODFOV_Rect rect, int x, int y) {
+  return rect.x <= x && rect.y <= y && x < rect.x + rect.width && y < rect.y + rect.height;
+}
+/**
+    Return the hash of a query.
+ */
+static uint32_t hash_key(int pov_x, int pov_y, int max_radius, TCODFOV_fov_algorithm_t algo, bool light_walls) {
+  uint32_t hash = (uint32_t)pov_x * 0x9E3779B1u;
+  hash = (hash ^ (uint32_t)pov_y) * 0x85EBCA77u;
+  hash = (hash ^ (uint32_t)max_radius) * 0xC2B2AE3Du;
+  hash = (hash ^ ((uint32_t)algo << 1 | (uint32_t)light_walls)) * 0x27D4EB2Fu;
+  return hash ^ (hash >> 15);
+}
+/**
+    Return the index of the entry with this key, or -1 if there is none.
+ */
+static int find_entry(
+    const TCODFOV_FovCache* __restrict cache,
+    uint32_t hash,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    TCODFOV_fov_algorithm_t algo,
+    bool light_walls) {
+  for (int i = cache->buckets[hash & (uint32_t)cache->bucket_mask]; i >= 0; i = cache->entries[i].next_in_bucket) {
+    const CacheEntry* entry = &cache->entries[i];
+    if (entry->hash == hash && entry->pov_x == pov_x && entry->pov_y == pov_y && entry->max_radius == max_radius &&
+        entry->algo == algo && entry->light_walls == light_walls) {
+      return i;
+    }
+  }
+  return -1;
+}
+/**
+    Remove entry `index` from the recently used list.
+ */
+static void lru_unlink(TCODFOV_FovCache* __restrict cache, int index) {
+  const CacheEntry* entry = &cache->entries[index];
+  if (entry->newer >= 0) {
+    cache->entries[entry->newer].older = entry->older;
+  } else {
+    cache->newest = entry->older;
+  }
+  if (entry->older >= 0) {
+    cache->entries[entry->older].newer = entry->newer;
+  } else {
+    cache->oldest = entry->newer;
+  }
+}
+/**
+    Add entry `index` to the recently used list as the newest entry.
+ */
+static void lru_push_newest(TCODFOV_FovCache* __restrict cache, int index) {
+  CacheEntry* entry = &cache->entries[index];
+  entry->newer = -1;
+  entry->older = cache->newest;
+  if (cache->newest >= 0) {
+    cache->entries[cache->newest].newer = index;
+  } else {
+    cache->oldest = index;
+  }
+  cache->newest = index;
+}
+/**
+    Free entry `index` and remove it from the hash buckets, the recently used list, and the grid.
+ */
+static void remove_entry(TCODFOV_FovCache* __restrict cache, int index) {
+  CacheEntry* entry = &cache->entries[index];
+  int* link = &cache->buckets[entry->hash & (uint32_t)cache->bucket_mask];
+  while (*link != index) link = &cache->entries[*link].next_in_bucket;
+  *link = entry->next_in_bucket;
+  lru_unlink(cache, index);
+  const TCODFOV_Rect bounds = entry->bounds;
+  for (int y = bounds.y >> GRID_CELL_SHIFT; y <= (bounds.y + bounds.height - 1) >> GRID_CELL_SHIFT; ++y) {
+    for (int x = bounds.x >> GRID_CELL_SHIFT; x <= (bounds.x + bounds.width - 1) >> GRID_CELL_SHIFT; ++x) {
+      index_list_remove(&cache->grid[y * cache->grid_width + x], index);
+    }
+  }
+  free(entry->data);
+  entry->data = NULL;
+  entry->active = false;
+  cache->stats.bytes -= entry->size + sizeof(*entry);
+  --cache->stats.count;
+  cache->free_entries.items[cache->free_entries.count++] = index;
+}
+/**
+    Make room for one more entry in the entry array, the hash buckets, and the cells overlapping `bounds`.
+ */
+static TCODFOV_Error reserve_entry(TCODFOV_FovCache* __restrict cache, TCODFOV_Rect bounds) {
+  if (cache->free_entries.count == 0 && cache->entry_count == cache->entry_capacity) {
+    const int new_capacity = TCODFOV_MAX(16, cache->entry_capacity * 2);
+    CacheEntry* new_entries = realloc(cache->entries, sizeof(*new_entries) * (size_t)new_capacity);
+    if (!new_entries) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+    cache->entries = new_entries;
+    const TCODFOV_Error err = index_list_reserve(&cache->free_entries, new_capacity);
+    if (err < 0) return err;
+    cache->entry_capacity = new_capacity;
+  }
+  if (cache->stats.count + 1 > cache->bucket_mask + 1) {  // Keep at most one entry per bucket on average.
+    const int new_count = (cache->bucket_mask + 1) * 2;
+    int* new_buckets = malloc(sizeof(*new_buckets) * (size_t)new_count);
+    if (!new_buckets) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+    for (int i = 0; i < new_count; ++i) new_buckets[i] = -1;
+    for (int i = 0; i < cache->entry_count; ++i) {
+      CacheEntry* entry = &cache->entries[i];
+      if (!entry->active) continue;
+      int* bucket = &new_buckets[entry->hash & (uint32_t)(new_count - 1)];
+      entry->next_in_bucket = *bucket;
+      *bucket = i;
+    }
+    free(cache->buckets);
+    cache->buckets = new_buckets;
+    cache->bucket_mask = new_count - 1;
+  }
+  for (int y = bounds.y >> GRID_CELL_SHIFT; y <= (bounds.y + bounds.height - 1) >> GRID_CELL_SHIFT; ++y) {
+    for (int x = bounds.x >> GRID_CELL_SHIFT; x <= (bounds.x + bounds.width - 1) >> GRID_CELL_SHIFT; ++x) {
+      IndexList* cell = &cache->grid[y * cache->grid_width + x];
+      const TCODFOV_Error err = index_list_reserve(cell, cell->count + 1);
+      if (err < 0) return err;
+    }
+  }
+  return TCODFOV_E_OK;
+}
+/**
+    Write `value` to `out` 7 bits at a time and return the end of what was written.
+ */
+static uint8_t* write_varint(uint8_t* __restrict out, uint32_t value) {
+  while (value >= 0x80) {
+    *out++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (uint8_t)value;
+  return out;
+}
+/**
+    Read a value written by `write_varint` into `value` and return the end of what was read.
+ */
+static const uint8_t* read_varint(const uint8_t* __restrict in, int* __restrict value) {
+  uint32_t result = 0;
+  for (int shift = 0;; shift += 7) {
+    const uint8_t byte = *in++;
+    result |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) break;
+  }
+  *value = (int)result;
+  return in;
+}
+/**
+    Return the first tile in `[x, x_end)` of row `y` which is not `value`, or `x_end` if there is none.
+ */
+TCODFOV_FORCE_INLINE int find_run_end_kind(
+    const TCODFOV_MapAccess* __restrict access, int x, int x_end, int y, bool value, const TCODFOV_MapKind kind) {
+  if (kind == TCODFOV_MAP_KIND_BITPACKED) return TCODFOV_bitpacked_row_find_next(access, x, x_end, y, value);
+  while (x < x_end && TCODFOV_access_get(access, kind, x, y) == value) ++x;
+  return x;
+}
+/**
+    Write the tiles of `bounds` to `out` as alternating runs of false and true tiles, starting with false.
+
+    Returns the number of bytes written, or `SIZE_MAX` if it would be more than `limit`.
+    `out` must have room for `limit` bytes plus one row of runs.
+ */
+TCODFOV_FORCE_INLINE size_t encode_runs_kind(
+    const TCODFOV_MapAccess* __restrict access,
+    TCODFOV_Rect bounds,
+    uint8_t* __restrict out,
+    size_t limit,
+    const TCODFOV_MapKind kind) {
+  uint8_t* cursor = out;
+  for (int y = bounds.y; y < bounds.y + bounds.height; ++y) {
+    if ((size_t)(cursor - out) > limit) return SIZE_MAX;
+    const int x_end = bounds.x + bounds.width;
+    bool value = false;
+    for (int x = bounds.x; x < x_end; value = !value) {
+      const int run_end = find_run_end_kind(access, x, x_end, y, value, kind);
+      cursor = write_varint(cursor, (uint32_t)(run_end - x));
+      x = run_end;
+    }
+  }
+  const size_t size = (size_t)(cursor - out);
+  return size > limit ? SIZE_MAX : size;
+}
+/**
+    Write the tiles of `bounds` which were encoded by `encode_runs_kind` back to `access`.
+ */
+TCODFOV_FORCE_INLINE void decode_runs_kind(
+    TCODFOV_MapAccess* __restrict access,
+    TCODFOV_Rect bounds,
+    const uint8_t* __restrict in,
+    const TCODFOV_MapKind kind) {
+  for (int y = bounds.y; y < bounds.y + bounds.height; ++y) {
+    const int x_end = bounds.x + bounds.width;
+    bool value = false;
+    for (int x = bounds.x; x < x_end; value = !value) {
+      int run;
+      in = read_varint(in, &run);
+      if (kind == TCODFOV_MAP_KIND_BITPACKED) {
+        TCODFOV_bitpacked_row_fill(access, x, x + run, y, value);
+      } else {
+        for (int i = x; i < x + run; ++i) TCODFOV_access_set(access, kind, i, y, value);
+      }
+      x += run;
+    }
+  }
+}
+/**
+    Write the tiles of `bounds` to `out` as bits, each row starting on a new byte.  `out` must be zeroed.
+ */
+TCODFOV_FORCE_INLINE void encode_bits_kind(
+    const TCODFOV_MapAccess* __restrict access,
+    TCODFOV_Rect bounds,
+    uint8_t* __restrict out,
+    const TCODFOV_MapKind kind) {
+  const ptrdiff_t y_stride = (bounds.width + 7) >> 3;
+  for (int y = 0; y < bounds.height; ++y, out += y_stride) {
+    if (kind == TCODFOV_MAP_KIND_BITPACKED) {
+      for (int x = 0; x < bounds.width; x += 64) {
+        uint64_t word = TCODFOV_bitpacked_row_load64(access, bounds.x + x, bounds.y + y);
+        if (bounds.width - x < 64) word &= ((uint64_t)1 << (bounds.width - x)) - 1;
+        for (int i = x >> 3; word; ++i, word >>= 8) out[i] = (uint8_t)word;
+      }
+    } else {
+      for (int x = 0; x < bounds.width; ++x) {
+        if (TCODFOV_access_get(access, kind, bounds.x + x, bounds.y + y)) out[x >> 3] |= (uint8_t)(1u << (x & 7));
+      }
+    }
+  }
+}
+/**
+    Write the tiles of `bounds` which were encoded by `encode_bits_kind` back to `access`.
+ */
+TCODFOV_FORCE_INLINE void decode_bits_kind(
+    TCODFOV_MapAccess* __restrict access,
+    TCODFOV_Rect bounds,
+    const uint8_t* __restrict in,
+    const TCODFOV_MapKind kind) {
+  const ptrdiff_t y_stride = (bounds.width + 7) >> 3;
+  for (int y = 0; y < bounds.height; ++y, in += y_stride) {
+    if (kind == TCODFOV_MAP_KIND_BITPACKED) {
+      TCODFOV_bitpacked_row_fill(access, bounds.x, bounds.x + bounds.width, bounds.y + y, false);
+      for (int x = 0; x < bounds.width; x += 64) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8 && (x >> 3) + i < y_stride; ++i) word |= (uint64_t)in[(x >> 3) + i] << (i * 8);
+        TCODFOV_bitpacked_row_or64(access, bounds.x + x, bounds.y + y, word);
+      }
+    } else {
+      for (int x = 0; x < bounds.width; ++x) {
+        TCODFOV_access_set(access, kind, bounds.x + x, bounds.y + y, (in[x >> 3] >> (x & 7)) & 1);
+      }
+    }
+  }
+}
+/**
+    Store the result in `bounds` of `fov` under the given key, evicting the oldest entries as needed.
+ */
+static TCODFOV_Error store_result(
+    TCODFOV_FovCache* __restrict cache,
+    const TCODFOV_Map2D* __restrict fov,
+    TCODFOV_Rect bounds,
+    uint32_t hash,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    TCODFOV_fov_algorithm_t algo,
+    bool light_walls) {
+  const size_t bits_size = (size_t)((bounds.width + 7) >> 3) * (size_t)bounds.height;
+  const size_t scratch_size = bits_size + (size_t)(bounds.width + 1) * VARINT_MAX_SIZE;
+  if (scratch_size > cache->scratch_capacity) {
+    uint8_t* new_scratch = realloc(cache->scratch, scratch_size);
+    if (!new_scratch) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+    cache->scratch = new_scratch;
+    cache->scratch_capacity = scratch_size;
+  }
+  TCODFOV_MapAccess access;
+  TCODFOV_map_access_init(&access, fov);
+  const TCODFOV_MapKind kind = TCODFOV_map_kind_of_(fov);
+  size_t size = SIZE_MAX;
+  TCODFOV_MAP_KIND_SWITCH(kind, K, size = encode_runs_kind(&access, bounds, cache->scratch, bits_size, K));
+  const bool run_length = size != SIZE_MAX;
+  if (!run_length) {  // Ragged results are smaller as bits.
+    size = bits_size;
+    memset(cache->scratch, 0, size);
+    TCODFOV_MAP_KIND_SWITCH(kind, K, encode_bits_kind(&access, bounds, cache->scratch, K));
+  }
+  if (size + sizeof(CacheEntry) > cache->max_bytes) return TCODFOV_E_OK;  // This result can never be stored.
+  TCODFOV_Error err = reserve_entry(cache, bounds);
+  if (err < 0) return err;
+  uint8_t* data = malloc(size);
+  if (!data) {
+    TCODFOV_set_errorv("Out of memory.");
+    return TCODFOV_E_OUT_OF_MEMORY;
+  }
+  memcpy(data, cache->scratch, size);
+  while (cache->stats.bytes + size + sizeof(CacheEntry) > cache->max_bytes) {
+    remove_entry(cache, cache->oldest);
+    ++cache->stats.evictions;
+  }
+  const int index =
+      cache->free_entries.count > 0 ? cache->free_entries.items[--cache->free_entries.count] : cache->entry_count++;
+  CacheEntry* entry = &cache->entries[index];
+  *entry = (CacheEntry){
+      .active = true,
+      .run_length = run_length,
+      .light_walls = light_walls,
+      .algo = algo,
+      .pov_x = pov_x,
+      .pov_y = pov_y,
+      .max_radius = max_radius,
+      .hash = hash,
+      .next_in_bucket = cache->buckets[hash & (uint32_t)cache->bucket_mask],
+      .bounds = bounds,
+      .data = data,
+      .size = size,
+  };
+  cache->buckets[hash & (uint32_t)cache->bucket_mask] = index;
+  lru_push_newest(cache, index);
+  for (int y = bounds.y >> GRID_CELL_SHIFT; y <= (bounds.y + bounds.height - 1) >> GRID_CELL_SHIFT; ++y) {
+    for (int x = bounds.x >> GRID_CELL_SHIFT; x <= (bounds.x + bounds.width - 1) >> GRID_CELL_SHIFT; ++x) {
+      IndexList* cell = &cache->grid[y * cache->grid_width + x];
+      cell->items[cell->count++] = index;
+    }
+  }
+  cache->stats.bytes += size + sizeof(CacheEntry);
+  ++cache->stats.count;
+  return TCODFOV_E_OK;
+}
+TCODFOV_FovCache* TCODFOV_fov_cache_new(int width, int height, size_t max_bytes) {
+  if (width <= 0 || height <= 0) {
+    TCODFOV_set_errorvf("Map size must be positive, got {%i, %i}.", width, height);
+    return NULL;
+  }
+  const int grid_width = ((width - 1) >> GRID_CELL_SHIFT) + 1;
+  const int grid_height = ((height - 1) >> GRID_CELL_SHIFT) + 1;
+  TCODFOV_FovCache* cache = calloc(1, sizeof(*cache));
+  IndexList* grid = calloc((size_t)grid_width * (size_t)grid_height, sizeof(*grid));
+  int* buckets = malloc(sizeof(*buckets) * INITIAL_BUCKET_COUNT);
+  if (!cache || !grid || !buckets) {
+    free(cache);
+    free(grid);
+    free(buckets);
+    TCODFOV_set_errorv("Out of memory.");
+    return NULL;
+  }
+  for (int i = 0; i < INITIAL_BUCKET_COUNT; ++i) buckets[i] = -1;
+  cache->width = width;
+  cache->height = height;
+  cache->max_bytes = max_bytes;
+  cache->buckets = buckets;
+  cache->bucket_mask = INITIAL_BUCKET_COUNT - 1;
+  cache->newest = -1;
+  cache->oldest = -1;
+  cache->grid_width = grid_width;
+  cache->grid_height = grid_height;
+  cache->grid = grid;
+  return cache;
+}
+void TCODFOV_fov_cache_delete(TCODFOV_FovCache* cache) {
+  if (!cache) return;
+  for (int i = 0; i < cache->entry_count; ++i) free(cache->entries[i].data);
+  for (int i = 0; i < cache->grid_width * cache->grid_height; ++i) free(cache->grid[i].items);
+  free(cache->grid);
+  free(cache->entries);
+  free(cache->free_entries.items);
+  free(cache->buckets);
+  free(cache->scratch);
+  free(cache);
+}
+TCODFOV_Error TCODFOV_fov_cache_compute(
+    TCODFOV_FovCache* __restrict cache,
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_Workspace* __restrict workspace,
+    TCODFOV_Rect* __restrict dirty) {
+  if (!cache) {
+    TCODFOV_set_errorv("Cache must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!transparent || !fov) {
+    TCODFOV_set_errorv("Maps must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (TCODFOV_map2d_get_width(transparent) != cache->width || TCODFOV_map2d_get_height(transparent) != cache->height ||
+      TCODFOV_map2d_get_width(fov) != cache->width || TCODFOV_map2d_get_height(fov) != cache->height) {
+    TCODFOV_set_errorvf("Maps must be the same size as the cache {%i, %i}.", cache->width, cache->height);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!TCODFOV_map2d_in_bounds(fov, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  const TCODFOV_Rect bounds = TCODFOV_map2d_fov_bounds_(fov, pov_x, pov_y, max_radius);
+  const uint32_t hash = hash_key(pov_x, pov_y, max_radius, algo, light_walls);
+  const int index = find_entry(cache, hash, pov_x, pov_y, max_radius, algo, light_walls);
+  if (index >= 0) {
+    const CacheEntry* entry = &cache->entries[index];
+    TCODFOV_MapAccess access;
+    TCODFOV_map_access_init(&access, fov);
+    if (entry->run_length) {
+      TCODFOV_MAP_KIND_SWITCH(TCODFOV_map_kind_of_(fov), K, decode_runs_kind(&access, bounds, entry->data, K));
+    } else {
+      TCODFOV_MAP_KIND_SWITCH(TCODFOV_map_kind_of_(fov), K, decode_bits_kind(&access, bounds, entry->data, K));
+    }
+    lru_unlink(cache, index);
+    lru_push_newest(cache, index);
+    ++cache->stats.hits;
+    if (dirty) *dirty = bounds;
+    return TCODFOV_E_OK;
+  }
+  TCODFOV_Error err = TCODFOV_map2d_clear_rect(fov, bounds);
+  if (err < 0) return err;
+  err = TCODFOV_map_compute_fov_2d(transparent, fov, pov_x, pov_y, max_radius, light_walls, algo, workspace, NULL);
+  if (err < 0) return err;
+  ++cache->stats.misses;
+  if (dirty) *dirty = bounds;
+  // The result is already in `fov`, so failing to store it only costs a recompute later.
+  store_result(cache, fov, bounds, hash, pov_x, pov_y, max_radius, algo, light_walls);
+  return TCODFOV_E_OK;
+}
+TCODFOV_Error TCODFOV_fov_cache_mark_changed(
+    TCODFOV_FovCache* __restrict cache, int count, const TCODFOV_Point* __restrict points) {
+  if (!cache) {
+    TCODFOV_set_errorv("Cache must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count < 0) {
+    TCODFOV_set_errorvf("Tile count must not be negative, got %i.", count);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count > 0 && !points) {
+    TCODFOV_set_errorv("Tile array must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (points[i].x < 0 || points[i].y < 0 || points[i].x >= cache->width || points[i].y >= cache->height) {
+      TCODFOV_set_errorvf("Tile {%i, %i} at index %i is out of bounds.", points[i].x, points[i].y, i);
+      return TCODFOV_E_INVALID_ARGUMENT;
+    }
+  }
+  for (int i = 0; i < count; ++i) {
+    const int x = points[i].x;
+    const int y = points[i].y;
+    const IndexList* cell = &cache->grid[(y >> GRID_CELL_SHIFT) * cache->grid_width + (x >> GRID_CELL_SHIFT)];
+    // Removing an entry moves the last item of the cell into its place, so iterate backwards.
+    for (int j = cell->count - 1; j >= 0; --j) {
+      if (!rect_contains(cache->entries[cell->items[j]].bounds, x, y)) continue;
+      remove_entry(cache, cell->items[j]);
+      ++cache->stats.invalidations;
+    }
+  }
+  return TCODFOV_E_OK;
+}
+void TCODFOV_fov_cache_clear(TCODFOV_FovCache* cache) {
+  if (!cache) return;
+  for (int i = 0; i < cache->entry_count; ++i) {
+    if (cache->entries[i].active) remove_entry(cache, i);
+  }
+}
+TCODFOV_FovCacheStats TCODFOV_fov_cache_get_stats(const TCODFOV_FovCache* cache) {
+  return cache ? cache->stats : (TCODFOV_FovCacheStats){0};
+}
@@ -31,15 +31,19 @@
  */
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "bresenham.h"
 #include "fov.h"
 #include "libtcod_int.h"
+#include "map_access.h"
 #include "map_inline.h"
 #include "map_types.h"
+#include "scratch.h"
 #include "utility.h"
+#include "work_stack.h"
 /**
     Cast a Bresenham ray marking tiles along the line as lit.
 
@@ -47,21 +51,22 @@
 
     If `light_walls` is true then blocking walls are marked as visible.
  */
-static void cast_ray(
-    const TCODFOV_Map2D* __restrict transparent,
-    TCODFOV_Map2D* __restrict fov,
+TCODFOV_FORCE_INLINE void cast_ray(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
     int x_origin,
     int y_origin,
     int x_dest,
     int y_dest,
     int radius_squared,
-    bool light_walls) {
+    bool light_walls,
+    const TCODFOV_MapKind kind) {
   TCODFOV_bresenham_data_t bresenham_data;
   int current_x;
   int current_y;
   TCODFOV_line_init_mt(x_origin, y_origin, x_dest, y_dest, &bresenham_data);
   while (!TCODFOV_line_step_mt(&current_x, &current_y, &bresenham_data)) {
-    if (!TCODFOV_map2d_in_bounds(fov, current_x, current_y)) {
+    if (!TCODFOV_access_in_bounds(fov, current_x, current_y)) {
       return;  // Out of bounds.
     }
     if (radius_squared > 0) {
@@ -71,21 +76,297 @@ static void cast_ray(
         return;  // Outside of radius.
       }
     }
-    if (!TCODFOV_map2d_get_bool(transparent, current_x, current_y)) {
-      if (light_walls) TCODFOV_map2d_set_bool(fov, current_x, current_y, true);
+    if (!TCODFOV_access_get(transparent, kind, current_x, current_y)) {
+      if (light_walls) TCODFOV_access_set(fov, kind, current_x, current_y, true);
       return;  // Blocked by wall.
     }
     // Tile is transparent.
-    TCODFOV_map2d_set_bool(fov, current_x, current_y, true);
+    TCODFOV_access_set(fov, kind, current_x, current_y, true);
   }
 }
-TCODFOV_Error TCODFOV_map_compute_fov_circular_raycasting(
+/**
+    Return true if `{x, y}` is on the edge of `rect`.
+ */
+static inline bool on_rect_edge(const TCODFOV_Rect* __restrict rect, int x, int y) {
+  return x == rect->x || y == rect->y || x == rect->x + rect->width - 1 || y == rect->y + rect->height - 1;
+}
+/**
+    Cast rays from the POV to every tile along the perimeter of the given bounds.
+
+    Rays to tiles on the edge of `skip` are not cast.  `skip` may be NULL.
+ */
+TCODFOV_FORCE_INLINE void cast_perimeter_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int x_min,
+    int y_min,
+    int x_max,
+    int y_max,
+    const TCODFOV_Rect* __restrict skip,
+    int radius_squared,
+    bool light_walls,
+    const TCODFOV_MapKind kind) {
+  for (int x = x_min; x < x_max; ++x) {
+    if (skip && on_rect_edge(skip, x, y_min)) continue;
+    cast_ray(transparent, fov, pov_x, pov_y, x, y_min, radius_squared, light_walls, kind);
+  }
+  for (int y = y_min + 1; y < y_max; ++y) {
+    if (skip && on_rect_edge(skip, x_max - 1, y)) continue;
+    cast_ray(transparent, fov, pov_x, pov_y, x_max - 1, y, radius_squared, light_walls, kind);
+  }
+  for (int x = x_max - 2; x >= x_min; --x) {
+    if (skip && on_rect_edge(skip, x, y_max - 1)) continue;
+    cast_ray(transparent, fov, pov_x, pov_y, x, y_max - 1, radius_squared, light_walls, kind);
+  }
+  for (int y = y_max - 2; y > y_min; --y) {
+    if (skip && on_rect_edge(skip, x_min, y)) continue;
+    cast_ray(transparent, fov, pov_x, pov_y, x_min, y, radius_squared, light_walls, kind);
+  }
+}
+/// The largest width or height of the unclipped bounds for which a ray trie is built.
+/// At 256 the trie has about 120k nodes, about 2 MB of the workspace, and building it briefly takes about 4 MB more.
+/// The node count grows with the square of the size, while the walk saves less over casting rays on larger bounds.
+#define RAY_TRIE_MAX_SIZE 256
+typedef struct TCODFOV_RayTrie RayTrie;
+/**
+    A tile of the ray trie, relative to the point-of-view.
+
+    Every ray cast by this algorithm is a path from the point-of-view through the trie.  Rays which share their first
+    tiles share the nodes for those tiles, so these tiles are checked once instead of once per ray.
+
+    Nodes are stored in breadth-first order with the point-of-view at index zero, so the children of a node are the
+    nodes from its `first_child` up to the `first_child` of the next node.  The trie ends with a sentinel node.
+
+    The rays are numbered in depth-first order, so the rays through a node are the range from `leaf_begin` to
+    `leaf_end`.
+ */
+typedef struct RayNode {
+  int16_t x;
+  int16_t y;
+  int first_child;
+  int leaf_begin;
+  int leaf_end;
+} RayNode;
+/**
+    The tile a ray of the trie ends on, relative to the point-of-view.
+ */
+typedef struct RayLeaf {
+  int16_t x;
+  int16_t y;
+} RayLeaf;
+/**
+    A trie node while the trie is being built.  Nodes are referred to by their index since the array can move.
+ */
+typedef struct RayBuildNode {
+  int x;
+  int y;
+  int first_child;  // -1 if this node has no children.
+  int next_sibling;  // -1 if this is the last child.
+} RayBuildNode;
+static inline RayBuildNode* build_node(const TCODFOV_WorkStack* __restrict nodes, int index) {
+  return (RayBuildNode*)nodes->data + index;
+}
+/**
+    Add the Bresenham ray from the point-of-view to `{x_dest, y_dest}` to the trie.
+ */
+static TCODFOV_Error ray_trie_add(TCODFOV_WorkStack* __restrict nodes, int x_dest, int y_dest) {
+  TCODFOV_bresenham_data_t bresenham_data;
+  int x;
+  int y;
+  int current = 0;
+  TCODFOV_line_init_mt(0, 0, x_dest, y_dest, &bresenham_data);
+  while (!TCODFOV_line_step_mt(&x, &y, &bresenham_data)) {
+    int child = build_node(nodes, current)->first_child;
+    while (child >= 0 && (build_node(nodes, child)->x != x || build_node(nodes, child)->y != y)) {
+      child = build_node(nodes, child)->next_sibling;
+    }
+    if (child < 0) {
+      const RayBuildNode new_node = {
+          .x = x, .y = y, .first_child = -1, .next_sibling = build_node(nodes, current)->first_child};
+      child = (int)nodes->count;
+      const TCODFOV_Error err = TCODFOV_work_stack_push(nodes, &new_node);
+      if (err < 0) return err;
+      build_node(nodes, current)->first_child = child;
+    }
+    current = child;
+  }
+  return TCODFOV_E_OK;
+}
+/**
+    Return the arrays which follow the nodes of `trie`.
+ */
+static inline RayLeaf* ray_trie_leaves(const RayTrie* __restrict trie) {
+  return (RayLeaf*)((RayNode*)trie->data + trie->count + 1);
+}
+static inline int* ray_trie_frontier(const RayTrie* __restrict trie) {
+  return (int*)(ray_trie_leaves(trie) + trie->leaf_count);
+}
+static inline int* ray_trie_leaves_in_map(const RayTrie* __restrict trie) {
+  return ray_trie_frontier(trie) + 2 * trie->frontier_capacity;
+}
+/**
+    Build the trie of rays to every tile along the perimeter of the bounds of `trie`, relative to the point-of-view.
+
+    The nodes are followed by the tile each ray ends on, two frontier arrays used while walking the trie, and a count
+    of the rays which end inside the map.
+    Returns NULL on errors.
+ */
+static RayNode* ray_trie_build(RayTrie* __restrict trie) {
+  const RayBuildNode root = {.first_child = -1, .next_sibling = -1};
+  TCODFOV_WorkStack nodes = TCODFOV_work_stack_init(NULL, 0, sizeof(root));
+  TCODFOV_Error err = TCODFOV_work_stack_push(&nodes, &root);
+  const int x_min = trie->x_min;
+  const int y_min = trie->y_min;
+  const int x_max = trie->x_max;
+  const int y_max = trie->y_max;
+  for (int x = x_min; x < x_max && err >= 0; ++x) err = ray_trie_add(&nodes, x, y_min);
+  for (int y = y_min + 1; y < y_max && err >= 0; ++y) err = ray_trie_add(&nodes, x_max - 1, y);
+  for (int x = x_max - 2; x >= x_min && err >= 0; --x) err = ray_trie_add(&nodes, x, y_max - 1);
+  for (int y = y_max - 2; y > y_min && err >= 0; --y) err = ray_trie_add(&nodes, x_min, y);
+  const int count = (int)nodes.count;
+  int leaf_count = 0;
+  for (int i = 0; i < count; ++i) leaf_count += build_node(&nodes, i)->first_child < 0;
+  // Each ray adds at most one node to each depth of the trie.
+  const int frontier_capacity = 2 * (x_max - x_min + y_max - y_min);
+  const size_t size = (count + 1) * sizeof(RayNode) + leaf_count * sizeof(RayLeaf) +
+                      (2 * frontier_capacity + leaf_count + 1) * sizeof(int);
+  trie->count = 0;
+  if (err >= 0 && size > trie->capacity) {
+    free(trie->data);  // Old contents are never kept.
+    trie->data = malloc(size);
+    trie->capacity = trie->data ? size : 0;
+    if (!trie->data) TCODFOV_set_errorv("Out of memory.");
+  }
+  RayNode* trie_nodes = err < 0 ? NULL : trie->data;
+  if (trie_nodes) {
+    // Assign breadth-first indexes using `trie_nodes` as the queue of build nodes, then convert them.
+    trie_nodes[0] = (RayNode){0, 0, 0, 0, 0};
+    int end = 1;
+    for (int i = 0; i < end; ++i) {
+      const int build_index = trie_nodes[i].first_child;
+      trie_nodes[i].first_child = end;
+      for (int child = build_node(&nodes, build_index)->first_child; child >= 0;
+           child = build_node(&nodes, child)->next_sibling) {
+        trie_nodes[end++] = (RayNode){
+            (int16_t)build_node(&nodes, child)->x, (int16_t)build_node(&nodes, child)->y, child, 0, 0};
+      }
+    }
+    trie_nodes[count] = (RayNode){0, 0, count, 0, 0};
+    // Count the rays through each node, children come after their parents.
+    for (int i = count - 1; i >= 0; --i) {
+      const int child_end = trie_nodes[i + 1].first_child;
+      int rays = trie_nodes[i].first_child == child_end;  // A node without children is the end of one ray.
+      for (int child = trie_nodes[i].first_child; child < child_end; ++child) rays += trie_nodes[child].leaf_end;
+      trie_nodes[i].leaf_end = rays;
+    }
+    // Number the rays so that the rays of each node follow each other.
+    trie->count = count;
+    trie->leaf_count = leaf_count;
+    trie->frontier_capacity = frontier_capacity;
+    RayLeaf* leaves = ray_trie_leaves(trie);
+    trie_nodes[0].leaf_begin = 0;
+    for (int i = 0; i < count; ++i) {
+      const int child_end = trie_nodes[i + 1].first_child;
+      int next_leaf = trie_nodes[i].leaf_begin;
+      trie_nodes[i].leaf_end += trie_nodes[i].leaf_begin;
+      if (trie_nodes[i].first_child == child_end) leaves[next_leaf] = (RayLeaf){trie_nodes[i].x, trie_nodes[i].y};
+      for (int child = trie_nodes[i].first_child; child < child_end; ++child) {
+        trie_nodes[child].leaf_begin = next_leaf;
+        next_leaf += trie_nodes[child].leaf_end;
+      }
+    }
+  }
+  TCODFOV_work_stack_free(&nodes);
+  return trie_nodes;
+}
+/**
+    Return the trie of `workspace` for the given unclipped bounds relative to the point-of-view.
+
+    The rays are cast directly on the first call with these bounds, so this returns NULL and remembers the bounds in
+    place of the least recently used trie.  A trie for them is built and walked on later calls.
+ */
+static RayTrie* ray_trie_find(TCODFOV_Workspace* __restrict workspace, int x_min, int y_min, int x_max, int y_max) {
+  RayTrie* oldest = &workspace->ray_tries[0];
+  for (int i = 0; i < TCODFOV_RAY_TRIE_CACHE_SIZE; ++i) {
+    RayTrie* trie = &workspace->ray_tries[i];
+    if (trie->seen && trie->x_min == x_min && trie->y_min == y_min && trie->x_max == x_max && trie->y_max == y_max) {
+      trie->last_used = ++workspace->ray_trie_clock;
+      return trie;
+    }
+    if (trie->last_used < oldest->last_used) oldest = trie;
+  }
+  oldest->seen = true;
+  oldest->count = 0;
+  oldest->x_min = x_min;
+  oldest->y_min = y_min;
+  oldest->x_max = x_max;
+  oldest->y_max = y_max;
+  oldest->last_used = ++workspace->ray_trie_clock;
+  return NULL;
+}
+/**
+    Walk the ray trie marking tiles as lit, one depth at a time.
+
+    `leaves_in_map[i]` is the number of rays before ray `i` which end inside the map, with one more element for the
+    total.  Tiles only on rays which leave the map are skipped.  `leaves_in_map` is NULL if every ray ends in the map.
+
+    `radius_squared` is the max distance or zero if there is no limit.
+
+    If `light_walls` is true then blocking walls are marked as visible.
+ */
+TCODFOV_FORCE_INLINE void cast_trie_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    const RayNode* __restrict trie,
+    const int* __restrict leaves_in_map,
+    int* __restrict frontier,  // Nodes whose rays continue, starts with the root.
+    int* __restrict next_frontier,
+    int pov_x,
+    int pov_y,
+    int radius_squared,
+    bool light_walls,
+    const TCODFOV_MapKind kind) {
+  int frontier_count = 1;
+  frontier[0] = 0;
+  while (frontier_count) {
+    int next_count = 0;
+    for (int i = 0; i < frontier_count; ++i) {
+      const int child_end = trie[frontier[i] + 1].first_child;
+      for (int child = trie[frontier[i]].first_child; child < child_end; ++child) {
+        const RayNode* node = &trie[child];
+        if (radius_squared > 0 && node->x * node->x + node->y * node->y > radius_squared) {
+          continue;  // Outside of radius.
+        }
+        if (leaves_in_map && leaves_in_map[node->leaf_end] == leaves_in_map[node->leaf_begin]) {
+          continue;  // Every ray through this tile leaves the map.
+        }
+        const int x = pov_x + node->x;
+        const int y = pov_y + node->y;
+        if (!TCODFOV_access_get(transparent, kind, x, y)) {
+          if (light_walls) TCODFOV_access_set(fov, kind, x, y, true);
+          continue;  // Blocked by wall.
+        }
+        // Tile is transparent.
+        TCODFOV_access_set(fov, kind, x, y, true);
+        next_frontier[next_count++] = child;
+      }
+    }
+    int* swap = frontier;
+    frontier = next_frontier;
+    next_frontier = swap;
+    frontier_count = next_count;
+  }
+}
+TCODFOV_Error TCODFOV_map_compute_fov_circular_raycasting_(
     const TCODFOV_Map2D* __restrict transparent,
     TCODFOV_Map2D* __restrict fov,
     int pov_x,
     int pov_y,
     int max_radius,
-    bool light_walls) {
+    bool light_walls,
+    TCODFOV_Workspace* __restrict workspace) {
   int x_min = 0;  // Field-of-view bounds.
   int y_min = 0;
   int x_max = TCODFOV_map2d_get_width(fov);
@@ -104,20 +385,107 @@ TCODFOV_Error TCODFOV_map_compute_fov_circular_raycasting(
 
   // Cast rays along the perimeter.
   const int radius_squared = max_radius * max_radius;
-  for (int x = x_min; x < x_max; ++x) {
-    cast_ray(transparent, fov, pov_x, pov_y, x, y_min, radius_squared, light_walls);
-  }
-  for (int y = y_min + 1; y < y_max; ++y) {
-    cast_ray(transparent, fov, pov_x, pov_y, x_max - 1, y, radius_squared, light_walls);
-  }
-  for (int x = x_max - 2; x >= x_min; --x) {
-    cast_ray(transparent, fov, pov_x, pov_y, x, y_max - 1, radius_squared, light_walls);
-  }
-  for (int y = y_max - 2; y > y_min; --y) {
-    cast_ray(transparent, fov, pov_x, pov_y, x_min, y, radius_squared, light_walls);
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  // The rays only depend on the bounds relative to the point-of-view.  Tries are kept for the bounds before they are
+  // clipped to the map, so that they are shared by points-of-view near the map edges.
+  const int box_x_min = max_radius > 0 ? -max_radius : x_min - pov_x;
+  const int box_y_min = max_radius > 0 ? -max_radius : y_min - pov_y;
+  const int box_x_max = max_radius > 0 ? max_radius + 1 : x_max - pov_x;
+  const int box_y_max = max_radius > 0 ? max_radius + 1 : y_max - pov_y;
+  RayTrie* trie =
+      box_x_max - box_x_min <= RAY_TRIE_MAX_SIZE && box_y_max - box_y_min <= RAY_TRIE_MAX_SIZE
+          ? ray_trie_find(workspace, box_x_min, box_y_min, box_x_max, box_y_max)
+          : NULL;
+  if (!trie) {
+    TCODFOV_MAP_KIND_SWITCH(
+        kind,
+        K,
+        cast_perimeter_kind(
+            &transparent_access,
+            &fov_access,
+            pov_x,
+            pov_y,
+            x_min,
+            y_min,
+            x_max,
+            y_max,
+            NULL,
+            radius_squared,
+            light_walls,
+            K));
+  } else {
+    const RayNode* trie_nodes = trie->count ? trie->data : ray_trie_build(trie);
+    if (!trie_nodes) return TCODFOV_E_OUT_OF_MEMORY;
+    const bool clipped = x_min - pov_x != box_x_min || y_min - pov_y != box_y_min || x_max - pov_x != box_x_max ||
+                         y_max - pov_y != box_y_max;
+    int* leaves_in_map = NULL;
+    if (clipped) {
+      // Rays to the unclipped perimeter are only cast when they end inside the map.
+      leaves_in_map = ray_trie_leaves_in_map(trie);
+      const RayLeaf* leaves = ray_trie_leaves(trie);
+      leaves_in_map[0] = 0;
+      for (int i = 0; i < trie->leaf_count; ++i) {
+        const int x = pov_x + leaves[i].x;
+        const int y = pov_y + leaves[i].y;
+        leaves_in_map[i + 1] = leaves_in_map[i] + (x_min <= x && x < x_max && y_min <= y && y < y_max);
+      }
+    }
+    int* frontier = ray_trie_frontier(trie);
+    int* next_frontier = frontier + trie->frontier_capacity;
+    TCODFOV_MAP_KIND_SWITCH(
+        kind,
+        K,
+        cast_trie_kind(
+            &transparent_access,
+            &fov_access,
+            trie_nodes,
+            leaves_in_map,
+            frontier,
+            next_frontier,
+            pov_x,
+            pov_y,
+            radius_squared,
+            light_walls,
+            K));
+    if (clipped) {
+      // The rays to the clipped edges of the bounds are not in the trie and are cast directly.
+      const TCODFOV_Rect box = {
+          pov_x + box_x_min, pov_y + box_y_min, box_x_max - box_x_min, box_y_max - box_y_min};
+      TCODFOV_MAP_KIND_SWITCH(
+          kind,
+          K,
+          cast_perimeter_kind(
+              &transparent_access,
+              &fov_access,
+              pov_x,
+              pov_y,
+              x_min,
+              y_min,
+              x_max,
+              y_max,
+              &box,
+              radius_squared,
+              light_walls,
+              K));
+    }
   }
   if (light_walls) {
     TCODFOV_map_postprocess(transparent, fov, pov_x, pov_y, max_radius);
   }
   return TCODFOV_E_OK;
 }
+TCODFOV_Error TCODFOV_map_compute_fov_circular_raycasting(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls) {
+  TCODFOV_Workspace workspace = {0};
+  const TCODFOV_Error err = TCODFOV_map_compute_fov_circular_raycasting_(
+      transparent, fov, pov_x, pov_y, max_radius, light_walls, &workspace);
+  TCODFOV_workspace_release_(&workspace);
+  return err;
+}
@@ -35,8 +35,10 @@
 
 #include "fov.h"
 #include "libtcod_int.h"
+#include "map_access.h"
 #include "map_inline.h"
 #include "map_types.h"
+#include "scratch.h"
 #include "utility.h"
 /**
     A discrete diamond raycast tile.
@@ -61,24 +63,26 @@ static int ray_length_sq(const RaycastTile* __restrict ray) {
     The diamond raycast state.
  */
 typedef struct DiamondFovState {
-  const TCODFOV_Map2D* __restrict transparent;
-  TCODFOV_Map2D* __restrict fov;
+  TCODFOV_MapAccess transparent;
+  TCODFOV_MapAccess fov;
   const int pov_x, pov_y;  // Fov origin point, the POV.
+  const int grid_x, grid_y;  // Map position of the first tile of `raymap_grid`.
+  const int grid_width, grid_height;  // Size of `raymap_grid`, the map clipped to the reachable radius.
   RaycastTile* __restrict const raymap_grid;  // Grid of temporary rays.
   RaycastTile* perimeter_last;  // Pointer to the last tile on the perimeter.
 } DiamondFovState;
 /**
     Return a pointer to the tile belonging relative to the POV.
 
-    Returns NULL if the tile would be out-of-bounds.
+    Returns NULL if the tile would be out-of-bounds of the map or of the ray grid.
  */
 static RaycastTile* get_ray(DiamondFovState* __restrict state, int relative_x, int relative_y) {
-  const int x = state->pov_x + relative_x;
-  const int y = state->pov_y + relative_y;
-  if (!TCODFOV_map2d_in_bounds(state->fov, x, y)) {
+  const int x = state->pov_x + relative_x - state->grid_x;
+  const int y = state->pov_y + relative_y - state->grid_y;
+  if (!(0 <= x && x < state->grid_width && 0 <= y && y < state->grid_height)) {
     return NULL;
   }
-  RaycastTile* ray = &state->raymap_grid[y * TCODFOV_map2d_get_width(state->fov) + x];
+  RaycastTile* ray = &state->raymap_grid[y * state->grid_width + x];
   ray->x_relative = relative_x;
   ray->y_relative = relative_y;
   return ray;
@@ -149,7 +153,8 @@ static void process_y_input(RaycastTile* __restrict new_ray, const RaycastTile*
 /**
     Combine this rays source tiles to tell how obscured `ray` is.
  */
-static void merge_input(const DiamondFovState* __restrict state, RaycastTile* __restrict ray) {
+TCODFOV_FORCE_INLINE void merge_input(
+    const DiamondFovState* __restrict state, RaycastTile* __restrict ray, const TCODFOV_MapKind kind) {
   const int x = ray->x_relative + state->pov_x;
   const int y = ray->y_relative + state->pov_y;
 
@@ -170,7 +175,7 @@ static void merge_input(const DiamondFovState* __restrict state, RaycastTile* __
   } else if (is_obscured(ray->x_input) && is_obscured(ray->y_input)) {
     ray->ignore = true;
   }
-  if (!ray->ignore && !TCODFOV_map2d_get_bool(state->transparent, x, y)) {
+  if (!ray->ignore && !TCODFOV_access_get(&state->transparent, kind, x, y)) {
     ray->x_error = ray->x_obscurity = TCODFOV_ABS(ray->x_relative);
     ray->y_error = ray->y_obscurity = TCODFOV_ABS(ray->y_relative);
   }
@@ -195,13 +200,46 @@ static void expand_perimeter_from(DiamondFovState* __restrict state, const Rayca
     process_ray(state, get_ray(state, ray->x_relative, ray->y_relative - 1), ray);
   }
 }
-TCODFOV_Error TCODFOV_map_compute_fov_diamond_raycasting(
+/**
+    Iterate over the diamond perimeter starting from `current_ray` and mark visible tiles.
+ */
+TCODFOV_FORCE_INLINE void cast_diamond_kind(
+    DiamondFovState* __restrict state,
+    RaycastTile* current_ray,
+    int radius_squared,
+    const TCODFOV_MapKind kind) {
+  while ((current_ray = current_ray->perimeter_next) != NULL) {
+    if (radius_squared <= 0 || ray_length_sq(current_ray) <= radius_squared) {
+      merge_input(state, current_ray, kind);
+    } else {
+      current_ray->ignore = true;  // Mark out-of-range tiles as ignored.
+    }
+    expand_perimeter_from(state, current_ray);
+
+    // Check if this tile is visible.
+    // current_ray->touched is true.
+    if (current_ray->ignore) {
+      continue;
+    }
+    if (current_ray->x_error > 0 && current_ray->x_error <= current_ray->x_obscurity) {
+      continue;
+    }
+    if (current_ray->y_error > 0 && current_ray->y_error <= current_ray->y_obscurity) {
+      continue;
+    }
+    const int map_x = state->pov_x + current_ray->x_relative;
+    const int map_y = state->pov_y + current_ray->y_relative;
+    TCODFOV_access_set(&state->fov, kind, map_x, map_y, true);
+  }
+}
+TCODFOV_Error TCODFOV_map_compute_fov_diamond_raycasting_(
     const TCODFOV_Map2D* __restrict transparent,
     TCODFOV_Map2D* __restrict fov,
     int pov_x,
     int pov_y,
     int max_radius,
-    bool light_walls) {
+    bool light_walls,
+    TCODFOV_Workspace* __restrict workspace) {
   const int radius_squared = max_radius * max_radius;
 
   if (!TCODFOV_map2d_in_bounds(fov, pov_x, pov_y)) {
@@ -210,18 +248,31 @@ TCODFOV_Error TCODFOV_map_compute_fov_diamond_raycasting(
   }
   TCODFOV_map2d_set_bool(fov, pov_x, pov_y, true);
 
+  // Rays are only created one tile past the radius, so the ray grid only needs to cover that window of the map.
+  int grid_x = 0;
+  int grid_y = 0;
+  int grid_x_end = TCODFOV_map2d_get_width(fov);
+  int grid_y_end = TCODFOV_map2d_get_height(fov);
+  if (max_radius > 0) {
+    grid_x = TCODFOV_MAX(grid_x, pov_x - max_radius - 1);
+    grid_y = TCODFOV_MAX(grid_y, pov_y - max_radius - 1);
+    grid_x_end = TCODFOV_MIN(grid_x_end, pov_x + max_radius + 2);
+    grid_y_end = TCODFOV_MIN(grid_y_end, pov_y + max_radius + 2);
+  }
+  const size_t grid_size = (size_t)(grid_x_end - grid_x) * (size_t)(grid_y_end - grid_y) * sizeof(RaycastTile);
+  RaycastTile* const raymap_grid = TCODFOV_workspace_reserve_(workspace, TCODFOV_SCRATCH_RAYCAST_GRID, grid_size);
+  if (!raymap_grid) return TCODFOV_E_OUT_OF_MEMORY;
+  memset(raymap_grid, 0, grid_size);
   DiamondFovState state = {
-      .transparent = transparent,
-      .fov = fov,
       .pov_x = pov_x,
       .pov_y = pov_y,
-      .raymap_grid = calloc(TCODFOV_map2d_get_width(fov) * TCODFOV_map2d_get_height(fov), sizeof(*state.raymap_grid)),
+      .grid_x = grid_x,
+      .grid_y = grid_y,
+      .grid_width = grid_x_end - grid_x,
+      .grid_height = grid_y_end - grid_y,
+      .raymap_grid = raymap_grid,
   };
-
-  if (!state.raymap_grid) {
-    TCODFOV_set_errorv("Out of memory.");
-    return TCODFOV_E_OUT_OF_MEMORY;
-  }
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&state.transparent, &state.fov, transparent, fov);
 
   // Add the origin ray tile to start the process.
   RaycastTile* current_ray = state.perimeter_last = get_ray(&state, 0, 0);
@@ -229,32 +280,22 @@ TCODFOV_Error TCODFOV_map_compute_fov_diamond_raycasting(
   expand_perimeter_from(&state, current_ray);
 
   // Iterative over the diamond perimeter.
-  while ((current_ray = current_ray->perimeter_next) != NULL) {
-    if (radius_squared <= 0 || ray_length_sq(current_ray) <= radius_squared) {
-      merge_input(&state, current_ray);
-    } else {
-      current_ray->ignore = true;  // Mark out-of-range tiles as ignored.
-    }
-    expand_perimeter_from(&state, current_ray);
-
-    // Check if this tile is visible.
-    // current_ray->touched is true.
-    if (current_ray->ignore) {
-      continue;
-    }
-    if (current_ray->x_error > 0 && current_ray->x_error <= current_ray->x_obscurity) {
-      continue;
-    }
-    if (current_ray->y_error > 0 && current_ray->y_error <= current_ray->y_obscurity) {
-      continue;
-    }
-    const int map_x = pov_x + current_ray->x_relative;
-    const int map_y = pov_y + current_ray->y_relative;
-    TCODFOV_map2d_set_bool(fov, map_x, map_y, true);
-  }
-  free(state.raymap_grid);
+  TCODFOV_MAP_KIND_SWITCH(kind, K, cast_diamond_kind(&state, current_ray, radius_squared, K));
   if (light_walls) {
     TCODFOV_map_postprocess(transparent, fov, pov_x, pov_y, max_radius);
   }
   return TCODFOV_E_OK;
 }
+TCODFOV_Error TCODFOV_map_compute_fov_diamond_raycasting(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls) {
+  TCODFOV_Workspace workspace = {0};
+  const TCODFOV_Error err = TCODFOV_map_compute_fov_diamond_raycasting_(
+      transparent, fov, pov_x, pov_y, max_radius, light_walls, &workspace);
+  TCODFOV_workspace_release_(&workspace);
+  return err;
+}
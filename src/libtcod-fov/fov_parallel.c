@@ -0,0 +1,205 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/** \file
+    Field-of-view for one point-of-view split between threads.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "fov.h"
+#include "libtcod_int.h"
+#include "map_access.h"
+#include "map_inline.h"
+#include "map_types.h"
+#include "parallel.h"
+#include "utility.h"
+/**
+    Radii smaller than this are computed on the calling thread, since splitting them costs more than it saves.
+ */
+#define PARALLEL_MIN_RADIUS 64
+/**
+    A sector of the field-of-view and the private output map it is computed into.
+
+    Sectors start on a multiple of 8 columns so that merging them never splits a byte of a bitpacked output map.
+ */
+typedef struct Sector {
+  TCODFOV_Rect rect;  // Tiles of the full map covered by this sector, clipped to the map.
+  TCODFOV_Map2D fov;  // Bitpacked output of this sector, indexed relative to `rect`.
+} Sector;
+/**
+    The arguments of a split field-of-view shared by all of its tasks.
+ */
+typedef struct ParallelFov {
+  TCODFOV_MapAccess transparent;  // Resolved bitpacked input map.
+  int pov_x;
+  int pov_y;
+  int max_radius;
+  bool light_walls;
+  TCODFOV_fov_algorithm_t algo;
+  Sector* __restrict sectors;
+} ParallelFov;
+/**
+    Compute one sector from a view of the input map covering only that sector.
+ */
+static TCODFOV_Error parallel_run_sector(void* userdata, int index, TCODFOV_Workspace* __restrict workspace) {
+  (void)workspace;
+  const ParallelFov* parallel = userdata;
+  Sector* sector = &parallel->sectors[index];
+  const TCODFOV_Map2D transparent = {
+      .bitpacked = {
+          .type = TCODFOV_MAP2D_BITPACKED,
+          .shape = {sector->rect.height, sector->rect.width},
+          .data = parallel->transparent.data + parallel->transparent.y_stride * sector->rect.y + (sector->rect.x >> 3),
+          .y_stride = parallel->transparent.y_stride,
+      }};
+  const int pov_x = parallel->pov_x - sector->rect.x;
+  const int pov_y = parallel->pov_y - sector->rect.y;
+  if (parallel->algo == TCODFOV_SHADOW) {
+    return TCODFOV_recursive_shadowcasting_octant_(
+        &transparent, &sector->fov, pov_x, pov_y, parallel->max_radius, parallel->light_walls, index);
+  }
+  return TCODFOV_symmetric_shadowcast_quadrant_(
+      &transparent, &sector->fov, pov_x, pov_y, parallel->max_radius, parallel->light_walls, index);
+}
+/**
+    Add the visible tiles of `sector` to `fov`.
+ */
+static void merge_sector(const Sector* __restrict sector, TCODFOV_Map2D* __restrict fov) {
+  TCODFOV_MapAccess sector_access;
+  TCODFOV_MapAccess fov_access;
+  TCODFOV_map_access_init(&sector_access, &sector->fov);
+  TCODFOV_map_access_init(&fov_access, fov);
+  const bool bitpacked = TCODFOV_map_kind_of_(fov) == TCODFOV_MAP_KIND_BITPACKED;
+  for (int y = 0; y < sector->rect.height; ++y) {
+    for (int x = 0; x < sector->rect.width; x += 64) {
+      uint64_t tiles = TCODFOV_bitpacked_row_load64(&sector_access, x, y);
+      if (bitpacked) {
+        TCODFOV_bitpacked_row_or64(&fov_access, sector->rect.x + x, sector->rect.y + y, tiles);
+        continue;
+      }
+      for (; tiles; tiles &= tiles - 1) {
+        TCODFOV_map2d_set_bool(fov, sector->rect.x + x + TCODFOV_ctz64(tiles), sector->rect.y + y, true);
+      }
+    }
+  }
+}
+TCODFOV_Error TCODFOV_map_compute_fov_parallel(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_fov_algorithm_t algo,
+    TCODFOV_ThreadPool* __restrict pool) {
+  if (!transparent || !fov) {
+    TCODFOV_set_errorv("Input and output maps must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if ((int)algo < 0 || algo >= NB_FOV_ALGORITHMS) {
+    TCODFOV_set_errorvf("Invalid field-of-view algorithm %i.", (int)algo);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  const int width = TCODFOV_map2d_get_width(transparent);
+  const int height = TCODFOV_map2d_get_height(transparent);
+  if (TCODFOV_map2d_get_width(fov) != width || TCODFOV_map2d_get_height(fov) != height) {
+    TCODFOV_set_errorvf(
+        "Output map must be the same size as the input map {%i, %i}, got {%i, %i}.",
+        width,
+        height,
+        TCODFOV_map2d_get_width(fov),
+        TCODFOV_map2d_get_height(fov));
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!TCODFOV_map2d_in_bounds(fov, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  const bool splittable = algo == TCODFOV_SHADOW || algo == TCODFOV_SYMMETRIC_SHADOWCAST;
+  if (!splittable || TCODFOV_map_kind_of_(transparent) != TCODFOV_MAP_KIND_BITPACKED ||
+      (max_radius > 0 && max_radius < PARALLEL_MIN_RADIUS)) {
+    return TCODFOV_map_compute_fov_2d(transparent, fov, pov_x, pov_y, max_radius, light_walls, algo, NULL, NULL);
+  }
+  const int sector_count = algo == TCODFOV_SHADOW ? 8 : 4;
+  if (algo == TCODFOV_SHADOW) max_radius = TCODFOV_recursive_shadowcasting_radius_(fov, pov_x, pov_y, max_radius);
+  // Symmetric shadowcasting stops at the edge of the map when there is no radius.
+  const int extent = max_radius > 0 ? max_radius : TCODFOV_MAX(width, height);
+  Sector sectors[8];
+  size_t total_bytes = 0;
+  for (int i = 0; i < sector_count; ++i) {
+    TCODFOV_Rect rect = algo == TCODFOV_SHADOW
+                            ? TCODFOV_recursive_shadowcasting_octant_bounds_(i, pov_x, pov_y, max_radius)
+                            : TCODFOV_symmetric_shadowcast_quadrant_bounds_(i, pov_x, pov_y, extent);
+    const int x_end = TCODFOV_MIN(rect.x + rect.width, width);
+    const int y_end = TCODFOV_MIN(rect.y + rect.height, height);
+    rect.x = TCODFOV_MAX(rect.x, 0) & ~7;
+    rect.y = TCODFOV_MAX(rect.y, 0);
+    rect.width = x_end - rect.x;
+    rect.height = y_end - rect.y;
+    const ptrdiff_t y_stride = (rect.width + 7) >> 3;
+    sectors[i] = (Sector){
+        .rect = rect,
+        .fov = {.bitpacked = {TCODFOV_MAP2D_BITPACKED, {rect.height, rect.width}, NULL, y_stride}},
+    };
+    total_bytes += (size_t)y_stride * (size_t)rect.height;
+  }
+  uint8_t* buffer = calloc(total_bytes, 1);
+  if (!buffer) {
+    TCODFOV_set_errorv("Out of memory.");
+    return TCODFOV_E_OUT_OF_MEMORY;
+  }
+  uint8_t* sector_data = buffer;
+  for (int i = 0; i < sector_count; ++i) {
+    sectors[i].fov.bitpacked.data = sector_data;
+    sector_data += sectors[i].fov.bitpacked.y_stride * sectors[i].rect.height;
+  }
+  ParallelFov parallel = {
+      .pov_x = pov_x,
+      .pov_y = pov_y,
+      .max_radius = max_radius,
+      .light_walls = light_walls,
+      .algo = algo,
+      .sectors = sectors,
+  };
+  TCODFOV_map_access_init(&parallel.transparent, transparent);
+  const TCODFOV_Error err = TCODFOV_thread_pool_run_(pool, sector_count, parallel_run_sector, &parallel);
+  if (err >= 0) {
+    for (int i = 0; i < sector_count; ++i) merge_sector(&sectors[i], fov);
+    // No sector marks the point-of-view, its value matches the serial algorithms.
+    const bool pov_visible = algo == TCODFOV_SHADOW || light_walls || TCODFOV_map2d_get_bool(transparent, pov_x, pov_y);
+    if (pov_visible) TCODFOV_map2d_set_bool(fov, pov_x, pov_y, true);
+  }
+  free(buffer);
+  return err;
+}
@@ -46,30 +46,32 @@ static void pascal_scan_line(
   }
 }
 
-/// @brief Compute the next row of visiblity, continue until out-of-bounds
-static void pascal_scan_next_row(
+/// @brief Compute each row of visiblity in the `scan_dir` direction until out-of-bounds
+static void pascal_scan_rows(
     const TCODFOV_Map2D* __restrict transparent,  // Input transparency
     TCODFOV_Map2D* __restrict out,
     int pov_x,  // X position
-    int scan_y,  // Y position
+    int scan_y,  // Y position of the first row
     int_fast8_t scan_dir,  // Y step direction, -1 or 1
-    int iteration,  // Distance from pov_y, always `abs(scan_y - pov_y)`
     double* __restrict prev_row,  // Previous row light-level
     double* __restrict next_row  // This row light-level
 ) {
-  if (scan_y < 0 || scan_y >= TCODFOV_map2d_get_height(out)) return;  // Finished, out-of-bounds
-
-  // Compute tile at pov_x, scan_y
-  TCODFOV_map2d_set_d(out, pov_x, scan_y, prev_row[pov_x]);
-  next_row[pov_x] = prev_row[pov_x] * TCODFOV_map2d_get_d(transparent, pov_x, scan_y);
-
-  // Compute tiles on sides of active row
-  pascal_scan_line(transparent, out, pov_x, scan_y, iteration, prev_row, next_row, pov_x - 1, -1, -1);
-  pascal_scan_line(
-      transparent, out, pov_x, scan_y, iteration, prev_row, next_row, pov_x + 1, TCODFOV_map2d_get_width(out), 1);
-
-  // Swap next_row and prev_row and continue
-  pascal_scan_next_row(transparent, out, pov_x, scan_y + scan_dir, scan_dir, iteration + 1, next_row, prev_row);
+  // `iteration` is the distance from pov_y, always `abs(scan_y - pov_y)`
+  for (int iteration = 1; 0 <= scan_y && scan_y < TCODFOV_map2d_get_height(out); scan_y += scan_dir, ++iteration) {
+    // Compute tile at pov_x, scan_y
+    TCODFOV_map2d_set_d(out, pov_x, scan_y, prev_row[pov_x]);
+    next_row[pov_x] = prev_row[pov_x] * TCODFOV_map2d_get_d(transparent, pov_x, scan_y);
+
+    // Compute tiles on sides of active row
+    pascal_scan_line(transparent, out, pov_x, scan_y, iteration, prev_row, next_row, pov_x - 1, -1, -1);
+    pascal_scan_line(
+        transparent, out, pov_x, scan_y, iteration, prev_row, next_row, pov_x + 1, TCODFOV_map2d_get_width(out), 1);
+
+    // Swap next_row and prev_row and continue
+    double* const swap = prev_row;
+    prev_row = next_row;
+    next_row = swap;
+  }
 }
 
 static void pascal_scan_init(
@@ -116,8 +118,9 @@ TCODFOV_Error TCODFOV_pascal_diffusion_2d(
   pascal_scan_init(transparent, out, pov_x, pov_y, row);
 
   memcpy(row2, row, TCODFOV_map2d_get_width(out) * sizeof(*row));
-  pascal_scan_next_row(transparent, out, pov_x, pov_y - 1, -1, 1, row2, row3);
+  pascal_scan_rows(transparent, out, pov_x, pov_y - 1, -1, row2, row3);
   memcpy(row2, row, TCODFOV_map2d_get_width(out) * sizeof(*row));
-  pascal_scan_next_row(transparent, out, pov_x, pov_y + 1, 1, 1, row2, row3);
+  pascal_scan_rows(transparent, out, pov_x, pov_y + 1, 1, row2, row3);
+  free(row);
   return TCODFOV_E_OK;
 }
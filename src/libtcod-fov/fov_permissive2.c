@@ -37,8 +37,10 @@
 
 #include "fov.h"
 #include "libtcod_int.h"
+#include "map_access.h"
 #include "map_inline.h"
 #include "map_types.h"
+#include "scratch.h"
 #include "utility.h"
 
 /* The size of each square in units */
@@ -59,6 +61,8 @@ typedef struct View {
   Line steep_line;
   ViewBump* shallow_bump;
   ViewBump* steep_bump;
+  struct View* prev;  // The next shallower active view.
+  struct View* next;  // The next steeper active view.
 } View;
 
 typedef struct ViewBumpContainer {
@@ -78,48 +82,50 @@ static bool LINE_COLINEAR(const Line* line1, const Line* line2) {
   return COLINEAR(line1, line2->xi, line2->yi) && COLINEAR(line1, line2->xf, line2->yf);
 }
 
-typedef struct ActiveViewArray {  // Active view container.
-  ptrdiff_t count;  // Number of elements in the array.
-  View** __restrict view_ptrs;  // Preallocated array of pointers to View*.
-} ActiveViewArray;
+typedef struct ActiveViewList {  // Active view container.
+  View* first;  // The shallowest active view, or NULL if there are no active views.
+} ActiveViewList;
 
-/// @brief Push a view onto the active view array.
-static void view_array_push(ActiveViewArray* view_array, View* view_ptr) {
-  view_array->view_ptrs[view_array->count++] = view_ptr;
-}
-
-/// @brief Remove a view from the active views and shift the remaining elements.
-static void view_array_remove(ActiveViewArray* view_array, ptrdiff_t index) {
-  for (ptrdiff_t i = index; i < view_array->count - 1; ++i) view_array->view_ptrs[i] = view_array->view_ptrs[i + 1];
-  --view_array->count;
+/// @brief Remove a view from the active views and return the view which followed it.
+static View* view_list_remove(ActiveViewList* view_list, View* view) {
+  if (view->prev) {
+    view->prev->next = view->next;
+  } else {
+    view_list->first = view->next;
+  }
+  if (view->next) view->next->prev = view->prev;
+  return view->next;
 }
 
-/// @brief Insert a view into the active views array.
-static void view_array_insert(ActiveViewArray* view_array, ptrdiff_t index, View* view_ptr) {
-  for (ptrdiff_t i = view_array->count; i > index; --i) view_array->view_ptrs[i] = view_array->view_ptrs[i - 1];
-  view_array->view_ptrs[index] = view_ptr;
-  ++view_array->count;
+/// @brief Insert a view into the active views before `position`.
+static void view_list_insert_before(ActiveViewList* view_list, View* position, View* view) {
+  view->prev = position->prev;
+  view->next = position;
+  if (position->prev) {
+    position->prev->next = view;
+  } else {
+    view_list->first = view;
+  }
+  position->prev = view;
 }
 
-/// @brief Return a past-the-end pointer for the active view array.
-static View** view_array_end(const ActiveViewArray* view_array) { return view_array->view_ptrs + view_array->count; }
-
 /// @brief Set a maps FOV-bit and return true if the tile is blocked.
-static bool is_blocked(
-    const TCODFOV_Map2D* __restrict transparent,
-    TCODFOV_Map2D* __restrict fov,
+TCODFOV_FORCE_INLINE bool is_blocked(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
     int pov_x,
     int pov_y,
     int x,
     int y,
     int dx,
     int dy,
-    bool light_walls) {
+    bool light_walls,
+    const TCODFOV_MapKind kind) {
   const int pos_x = x * dx / STEP_SIZE + pov_x;
   const int pos_y = y * dy / STEP_SIZE + pov_y;
-  const bool blocked = !TCODFOV_map2d_get_bool(transparent, pos_x, pos_y);
+  const bool blocked = !TCODFOV_access_get(transparent, kind, pos_x, pos_y);
   if (!blocked || light_walls) {
-    TCODFOV_map2d_set_bool(fov, pos_x, pos_y, true);
+    TCODFOV_access_set(fov, kind, pos_x, pos_y, true);
   }
   return blocked;
 }
@@ -160,93 +166,84 @@ static void add_steep_bump(int x, int y, View* view, ViewBumpContainer* bumps) {
   }
 }
 
-static bool check_view(ActiveViewArray* active_views, View** it, int offset, int limit) {
-  const View* view = *it;
+/// @brief Remove `view` if it has collapsed into a line and return false, otherwise return true.
+static bool check_view(ActiveViewList* active_views, View* view, int offset, int limit) {
   const Line* shallow_line = &view->shallow_line;
   const Line* steep_line = &view->steep_line;
   if (LINE_COLINEAR(shallow_line, steep_line) &&
       (COLINEAR(shallow_line, offset, limit) || COLINEAR(shallow_line, limit, offset))) {
     /*printf ("deleting view %x\n",it); */
-    view_array_remove(active_views, it - active_views->view_ptrs);  // Slow element removal!
+    view_list_remove(active_views, view);
     return false;
   }
   return true;
 }
 
-static void visit_coords(
-    const TCODFOV_Map2D* __restrict transparent,
-    TCODFOV_Map2D* __restrict fov,
+TCODFOV_FORCE_INLINE void visit_coords(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
     int pov_x,
     int pov_y,
     int x,
     int y,
     int dx,
     int dy,
-    ActiveViewArray* active_views,
-    View*** current_view,
+    ActiveViewList* active_views,
+    View** current_view,
     bool light_walls,
     int offset,
     int limit,
     View* views,
-    ViewBumpContainer* bumps) {
+    int views_width,
+    ViewBumpContainer* bumps,
+    const TCODFOV_MapKind kind) {
   /* top left */
   const int tlx = x;
   const int tly = y + STEP_SIZE;
   /* bottom right */
   const int brx = x + STEP_SIZE;
   const int bry = y;
-  View* view = NULL;
-  while (*current_view != view_array_end(active_views)) {
-    view = **current_view;
+  View* view = *current_view;
+  while (view) {
     if (!BELOW_OR_COLINEAR(&view->steep_line, brx, bry)) {
       break;
     }
-    (*current_view)++;
+    view = view->next;
   }
-  if (*current_view == view_array_end(active_views) || ABOVE_OR_COLINEAR(&view->shallow_line, tlx, tly)) {
+  *current_view = view;
+  if (!view || ABOVE_OR_COLINEAR(&view->shallow_line, tlx, tly)) {
     return; /* no more active view */
   }
-  if (!is_blocked(transparent, fov, pov_x, pov_y, x, y, dx, dy, light_walls)) {
+  if (!is_blocked(transparent, fov, pov_x, pov_y, x, y, dx, dy, light_walls, kind)) {
     return;
   }
   if (ABOVE(&view->shallow_line, brx, bry) && BELOW(&view->steep_line, tlx, tly)) {
     /* view blocked */
-    view_array_remove(active_views, *current_view - active_views->view_ptrs);  // Slow element removal!
+    *current_view = view_list_remove(active_views, view);
   } else if (ABOVE(&view->shallow_line, brx, bry)) {
     /* shallow bump */
     add_shallow_bump(tlx, tly, view, bumps);
-    check_view(active_views, *current_view, offset, limit);
+    if (!check_view(active_views, view, offset, limit)) *current_view = view->next;
   } else if (BELOW(&view->steep_line, tlx, tly)) {
     /* steep bump */
     add_steep_bump(brx, bry, view, bumps);
-    check_view(active_views, *current_view, offset, limit);
+    if (!check_view(active_views, view, offset, limit)) *current_view = view->next;
   } else {
     /* view split */
-    const int views_offset = pov_x + x * dx / STEP_SIZE + (pov_y + y * dy / STEP_SIZE) * TCODFOV_map2d_get_width(fov);
-    View* shallower_view = &views[views_offset];
-    const ptrdiff_t view_index = *current_view - active_views->view_ptrs;
-    View** shallower_view_it;
-    View** steeper_view_it;
-    *shallower_view = ***current_view;
-    view_array_insert(active_views, view_index, shallower_view);  // Slow insertion!
-    shallower_view_it = active_views->view_ptrs + view_index;
-    steeper_view_it = shallower_view_it + 1;
-    *current_view = shallower_view_it;
+    View* shallower_view = &views[x / STEP_SIZE + y / STEP_SIZE * views_width];
+    *shallower_view = *view;
+    view_list_insert_before(active_views, view, shallower_view);
+    *current_view = shallower_view;
     add_steep_bump(brx, bry, shallower_view, bumps);
-    if (!check_view(active_views, shallower_view_it, offset, limit)) {
-      steeper_view_it--;
-    }
-    add_shallow_bump(tlx, tly, *steeper_view_it, bumps);
-    check_view(active_views, steeper_view_it, offset, limit);
-    if (view_index > active_views->count) {
-      *current_view = view_array_end(active_views);
-    }
+    if (!check_view(active_views, shallower_view, offset, limit)) *current_view = view;
+    add_shallow_bump(tlx, tly, view, bumps);
+    if (!check_view(active_views, view, offset, limit) && *current_view == view) *current_view = view->next;
   }
 }
 
-static void check_quadrant(
-    const TCODFOV_Map2D* __restrict transparent,
-    TCODFOV_Map2D* __restrict fov,
+TCODFOV_FORCE_INLINE void check_quadrant_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
     int pov_x,
     int pov_y,
     int dx,
@@ -258,30 +255,34 @@ static void check_quadrant(
     int limit,
     View* __restrict views,
     ViewBumpContainer* __restrict bumps,
-    ActiveViewArray* __restrict active_views) {
+    ActiveViewList* __restrict active_views,
+    const TCODFOV_MapKind kind) {
   // Reset temporary data storage arrays
   bumps->count = 0;
-  active_views->count = 0;
 
   const Line shallow_line = {offset, limit, extent_x * STEP_SIZE, 0};
   const Line steep_line = {limit, offset, 0, extent_y * STEP_SIZE};
-  View* view = &views[pov_x + pov_y * TCODFOV_map2d_get_width(fov)];
+  // Views are indexed by their position relative to the POV within this quadrant.
+  const int views_width = extent_x + 1;
+  View* view = &views[0];
 
   view->shallow_line = shallow_line;
   view->steep_line = steep_line;
   view->shallow_bump = NULL;
   view->steep_bump = NULL;
-  view_array_push(active_views, view);
+  view->prev = NULL;
+  view->next = NULL;
+  active_views->first = view;
   const int max_i = extent_x + extent_y;
   for (int i = 1; i <= max_i; ++i) {
-    if (!active_views->count) {
+    if (!active_views->first) {
       break;
     }
-    View** current_view = active_views->view_ptrs;
+    View* current_view = active_views->first;
     const int start_j = TCODFOV_MAX(i - extent_x, 0);
     const int max_j = TCODFOV_MIN(i, extent_y);
     for (int j = start_j; j <= max_j; ++j) {
-      if (!active_views->count || current_view == view_array_end(active_views)) {
+      if (!current_view) {
         break;
       }
       const int x = (i - j) * STEP_SIZE;
@@ -301,19 +302,61 @@ static void check_quadrant(
           offset,
           limit,
           views,
-          bumps);
+          views_width,
+          bumps,
+          kind);
     }
   }
 }
+/**
+    Dispatch `check_quadrant_kind` for the storage kind shared by both maps.
+ */
+static void check_quadrant(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int dx,
+    int dy,
+    int extent_x,
+    int extent_y,
+    bool light_walls,
+    int offset,
+    int limit,
+    View* __restrict views,
+    ViewBumpContainer* __restrict bumps,
+    ActiveViewList* __restrict active_views,
+    TCODFOV_MapKind kind) {
+  TCODFOV_MAP_KIND_SWITCH(
+      kind,
+      K,
+      check_quadrant_kind(
+          transparent,
+          fov,
+          pov_x,
+          pov_y,
+          dx,
+          dy,
+          extent_x,
+          extent_y,
+          light_walls,
+          offset,
+          limit,
+          views,
+          bumps,
+          active_views,
+          K));
+}
 
-TCODFOV_Error TCODFOV_map_compute_fov_permissive2(
+TCODFOV_Error TCODFOV_map_compute_fov_permissive2_(
     const TCODFOV_Map2D* __restrict transparent,
     TCODFOV_Map2D* __restrict fov,
     int pov_x,
     int pov_y,
     int max_radius,
     bool light_walls,
-    int permissiveness) {
+    int permissiveness,
+    TCODFOV_Workspace* __restrict workspace) {
   if (!(0 <= permissiveness && permissiveness <= 8)) {
     TCODFOV_set_errorvf("Bad permissiveness %d for FOV_PERMISSIVE. Accepted range is [0,8].", permissiveness);
     return TCODFOV_E_INVALID_ARGUMENT;
@@ -329,22 +372,6 @@ TCODFOV_Error TCODFOV_map_compute_fov_permissive2(
   }
   TCODFOV_map2d_set_bool(fov, pov_x, pov_y, true);
 
-  // Preallocate views and bumps, assuming there will be no more bumps or active views than the number of map tiles.
-  View* views = malloc(TCODFOV_map2d_get_width(fov) * TCODFOV_map2d_get_height(fov) * sizeof(*views));
-  const int bump_cap = TCODFOV_MAX(
-      TCODFOV_map2d_get_width(fov) * TCODFOV_map2d_get_height(fov),
-      16);  // maps <= 6 cells can overflow, minimum of 16 for memory safety
-  ViewBumpContainer bumps = {.data = malloc(bump_cap * sizeof(*bumps.data))};
-  ActiveViewArray active_views = {
-      .view_ptrs =
-          malloc(TCODFOV_map2d_get_width(fov) * TCODFOV_map2d_get_height(fov) * sizeof(*active_views.view_ptrs))};
-  if (!views || !bumps.data || !active_views.view_ptrs) {
-    free(bumps.data);
-    free(views);
-    free(active_views.view_ptrs);
-    TCODFOV_set_errorv("Out of memory.");
-    return TCODFOV_E_OUT_OF_MEMORY;
-  }
   /* set the fov range */
   int min_x = pov_x;
   int max_x = TCODFOV_map2d_get_width(fov) - pov_x - 1;
@@ -356,17 +383,97 @@ TCODFOV_Error TCODFOV_map_compute_fov_permissive2(
     min_y = TCODFOV_MIN(min_y, max_radius);
     max_y = TCODFOV_MIN(max_y, max_radius);
   }
+  // Preallocate views and bumps for the largest quadrant, which is bounded by the radius instead of the map size.
+  // Each tile can create at most one view and two bumps.
+  const size_t quadrant_size =
+      (size_t)(TCODFOV_MAX(min_x, max_x) + 1) * (size_t)(TCODFOV_MAX(min_y, max_y) + 1);
+  View* views = TCODFOV_workspace_reserve_(workspace, TCODFOV_SCRATCH_VIEWS, quadrant_size * sizeof(*views));
+  ViewBumpContainer bumps = {
+      .data = TCODFOV_workspace_reserve_(
+          workspace, TCODFOV_SCRATCH_VIEW_BUMPS, quadrant_size * 2 * sizeof(*bumps.data))};
+  ActiveViewList active_views = {0};
+  if (!views || !bumps.data) return TCODFOV_E_OUT_OF_MEMORY;
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
   /* calculate fov. precise permissive field of view */
   check_quadrant(
-      transparent, fov, pov_x, pov_y, 1, 1, max_x, max_y, light_walls, offset, limit, views, &bumps, &active_views);
+      &transparent_access,
+      &fov_access,
+      pov_x,
+      pov_y,
+      1,
+      1,
+      max_x,
+      max_y,
+      light_walls,
+      offset,
+      limit,
+      views,
+      &bumps,
+      &active_views,
+      kind);
   check_quadrant(
-      transparent, fov, pov_x, pov_y, 1, -1, max_x, min_y, light_walls, offset, limit, views, &bumps, &active_views);
+      &transparent_access,
+      &fov_access,
+      pov_x,
+      pov_y,
+      1,
+      -1,
+      max_x,
+      min_y,
+      light_walls,
+      offset,
+      limit,
+      views,
+      &bumps,
+      &active_views,
+      kind);
   check_quadrant(
-      transparent, fov, pov_x, pov_y, -1, -1, min_x, min_y, light_walls, offset, limit, views, &bumps, &active_views);
+      &transparent_access,
+      &fov_access,
+      pov_x,
+      pov_y,
+      -1,
+      -1,
+      min_x,
+      min_y,
+      light_walls,
+      offset,
+      limit,
+      views,
+      &bumps,
+      &active_views,
+      kind);
   check_quadrant(
-      transparent, fov, pov_x, pov_y, -1, 1, min_x, max_y, light_walls, offset, limit, views, &bumps, &active_views);
-  free(bumps.data);
-  free(views);
-  free(active_views.view_ptrs);
+      &transparent_access,
+      &fov_access,
+      pov_x,
+      pov_y,
+      -1,
+      1,
+      min_x,
+      max_y,
+      light_walls,
+      offset,
+      limit,
+      views,
+      &bumps,
+      &active_views,
+      kind);
   return TCODFOV_E_OK;
 }
+TCODFOV_Error TCODFOV_map_compute_fov_permissive2(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int permissiveness) {
+  TCODFOV_Workspace workspace = {0};
+  const TCODFOV_Error err = TCODFOV_map_compute_fov_permissive2_(
+      transparent, fov, pov_x, pov_y, max_radius, light_walls, permissiveness, &workspace);
+  TCODFOV_workspace_release_(&workspace);
+  return err;
+}
@@ -35,10 +35,14 @@
 #include <string.h>
 
 #include "fov.h"
+#include "fov_resumable.h"
 #include "libtcod_int.h"
+#include "map_access.h"
 #include "map_inline.h"
 #include "map_types.h"
+#include "parallel.h"
 #include "utility.h"
+#include "work_stack.h"
 /**
     Octant transformation matrixes.
 
@@ -55,77 +59,224 @@ static const int matrix_table[8][4] = {
     {1, 0, 0, -1},
 };
 /**
-    Cast visiblity using shadowcasting.
+    A row of an octant which still needs to be cast.
  */
-static void cast_light(
-    const TCODFOV_Map2D* __restrict transparent,
-    TCODFOV_Map2D* __restrict fov,
+typedef struct ShadowRow {
+  int distance;  // Polar distance from POV.
+  float view_slope_high;
+  float view_slope_low;
+} ShadowRow;
+/**
+    Number of pending rows kept on the C stack before the work stack moves to the heap.
+ */
+#define SHADOW_ROW_INLINE_CAPACITY 64
+/**
+    Mark the tiles at `angle_low..angle_high` of an octant row as visible.
+
+    The row must run along the x-axis of a bitpacked map.
+ */
+static void fill_angles_bitpacked(
+    TCODFOV_MapAccess* __restrict fov, int pov_x, int map_y, int xx, int angle_low, int angle_high) {
+  if (xx > 0) {
+    TCODFOV_bitpacked_row_fill(fov, pov_x + angle_low, pov_x + angle_high + 1, map_y, true);
+  } else {
+    TCODFOV_bitpacked_row_fill(fov, pov_x - angle_high, pov_x - angle_low + 1, map_y, true);
+  }
+}
+/**
+    Cast a row which runs along the x-axis of a bitpacked map, one run of floors or walls at a time.
+
+    This has the same effects as the per-tile loop of `cast_light_kind` but only does work at the edges of each run.
+    `view_slope_high` is updated as the view shrinks.  `last_tile_blocked` is set to true if the last tile in view
+    was blocked.
+ */
+static TCODFOV_Error cast_light_row_bitpacked(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
     int pov_x,
     int pov_y,
-    int distance,  // Polar distance from POV.
-    float view_slope_high,
+    int distance,
+    float* __restrict view_slope_high,
     float view_slope_low,
     int max_radius,
     int octant,
-    bool light_walls) {
+    bool light_walls,
+    TCODFOV_WorkStack* __restrict pending,
+    bool* __restrict last_tile_blocked) {
+  const int xx = matrix_table[octant][0];  // +1 or -1, angles run along the x-axis.
+  const int map_y = pov_y + distance * matrix_table[octant][3];
+  // Find the highest angle in view, the same as skipping tiles until `tile_slope_low <= view_slope_high`.
+  int angle_high = TCODFOV_CLAMP(-1, distance, (int)floorf(*view_slope_high * (distance + 0.5f) + 0.5f));
+  while (angle_high >= 0 && (angle_high - 0.5f) / (distance + 0.5f) > *view_slope_high) --angle_high;
+  while (angle_high < distance && !((angle_high + 1 - 0.5f) / (distance + 0.5f) > *view_slope_high)) ++angle_high;
+  // Find the lowest angle in view, the same as stopping when `tile_slope_high < view_slope_low`.
+  int angle_low = TCODFOV_CLAMP(0, distance + 1, (int)ceilf(view_slope_low * (distance - 0.5f) - 0.5f));
+  while (angle_low > 0 && !((angle_low - 1 + 0.5f) / (distance - 0.5f) < view_slope_low)) --angle_low;
+  while (angle_low <= distance && (angle_low + 0.5f) / (distance - 0.5f) < view_slope_low) ++angle_low;
+  // Clip the angles to the map, out-of-bounds tiles are skipped entirely.
+  angle_high = TCODFOV_MIN(angle_high, xx > 0 ? fov->width - 1 - pov_x : pov_x);
+  angle_low = TCODFOV_MAX(angle_low, xx > 0 ? -pov_x : pov_x - fov->width + 1);
+  // The highest angle within the radius.
+  const int radius_left = max_radius * max_radius - distance * distance;
+  int angle_lit = (int)sqrt(radius_left);
+  while (angle_lit * angle_lit > radius_left) --angle_lit;
+  while ((angle_lit + 1) * (angle_lit + 1) <= radius_left) ++angle_lit;
+
+  bool prev_tile_blocked = false;
+  for (int angle = angle_high; angle >= angle_low;) {
+    const int map_x = pov_x + angle * xx;
+    const bool is_transparent = TCODFOV_access_get(transparent, TCODFOV_MAP_KIND_BITPACKED, map_x, map_y);
+    const int run_end =  // The angle after this run of walls or floors.
+        xx > 0 ? TCODFOV_bitpacked_row_find_prev(transparent, map_x, pov_x + angle_low - 1, map_y, is_transparent) -
+                     pov_x
+               : pov_x -
+                     TCODFOV_bitpacked_row_find_next(transparent, map_x, pov_x - angle_low + 1, map_y, is_transparent);
+    if (light_walls || is_transparent) {
+      fill_angles_bitpacked(fov, pov_x, map_y, xx, run_end + 1, TCODFOV_MIN(angle, angle_lit));
+    }
+    if (prev_tile_blocked && is_transparent) {  // Wall -> floor.
+      *view_slope_high = (angle + 0.5f) / (distance + 0.5f);  // Reduce the view size.
+    }
+    if (!prev_tile_blocked && !is_transparent) {  // Floor -> wall.
+      // Get the last sequence of floors as a view and queue it.
+      const ShadowRow view = {distance + 1, *view_slope_high, (angle + 0.5f) / (distance - 0.5f)};
+      const TCODFOV_Error err = TCODFOV_work_stack_push(pending, &view);
+      if (err < 0) return err;
+    }
+    prev_tile_blocked = !is_transparent;
+    angle = run_end;
+  }
+  *last_tile_blocked = prev_tile_blocked;
+  return TCODFOV_E_OK;
+}
+/**
+    Cast visiblity using shadowcasting, starting from `row` and continuing outwards while the view stays open.
+
+    Views split off by walls are pushed to `pending`.  If `rows_left` is not NULL then at most that many rows are
+    cast, it is decremented for each row, and the row which was not cast is pushed to `pending` to be resumed later.
+ */
+TCODFOV_FORCE_INLINE TCODFOV_Error cast_light_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    ShadowRow row,
+    int max_radius,
+    int octant,
+    bool light_walls,
+    TCODFOV_WorkStack* __restrict pending,
+    int* __restrict rows_left,
+    const TCODFOV_MapKind kind) {
   const int xx = matrix_table[octant][0];
   const int xy = matrix_table[octant][1];
   const int yx = matrix_table[octant][2];
   const int yy = matrix_table[octant][3];
   const int radius_squared = max_radius * max_radius;
-  if (view_slope_high < view_slope_low) {
-    return;  // View is invalid.
-  }
-  if (distance > max_radius) {
-    return;  // Distance is out-of-range.
-  }
-  if (!TCODFOV_map2d_in_bounds(fov, pov_x + distance * xy, pov_y + distance * yy)) {
-    return;  // Distance is out-of-bounds.
-  }
-  bool prev_tile_blocked = false;
-  for (int angle = distance; angle >= 0; --angle) {  // Polar angle coordinates from high to low.
-    const float tile_slope_high = (angle + 0.5f) / (distance - 0.5f);
-    const float tile_slope_low = (angle - 0.5f) / (distance + 0.5f);
-    const float prev_tile_slope_low = (angle + 0.5f) / (distance + 0.5f);
-    if (tile_slope_low > view_slope_high) {
-      continue;  // Tile is not in the view yet.
-    } else if (tile_slope_high < view_slope_low) {
-      break;  // Tiles will no longer be in view.
+  for (;; ++row.distance) {
+    const int distance = row.distance;  // Polar distance from POV.
+    if (row.view_slope_high < row.view_slope_low) {
+      return TCODFOV_E_OK;  // View is invalid.
     }
-    // Current tile is in view.
-    const int map_x = pov_x + angle * xx + distance * xy;
-    const int map_y = pov_y + angle * yx + distance * yy;
-    if (!TCODFOV_map2d_in_bounds(fov, map_x, map_y)) {
-      continue;  // Angle is out-of-bounds.
+    if (distance > max_radius) {
+      return TCODFOV_E_OK;  // Distance is out-of-range.
     }
-    if (angle * angle + distance * distance <= radius_squared &&
-        (light_walls || TCODFOV_map2d_get_bool(transparent, map_x, map_y))) {
-      TCODFOV_map2d_set_bool(fov, map_x, map_y, true);
+    if (!TCODFOV_access_in_bounds(fov, pov_x + distance * xy, pov_y + distance * yy)) {
+      return TCODFOV_E_OK;  // Distance is out-of-bounds.
     }
-    if (prev_tile_blocked && TCODFOV_map2d_get_bool(transparent, map_x, map_y)) {  // Wall -> floor.
-      view_slope_high = prev_tile_slope_low;  // Reduce the view size.
+    if (rows_left) {
+      if (*rows_left <= 0) return TCODFOV_work_stack_push(pending, &row);  // Out of rows, resume from here.
+      --*rows_left;
     }
-    if (!prev_tile_blocked && !TCODFOV_map2d_get_bool(transparent, map_x, map_y)) {  // Floor -> wall.
-      // Get the last sequence of floors as a view and recurse into them.
-      cast_light(
+    bool prev_tile_blocked = false;
+    if (kind == TCODFOV_MAP_KIND_BITPACKED && xx != 0) {
+      const TCODFOV_Error err = cast_light_row_bitpacked(
           transparent,
           fov,
           pov_x,
           pov_y,
-          distance + 1,
-          view_slope_high,
-          tile_slope_high,
+          distance,
+          &row.view_slope_high,
+          row.view_slope_low,
           max_radius,
           octant,
-          light_walls);
+          light_walls,
+          pending,
+          &prev_tile_blocked);
+      if (err < 0) return err;
+    } else {
+      for (int angle = distance; angle >= 0; --angle) {  // Polar angle coordinates from high to low.
+        const float tile_slope_high = (angle + 0.5f) / (distance - 0.5f);
+        const float tile_slope_low = (angle - 0.5f) / (distance + 0.5f);
+        const float prev_tile_slope_low = (angle + 0.5f) / (distance + 0.5f);
+        if (tile_slope_low > row.view_slope_high) {
+          continue;  // Tile is not in the view yet.
+        } else if (tile_slope_high < row.view_slope_low) {
+          break;  // Tiles will no longer be in view.
+        }
+        // Current tile is in view.
+        const int map_x = pov_x + angle * xx + distance * xy;
+        const int map_y = pov_y + angle * yx + distance * yy;
+        if (!TCODFOV_access_in_bounds(fov, map_x, map_y)) {
+          continue;  // Angle is out-of-bounds.
+        }
+        const bool is_transparent = TCODFOV_access_get(transparent, kind, map_x, map_y);
+        if (angle * angle + distance * distance <= radius_squared && (light_walls || is_transparent)) {
+          TCODFOV_access_set(fov, kind, map_x, map_y, true);
+        }
+        if (prev_tile_blocked && is_transparent) {  // Wall -> floor.
+          row.view_slope_high = prev_tile_slope_low;  // Reduce the view size.
+        }
+        if (!prev_tile_blocked && !is_transparent) {  // Floor -> wall.
+          // Get the last sequence of floors as a view and queue it.
+          const ShadowRow view = {distance + 1, row.view_slope_high, tile_slope_high};
+          const TCODFOV_Error err = TCODFOV_work_stack_push(pending, &view);
+          if (err < 0) return err;
+        }
+        prev_tile_blocked = !is_transparent;
+      }
     }
-    prev_tile_blocked = !TCODFOV_map2d_get_bool(transparent, map_x, map_y);
+    if (prev_tile_blocked) return TCODFOV_E_OK;
+    // Continue into the current view.
   }
-  if (!prev_tile_blocked) {
-    // Tail-recurse into the current view.
-    cast_light(
-        transparent, fov, pov_x, pov_y, distance + 1, view_slope_high, view_slope_low, max_radius, octant, light_walls);
+}
+/**
+    Cast all views of an octant, starting with the full octant.
+ */
+TCODFOV_FORCE_INLINE TCODFOV_Error cast_octant_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    int octant,
+    bool light_walls,
+    const TCODFOV_MapKind kind) {
+  ShadowRow inline_rows[SHADOW_ROW_INLINE_CAPACITY];
+  TCODFOV_WorkStack pending = TCODFOV_work_stack_init(inline_rows, SHADOW_ROW_INLINE_CAPACITY, sizeof(ShadowRow));
+  TCODFOV_Error err = TCODFOV_work_stack_push(&pending, &(ShadowRow){1, 1.0f, 0.0f});
+  const ShadowRow* row;
+  while (err >= 0 && (row = TCODFOV_work_stack_pop(&pending)) != NULL) {
+    err = cast_light_kind(transparent, fov, pov_x, pov_y, *row, max_radius, octant, light_walls, &pending, NULL, kind);
   }
+  TCODFOV_work_stack_free(&pending);
+  return err;
+}
+/**
+    Dispatch `cast_octant_kind` for the storage kind shared by both maps.
+ */
+static TCODFOV_Error cast_octant(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    int octant,
+    bool light_walls,
+    TCODFOV_MapKind kind) {
+  TCODFOV_Error err = TCODFOV_E_OK;
+  TCODFOV_MAP_KIND_SWITCH(
+      kind, K, err = cast_octant_kind(transparent, fov, pov_x, pov_y, max_radius, octant, light_walls, K));
+  return err;
 }
 
 TCODFOV_Error TCODFOV_map_compute_fov_recursive_shadowcasting(
@@ -139,15 +290,139 @@ TCODFOV_Error TCODFOV_map_compute_fov_recursive_shadowcasting(
     TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
     return TCODFOV_E_INVALID_ARGUMENT;
   }
-  if (max_radius <= 0) {
-    const int max_radius_x = TCODFOV_MAX(TCODFOV_map2d_get_width(fov) - pov_x, pov_x);
-    const int max_radius_y = TCODFOV_MAX(TCODFOV_map2d_get_height(fov) - pov_y, pov_y);
-    max_radius = (int)(sqrt(max_radius_x * max_radius_x + max_radius_y * max_radius_y)) + 1;
-  }
-  /* recursive shadow casting */
+  max_radius = TCODFOV_recursive_shadowcasting_radius_(fov, pov_x, pov_y, max_radius);
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  /* shadow casting */
   for (int octant = 0; octant < 8; ++octant) {
-    cast_light(transparent, fov, pov_x, pov_y, 1, 1.0, 0.0, max_radius, octant, light_walls);
+    const TCODFOV_Error err =
+        cast_octant(&transparent_access, &fov_access, pov_x, pov_y, max_radius, octant, light_walls, kind);
+    if (err < 0) return err;
   }
   TCODFOV_map2d_set_bool(fov, pov_x, pov_y, true);
   return TCODFOV_E_OK;
 }
+struct TCODFOV_ResumableFov {
+  TCODFOV_Map2D* fov;
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  TCODFOV_MapKind kind;
+  int pov_x;
+  int pov_y;
+  int max_radius;
+  bool light_walls;
+  bool done;
+  int octant;  // The octant of the rows in `pending`.
+  TCODFOV_WorkStack pending;  // Rows which still need to be cast, starts in `inline_rows`.
+  ShadowRow inline_rows[SHADOW_ROW_INLINE_CAPACITY];
+};
+TCODFOV_ResumableFov* TCODFOV_resumable_fov_new(
+    const TCODFOV_Map2D* transparent, TCODFOV_Map2D* fov, int pov_x, int pov_y, int max_radius, bool light_walls) {
+  if (!transparent || !fov) {
+    TCODFOV_set_errorv("Maps must not be NULL.");
+    return NULL;
+  }
+  if (!TCODFOV_map2d_in_bounds(fov, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return NULL;
+  }
+  TCODFOV_ResumableFov* job = malloc(sizeof(*job));
+  if (!job) {
+    TCODFOV_set_errorv("Out of memory.");
+    return NULL;
+  }
+  job->fov = fov;
+  job->kind = TCODFOV_map_access_init_pair(&job->transparent_access, &job->fov_access, transparent, fov);
+  job->pov_x = pov_x;
+  job->pov_y = pov_y;
+  job->max_radius = TCODFOV_recursive_shadowcasting_radius_(fov, pov_x, pov_y, max_radius);
+  job->light_walls = light_walls;
+  job->done = false;
+  job->octant = 0;
+  job->pending = TCODFOV_work_stack_init(job->inline_rows, SHADOW_ROW_INLINE_CAPACITY, sizeof(ShadowRow));
+  TCODFOV_work_stack_push(&job->pending, &(ShadowRow){1, 1.0f, 0.0f});  // Fits in `inline_rows`.
+  return job;
+}
+void TCODFOV_resumable_fov_delete(TCODFOV_ResumableFov* job) {
+  if (!job) return;
+  TCODFOV_work_stack_free(&job->pending);
+  free(job);
+}
+TCODFOV_Error TCODFOV_resumable_fov_step(TCODFOV_ResumableFov* job, int max_rows) {
+  if (!job) {
+    TCODFOV_set_errorv("Job must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (max_rows < 1) {
+    TCODFOV_set_errorvf("max_rows must be at least 1, got %i.", max_rows);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  int rows_left = max_rows;
+  // Rows are popped in the same order as `cast_octant_kind`, finishing an octant does not use up a row.
+  while (!job->done && (rows_left > 0 || job->pending.count == 0)) {
+    const ShadowRow* row = TCODFOV_work_stack_pop(&job->pending);
+    if (!row) {
+      if (++job->octant == 8) {
+        TCODFOV_map2d_set_bool(job->fov, job->pov_x, job->pov_y, true);
+        job->done = true;
+        break;
+      }
+      const TCODFOV_Error err = TCODFOV_work_stack_push(&job->pending, &(ShadowRow){1, 1.0f, 0.0f});
+      if (err < 0) return err;
+      continue;
+    }
+    const ShadowRow current = *row;
+    TCODFOV_Error err = TCODFOV_E_OK;
+    TCODFOV_MAP_KIND_SWITCH(
+        job->kind,
+        K,
+        err = cast_light_kind(
+            &job->transparent_access,
+            &job->fov_access,
+            job->pov_x,
+            job->pov_y,
+            current,
+            job->max_radius,
+            job->octant,
+            job->light_walls,
+            &job->pending,
+            &rows_left,
+            K));
+    if (err < 0) return err;
+  }
+  return TCODFOV_E_OK;
+}
+bool TCODFOV_resumable_fov_is_done(const TCODFOV_ResumableFov* job) { return job && job->done; }
+int TCODFOV_recursive_shadowcasting_radius_(const TCODFOV_Map2D* __restrict fov, int pov_x, int pov_y, int max_radius) {
+  if (max_radius > 0) return max_radius;
+  const int max_radius_x = TCODFOV_MAX(TCODFOV_map2d_get_width(fov) - pov_x, pov_x);
+  const int max_radius_y = TCODFOV_MAX(TCODFOV_map2d_get_height(fov) - pov_y, pov_y);
+  return (int)(sqrt(max_radius_x * max_radius_x + max_radius_y * max_radius_y)) + 1;
+}
+TCODFOV_Error TCODFOV_recursive_shadowcasting_octant_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int octant) {
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  return cast_octant(&transparent_access, &fov_access, pov_x, pov_y, max_radius, octant, light_walls, kind);
+}
+TCODFOV_Rect TCODFOV_recursive_shadowcasting_octant_bounds_(int octant, int pov_x, int pov_y, int max_radius) {
+  // Octants cover the tiles `pov + angle * (xx, yx) + distance * (xy, yy)` for `0 <= angle <= distance <= max_radius`.
+  const int* matrix = matrix_table[octant];
+  const int edge_x = pov_x + max_radius * matrix[1];  // The end of the axis.
+  const int edge_y = pov_y + max_radius * matrix[3];
+  const int diagonal_x = edge_x + max_radius * matrix[0];  // The end of the diagonal.
+  const int diagonal_y = edge_y + max_radius * matrix[2];
+  const int x_min = TCODFOV_MIN(pov_x, TCODFOV_MIN(edge_x, diagonal_x));
+  const int x_max = TCODFOV_MAX(pov_x, TCODFOV_MAX(edge_x, diagonal_x));
+  const int y_min = TCODFOV_MIN(pov_y, TCODFOV_MIN(edge_y, diagonal_y));
+  const int y_max = TCODFOV_MAX(pov_y, TCODFOV_MAX(edge_y, diagonal_y));
+  return (TCODFOV_Rect){x_min, y_min, x_max - x_min + 1, y_max - y_min + 1};
+}
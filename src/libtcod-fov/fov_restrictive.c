@@ -33,36 +33,183 @@
  * Mingos' Restrictive Precise Angle Shadowcasting (MRPAS) v1.2
  */
 #include <stdlib.h> /* for NULL in VS */
+#include <string.h>
 
 #include "fov.h"
 #include "libtcod_int.h"
+#include "map_access.h"
 #include "map_inline.h"
 #include "map_types.h"
+#include "scratch.h"
 #include "utility.h"
 
-static void compute_quadrant(
-    const TCODFOV_Map2D* __restrict transparent,
-    TCODFOV_Map2D* __restrict fov,
+/**
+    A blocked range of angles.
+ */
+typedef struct Obstacle {
+  double start_angle;
+  double end_angle;
+} Obstacle;
+/**
+    The obstacles of an octant.
+
+    Obstacles from previous lines are kept sorted and non-overlapping so that cells can be tested with a binary
+    search.  Obstacles found on the current line only take effect on the next line.
+ */
+typedef struct ObstacleSet {
+  Obstacle* __restrict active;  // Sorted obstacles of previous lines, may touch but never overlap.
+  int active_count;
+  Obstacle* __restrict pending;  // Obstacles found on the current line, in increasing order.
+  int pending_count;
+} ObstacleSet;
+/**
+    Return the index of the first active obstacle which ends at or after `angle`.
+ */
+static int obstacle_search(const ObstacleSet* __restrict obstacles, double angle) {
+  int low = 0;
+  int high = obstacles->active_count;
+  while (low < high) {
+    const int mid = low + (high - low) / 2;
+    if (obstacles->active[mid].end_angle < angle) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+/**
+    Return true if a cell is hidden by the obstacles of previous lines.
+
+    An opaque cell which is only partly covered extends the obstacles it touches, in which case `extended` is set.
+ */
+static bool obstacles_hide_cell(
+    ObstacleSet* __restrict obstacles,
+    double start_slope,
+    double centre_slope,
+    double end_slope,
+    bool is_transparent,
+    bool* __restrict extended) {
+  Obstacle* __restrict active = obstacles->active;
+  if (is_transparent) {
+    // Transparent cells are hidden if their centre is strictly within an obstacle.
+    int idx = obstacle_search(obstacles, centre_slope);
+    if (idx < obstacles->active_count && active[idx].end_angle == centre_slope) ++idx;
+    return idx < obstacles->active_count && active[idx].start_angle < centre_slope;
+  }
+  // Opaque cells are hidden if they are entirely within an obstacle.
+  const int first = obstacle_search(obstacles, start_slope);
+  int last = first;  // One past the last obstacle touching this cell.
+  for (; last < obstacles->active_count && active[last].start_angle <= end_slope; ++last) {
+    if (active[last].start_angle <= start_slope && end_slope <= active[last].end_angle) return true;
+  }
+  if (first == last) return false;
+  // Merge the touched obstacles and this cell into one obstacle.
+  active[first].start_angle = TCODFOV_MIN(active[first].start_angle, start_slope);
+  active[first].end_angle = TCODFOV_MAX(active[last - 1].end_angle, end_slope);
+  memmove(&active[first + 1], &active[last], (obstacles->active_count - last) * sizeof(*active));
+  obstacles->active_count -= last - first - 1;
+  *extended = true;
+  return false;
+}
+/**
+    Add the obstacles of the current line to the active obstacles.
+ */
+static void obstacles_end_line(ObstacleSet* __restrict obstacles) {
+  // Merge both sorted arrays from the back, `active` has room for all of them.
+  Obstacle* __restrict active = obstacles->active;
+  int dest = obstacles->active_count + obstacles->pending_count;
+  int active_idx = obstacles->active_count;
+  int pending_idx = obstacles->pending_count;
+  obstacles->active_count = dest;
+  while (pending_idx > 0) {
+    if (active_idx > 0 && active[active_idx - 1].start_angle > obstacles->pending[pending_idx - 1].start_angle) {
+      active[--dest] = active[--active_idx];
+    } else {
+      active[--dest] = obstacles->pending[--pending_idx];
+    }
+  }
+  obstacles->pending_count = 0;
+}
+/**
+    Process one cell of a line and return true if it is visible.
+ */
+TCODFOV_FORCE_INLINE bool compute_cell(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    ObstacleSet* __restrict obstacles,
+    int x,
+    int y,
+    int prev_x,  // The cell on the previous line in the same column.
+    int prev_y,
+    int prev_diagonal_x,  // The cell on the previous line in the previous column.
+    int prev_diagonal_y,
+    int processed_cell,
+    int iteration,
+    double slopes_per_cell,
+    double* __restrict min_angle,
+    bool* __restrict done,
+    bool light_walls,
+    const TCODFOV_MapKind kind) {
+  /* calculate slopes per cell */
+  const double half_slopes = slopes_per_cell * 0.5;
+  const double centre_slope = (double)processed_cell * slopes_per_cell;
+  const double start_slope = centre_slope - half_slopes;
+  const double end_slope = centre_slope + half_slopes;
+  bool extended = false;
+  if (obstacles->active_count > 0) {
+    if (!(TCODFOV_access_get(fov, kind, prev_x, prev_y) && TCODFOV_access_get(transparent, kind, prev_x, prev_y)) &&
+        !(TCODFOV_access_get(fov, kind, prev_diagonal_x, prev_diagonal_y) &&
+          TCODFOV_access_get(transparent, kind, prev_diagonal_x, prev_diagonal_y))) {
+      return false;
+    }
+    if (obstacles_hide_cell(
+            obstacles, start_slope, centre_slope, end_slope, TCODFOV_access_get(transparent, kind, x, y), &extended)) {
+      return false;
+    }
+  }
+  TCODFOV_access_set(fov, kind, x, y, true);
+  /* if the cell is opaque, block the adjacent slopes */
+  if (!TCODFOV_access_get(transparent, kind, x, y)) {
+    if (*min_angle >= start_slope) {
+      *min_angle = end_slope;
+      /* if min_angle is applied to the last cell in line, nothing more
+         needs to be checked. */
+      if (processed_cell == iteration) {
+        *done = true;
+      }
+    } else if (!extended) {
+      obstacles->pending[obstacles->pending_count++] = (Obstacle){start_slope, end_slope};
+    }
+    if (!light_walls) {
+      TCODFOV_access_set(fov, kind, x, y, false);
+    }
+  }
+  return true;
+}
+TCODFOV_FORCE_INLINE void compute_quadrant_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
     int pov_x,
     int pov_y,
     int max_radius,
     bool light_walls,
     int dx,
     int dy,
-    double* __restrict start_angle,
-    double* __restrict end_angle) {
+    Obstacle* __restrict obstacle_buffer,
+    int max_obstacles,
+    const TCODFOV_MapKind kind) {
   /* octant: vertical edge */
   {
     int iteration = 1; /* iteration of the algo for this octant */
     bool done = false;
-    int total_obstacles = 0;
-    int obstacles_in_last_line = 0;
+    ObstacleSet obstacles = {.active = obstacle_buffer, .pending = obstacle_buffer + max_obstacles};
     double min_angle = 0.0;
 
     /* do while there are unblocked slopes left and the algo is within the map's boundaries
        scan progressive lines/columns from the PC outwards */
     int y = pov_y + dy; /* the outer slope's coordinates (first processed line) */
-    if (y < 0 || y >= TCODFOV_map2d_get_height(fov)) {
+    if (y < 0 || y >= fov->height) {
       done = true;
     }
     while (!done) {
@@ -71,70 +218,39 @@ static void compute_quadrant(
       const double half_slopes = slopes_per_cell * 0.5;
       int processed_cell = (int)((min_angle + half_slopes) / slopes_per_cell);
       const int minx = TCODFOV_MAX(0, pov_x - iteration);
-      const int maxx = TCODFOV_MIN(TCODFOV_map2d_get_width(fov) - 1, pov_x + iteration);
+      const int maxx = TCODFOV_MIN(fov->width - 1, pov_x + iteration);
       done = true;
+      bool line_done = false;
       for (int x = pov_x + (processed_cell * dx); x >= minx && x <= maxx; x += dx) {
-        /* calculate slopes per cell */
-        bool visible = true;
-        bool extended = false;
-        const double centre_slope = (double)processed_cell * slopes_per_cell;
-        const double start_slope = centre_slope - half_slopes;
-        const double end_slope = centre_slope + half_slopes;
-        if (obstacles_in_last_line > 0) {
-          if (!(TCODFOV_map2d_get_bool(fov, x, y - dy) && TCODFOV_map2d_get_bool(transparent, x, y - dy)) &&
-              !(TCODFOV_map2d_get_bool(fov, x - dx, y - dy) && TCODFOV_map2d_get_bool(transparent, x - dx, y - dy))) {
-            visible = false;
-          } else {
-            int idx;
-            for (idx = 0; idx < obstacles_in_last_line && visible; ++idx) {
-              if (start_slope <= end_angle[idx] && end_slope >= start_angle[idx]) {
-                if (TCODFOV_map2d_get_bool(transparent, x, y)) {
-                  if (centre_slope > start_angle[idx] && centre_slope < end_angle[idx]) {
-                    visible = false;
-                  }
-                } else {
-                  if (start_slope >= start_angle[idx] && end_slope <= end_angle[idx]) {
-                    visible = false;
-                  } else {
-                    start_angle[idx] = TCODFOV_MIN(start_angle[idx], start_slope);
-                    end_angle[idx] = TCODFOV_MAX(end_angle[idx], end_slope);
-                    extended = true;
-                  }
-                }
-              }
-            }
-          }
-        }
-        if (visible) {
+        if (compute_cell(
+                transparent,
+                fov,
+                &obstacles,
+                x,
+                y,
+                x,
+                y - dy,
+                x - dx,
+                y - dy,
+                processed_cell,
+                iteration,
+                slopes_per_cell,
+                &min_angle,
+                &line_done,
+                light_walls,
+                kind)) {
           done = false;
-          TCODFOV_map2d_set_bool(fov, x, y, true);
-          /* if the cell is opaque, block the adjacent slopes */
-          if (!TCODFOV_map2d_get_bool(transparent, x, y)) {
-            if (min_angle >= start_slope) {
-              min_angle = end_slope;
-              /* if min_angle is applied to the last cell in line, nothing more
-                 needs to be checked. */
-              if (processed_cell == iteration) {
-                done = true;
-              }
-            } else if (!extended) {
-              start_angle[total_obstacles] = start_slope;
-              end_angle[total_obstacles++] = end_slope;
-            }
-            if (!light_walls) {
-              TCODFOV_map2d_set_bool(fov, x, y, false);
-            }
-          }
         }
         processed_cell++;
       }
+      done = done || line_done;
       if (iteration == max_radius) {
         done = true;
       }
       iteration++;
-      obstacles_in_last_line = total_obstacles;
+      obstacles_end_line(&obstacles);
       y += dy;
-      if (y < 0 || y >= TCODFOV_map2d_get_height(fov)) {
+      if (y < 0 || y >= fov->height) {
         done = true;
       }
     }
@@ -144,14 +260,13 @@ static void compute_quadrant(
   {
     int iteration = 1; /* iteration of the algo for this octant */
     bool done = false;
-    int total_obstacles = 0;
-    int obstacles_in_last_line = 0;
+    ObstacleSet obstacles = {.active = obstacle_buffer, .pending = obstacle_buffer + max_obstacles};
     double min_angle = 0.0;
 
     /* do while there are unblocked slopes left and the algo is within the map's boundaries
        scan progressive lines/columns from the PC outwards */
     int x = pov_x + dx; /*the outer slope's coordinates (first processed line) */
-    if (x < 0 || x >= TCODFOV_map2d_get_width(fov)) {
+    if (x < 0 || x >= fov->width) {
       done = true;
     }
     while (!done) {
@@ -160,84 +275,75 @@ static void compute_quadrant(
       const double half_slopes = slopes_per_cell * 0.5;
       int processed_cell = (int)((min_angle + half_slopes) / slopes_per_cell);
       const int miny = TCODFOV_MAX(0, pov_y - iteration);
-      const int maxy = TCODFOV_MIN(TCODFOV_map2d_get_height(fov) - 1, pov_y + iteration);
+      const int maxy = TCODFOV_MIN(fov->height - 1, pov_y + iteration);
       done = true;
+      bool line_done = false;
       for (int y = pov_y + (processed_cell * dy); y >= miny && y <= maxy; y += dy) {
-        /* calculate slopes per cell */
-        bool visible = true;
-        bool extended = false;
-        const double centre_slope = (double)processed_cell * slopes_per_cell;
-        const double start_slope = centre_slope - half_slopes;
-        const double end_slope = centre_slope + half_slopes;
-        if (obstacles_in_last_line > 0) {
-          if (!(TCODFOV_map2d_get_bool(fov, x - dx, y) && TCODFOV_map2d_get_bool(transparent, x - dx, y)) &&
-              !(TCODFOV_map2d_get_bool(fov, x - dx, y - dy) && TCODFOV_map2d_get_bool(transparent, x - dx, y - dy))) {
-            visible = false;
-          } else {
-            int idx;
-            for (idx = 0; idx < obstacles_in_last_line && visible; ++idx) {
-              if (start_slope <= end_angle[idx] && end_slope >= start_angle[idx]) {
-                if (TCODFOV_map2d_get_bool(transparent, x, y)) {
-                  if (centre_slope > start_angle[idx] && centre_slope < end_angle[idx]) {
-                    visible = false;
-                  }
-                } else {
-                  if (start_slope >= start_angle[idx] && end_slope <= end_angle[idx]) {
-                    visible = false;
-                  } else {
-                    start_angle[idx] = TCODFOV_MIN(start_angle[idx], start_slope);
-                    end_angle[idx] = TCODFOV_MAX(end_angle[idx], end_slope);
-                    extended = true;
-                  }
-                }
-                ++idx;
-              }
-            }
-          }
-        }
-        if (visible) {
+        if (compute_cell(
+                transparent,
+                fov,
+                &obstacles,
+                x,
+                y,
+                x - dx,
+                y,
+                x - dx,
+                y - dy,
+                processed_cell,
+                iteration,
+                slopes_per_cell,
+                &min_angle,
+                &line_done,
+                light_walls,
+                kind)) {
           done = false;
-          TCODFOV_map2d_set_bool(fov, x, y, true);
-          /* if the cell is opaque, block the adjacent slopes */
-          if (!TCODFOV_map2d_get_bool(transparent, x, y)) {
-            if (min_angle >= start_slope) {
-              min_angle = end_slope;
-              /* if min_angle is applied to the last cell in line, nothing more
-                 needs to be checked. */
-              if (processed_cell == iteration) {
-                done = true;
-              }
-            } else if (!extended) {
-              start_angle[total_obstacles] = start_slope;
-              end_angle[total_obstacles++] = end_slope;
-            }
-            if (!light_walls) {
-              TCODFOV_map2d_set_bool(fov, x, y, false);
-            }
-          }
         }
         processed_cell++;
       }
+      done = done || line_done;
       if (iteration == max_radius) {
         done = true;
       }
       iteration++;
-      obstacles_in_last_line = total_obstacles;
+      obstacles_end_line(&obstacles);
       x += dx;
-      if (x < 0 || x >= TCODFOV_map2d_get_width(fov)) {
+      if (x < 0 || x >= fov->width) {
         done = true;
       }
     }
   }
 }
 
-TCODFOV_Error TCODFOV_map_compute_fov_restrictive_shadowcasting(
+/**
+    Dispatch `compute_quadrant_kind` for the storage kind shared by both maps.
+ */
+static void compute_quadrant(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int dx,
+    int dy,
+    Obstacle* __restrict obstacle_buffer,
+    int max_obstacles,
+    TCODFOV_MapKind kind) {
+  TCODFOV_MAP_KIND_SWITCH(
+      kind,
+      K,
+      compute_quadrant_kind(
+          transparent, fov, pov_x, pov_y, max_radius, light_walls, dx, dy, obstacle_buffer, max_obstacles, K));
+}
+
+TCODFOV_Error TCODFOV_map_compute_fov_restrictive_shadowcasting_(
     const TCODFOV_Map2D* __restrict transparent,
     TCODFOV_Map2D* __restrict fov,  // Must be read/write
     int pov_x,
     int pov_y,
     int max_radius,
-    bool light_walls) {
+    bool light_walls,
+    TCODFOV_Workspace* __restrict workspace) {
   if (!TCODFOV_map2d_in_bounds(fov, pov_x, pov_y)) {
     TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
     return TCODFOV_E_INVALID_ARGUMENT;
@@ -245,23 +351,43 @@ TCODFOV_Error TCODFOV_map_compute_fov_restrictive_shadowcasting(
   /* set PC's position as visible */
   TCODFOV_map2d_set_bool(fov, pov_x, pov_y, true);
 
-  /* calculate an approximated (excessive, just in case) maximum number of obstacles per octant */
-  const int max_obstacles = TCODFOV_MAX((TCODFOV_map2d_get_width(fov) * TCODFOV_map2d_get_height(fov)) / 7, 16);
-  double* start_angle = malloc(max_obstacles * sizeof(*start_angle));
-  double* end_angle = malloc(max_obstacles * sizeof(*end_angle));
-  if (!start_angle || !end_angle) {
-    free(end_angle);
-    free(start_angle);
-    TCODFOV_set_errorv("Out of memory.");
-    return TCODFOV_E_OUT_OF_MEMORY;
-  }
+  /* Each obstacle starts as one cell of a line, at least `1 / max_lines` slopes wide, and merging only widens it.
+     Obstacles never overlap and all of them lie within the [-0.5, 1.5] range of slopes, so at most `2 * max_lines`
+     of them fit, with two more for rounding.  The number of lines is limited by the radius and by the map. */
+  int max_lines = TCODFOV_MAX(TCODFOV_map2d_get_width(fov), TCODFOV_map2d_get_height(fov));
+  if (max_radius > 0) max_lines = TCODFOV_MIN(max_lines, max_radius);
+  const int max_obstacles = max_lines * 2 + 2;
+  Obstacle* obstacle_buffer = TCODFOV_workspace_reserve_(
+      workspace, TCODFOV_SCRATCH_ANGLES, (size_t)max_obstacles * 2 * sizeof(*obstacle_buffer));
+  if (!obstacle_buffer) return TCODFOV_E_OUT_OF_MEMORY;
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
   /* compute the 4 quadrants of the map */
-  compute_quadrant(transparent, fov, pov_x, pov_y, max_radius, light_walls, 1, 1, start_angle, end_angle);
-  compute_quadrant(transparent, fov, pov_x, pov_y, max_radius, light_walls, 1, -1, start_angle, end_angle);
-  compute_quadrant(transparent, fov, pov_x, pov_y, max_radius, light_walls, -1, 1, start_angle, end_angle);
-  compute_quadrant(transparent, fov, pov_x, pov_y, max_radius, light_walls, -1, -1, start_angle, end_angle);
-
-  free(end_angle);
-  free(start_angle);
+  compute_quadrant(
+      &transparent_access, &fov_access, pov_x, pov_y, max_radius, light_walls, 1, 1, obstacle_buffer, max_obstacles,
+      kind);
+  compute_quadrant(
+      &transparent_access, &fov_access, pov_x, pov_y, max_radius, light_walls, 1, -1, obstacle_buffer, max_obstacles,
+      kind);
+  compute_quadrant(
+      &transparent_access, &fov_access, pov_x, pov_y, max_radius, light_walls, -1, 1, obstacle_buffer, max_obstacles,
+      kind);
+  compute_quadrant(
+      &transparent_access, &fov_access, pov_x, pov_y, max_radius, light_walls, -1, -1, obstacle_buffer, max_obstacles,
+      kind);
   return TCODFOV_E_OK;
 }
+TCODFOV_Error TCODFOV_map_compute_fov_restrictive_shadowcasting(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,  // Must be read/write
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls) {
+  TCODFOV_Workspace workspace = {0};
+  const TCODFOV_Error err = TCODFOV_map_compute_fov_restrictive_shadowcasting_(
+      transparent, fov, pov_x, pov_y, max_radius, light_walls, &workspace);
+  TCODFOV_workspace_release_(&workspace);
+  return err;
+}
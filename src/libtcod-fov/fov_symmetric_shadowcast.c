@@ -33,15 +33,24 @@
     Symmetric Shadowcasting algorithm.
 
     Based on: https://www.albertford.com/shadowcasting/
+
+    Bitpacked maps with a radius up to 31 are copied into a 64x64 bitboard window and scanned 64 tiles at a time.
  */
 #include <float.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "fov.h"
 #include "libtcod_int.h"
+#include "map_access.h"
 #include "map_inline.h"
 #include "map_types.h"
+#include "parallel.h"
+#include "utility.h"
+#include "work_stack.h"
 /**
     Quadrant transformation matrixes.
 
@@ -60,7 +69,10 @@ typedef struct Row {
   const int pov_x;  // The origin point-of-view.
   const int pov_y;
   const int quadrant;  // The quadrant index.
+  const int radius_squared;  // Tiles at or past this squared distance are not visible, or 0 for no limit.
+  const bool light_walls;  // If true then visible walls are marked as visible.
   int depth;  // The depth of this row.
+  int visible_limit;  // Columns further from zero than this are outside of the radius on this row.
   float slope_low;
   const float slope_high;
 } Row;
@@ -89,53 +101,625 @@ static int round_half_up(float n) { return (int)roundf(n * (1 + FLT_EPSILON)); }
  */
 static int round_half_down(float n) { return (int)roundf(n * (1 - FLT_EPSILON)); }
 /**
-    Scan a row and recursively scan all of its children.
+    Number of pending rows kept on the C stack before the work stack moves to the heap.
+ */
+#define ROW_INLINE_CAPACITY 64
+/**
+    Return the largest non-negative `column` where `column * column + bias` is less than `limit`.
+
+    Returns -1 if there is no such column.
+ */
+static int max_column_below(int limit, int bias) {
+  if (bias >= limit) return -1;
+  int column = (int)sqrt((double)(limit - bias));
+  while (column > 0 && column * column + bias >= limit) --column;
+  while ((column + 1) * (column + 1) + bias < limit) ++column;
+  return column;
+}
+/**
+    Mark the tiles of `row` in the column range `[column_begin, column_end)` as visible.
+
+    The row must run along the x-axis of a bitpacked map.
+ */
+static void fill_columns_bitpacked(
+    TCODFOV_MapAccess* __restrict fov, const Row* __restrict row, int column_begin, int column_end) {
+  column_begin = TCODFOV_MAX(column_begin, -row->visible_limit);
+  column_end = TCODFOV_MIN(column_end, row->visible_limit + 1);
+  if (column_begin >= column_end) return;
+  const int xy = quadrant_table[row->quadrant][1];
+  const int map_y = row->pov_y + row->depth * quadrant_table[row->quadrant][2];
+  if (xy > 0) {
+    TCODFOV_bitpacked_row_fill(fov, row->pov_x + column_begin, row->pov_x + column_end, map_y, true);
+  } else {
+    TCODFOV_bitpacked_row_fill(fov, row->pov_x - column_end + 1, row->pov_x - column_begin + 1, map_y, true);
+  }
+}
+/**
+    Scan a row which runs along the x-axis of a bitpacked map, one run of floors or walls at a time.
 
-    If you think of each quadrant as a tree of rows, this essentially is a depth-first tree traversal.
+    This has the same effects as the per-tile loop of `scan_kind` but only does work at the edges of each run.
+    Only the columns `[column_first, column_last]` are scanned.
+    `last_tile_is_wall` is set to true if the last in-bounds tile was a wall.
  */
-static void scan(const TCODFOV_Map2D* __restrict transparent, TCODFOV_Map2D* __restrict fov, Row* __restrict row) {
+static TCODFOV_Error scan_row_bitpacked(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    Row* __restrict row,
+    int column_min,
+    int column_first,
+    int column_last,
+    TCODFOV_WorkStack* __restrict pending,
+    bool* __restrict last_tile_is_wall) {
+  const int xy = quadrant_table[row->quadrant][1];  // +1 or -1, columns run along the x-axis.
+  const int map_y = row->pov_y + row->depth * quadrant_table[row->quadrant][2];
+  // Clip the columns to the map, out-of-bounds tiles are skipped entirely.
+  column_first = TCODFOV_MAX(column_first, xy > 0 ? -row->pov_x : row->pov_x - fov->width + 1);
+  column_last = TCODFOV_MIN(column_last, xy > 0 ? fov->width - 1 - row->pov_x : row->pov_x);
+  bool prev_tile_is_wall = false;
+  for (int column = column_first; column <= column_last;) {
+    const int map_x = row->pov_x + column * xy;
+    const bool is_wall = !TCODFOV_access_get(transparent, TCODFOV_MAP_KIND_BITPACKED, map_x, map_y);
+    const int run_end =  // The column after this run of walls or floors.
+        xy > 0
+            ? TCODFOV_bitpacked_row_find_next(transparent, map_x, row->pov_x + column_last + 1, map_y, !is_wall) -
+                  row->pov_x
+            : row->pov_x -
+                  TCODFOV_bitpacked_row_find_prev(transparent, map_x, row->pov_x - column_last - 1, map_y, !is_wall);
+    if (is_wall) {
+      if (row->light_walls) fill_columns_bitpacked(fov, row, column, run_end);
+      if (column != column_min && !prev_tile_is_wall) {  // Wall tile to floor tile.
+        Row next_row = {
+            .pov_x = row->pov_x,
+            .pov_y = row->pov_y,
+            .quadrant = row->quadrant,
+            .radius_squared = row->radius_squared,
+            .light_walls = row->light_walls,
+            .depth = row->depth + 1,
+            .slope_low = row->slope_low,
+            .slope_high = slope(row->depth, column),
+        };
+        const TCODFOV_Error err = TCODFOV_work_stack_push(pending, &next_row);
+        if (err < 0) return err;
+      }
+    } else {
+      if (is_symmetric(row, column)) fill_columns_bitpacked(fov, row, column, column + 1);
+      if (prev_tile_is_wall) {  // Floor tile to wall tile.
+        row->slope_low = slope(row->depth, column);  // Shrink the view.
+      }
+      // The symmetric tiles of the remaining floors are contiguous, trim the asymmetric tiles from both ends.
+      int symmetric_begin = column + 1;
+      int symmetric_end = run_end;
+      while (symmetric_begin < symmetric_end && !is_symmetric(row, symmetric_begin)) ++symmetric_begin;
+      while (symmetric_begin < symmetric_end && !is_symmetric(row, symmetric_end - 1)) --symmetric_end;
+      fill_columns_bitpacked(fov, row, symmetric_begin, symmetric_end);
+    }
+    prev_tile_is_wall = is_wall;
+    column = run_end;
+  }
+  *last_tile_is_wall = prev_tile_is_wall;
+  return TCODFOV_E_OK;
+}
+/**
+    Scan `row` and the rows after it while the view stays open.
+
+    Child rows split off by walls are pushed to `pending`.
+    If you think of each quadrant as a tree of rows, `pending` holds the branches of a depth-first tree traversal.
+ */
+TCODFOV_FORCE_INLINE TCODFOV_Error scan_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    Row* __restrict row,
+    TCODFOV_WorkStack* __restrict pending,
+    const TCODFOV_MapKind kind) {
   const int xx = quadrant_table[row->quadrant][0];
   const int xy = quadrant_table[row->quadrant][1];
   const int yx = quadrant_table[row->quadrant][2];
   const int yy = quadrant_table[row->quadrant][3];
-  if (!TCODFOV_map2d_in_bounds(fov, row->pov_x + row->depth * xx, row->pov_y + row->depth * yx)) {
-    return;  // Row->depth is out-of-bounds.
+  for (;; ++row->depth) {
+    if (!TCODFOV_access_in_bounds(fov, row->pov_x + row->depth * xx, row->pov_y + row->depth * yx)) {
+      return TCODFOV_E_OK;  // Row->depth is out-of-bounds.
+    }
+    const int column_min = round_half_up(row->depth * row->slope_low);
+    const int column_max = round_half_down(row->depth * row->slope_high);
+    int column_first = column_min;
+    int column_last = column_max;
+    if (row->radius_squared > 0) {
+      const int depth_squared = row->depth * row->depth;
+      if (depth_squared >= row->radius_squared) return TCODFOV_E_OK;  // This and all further rows are out of radius.
+      row->visible_limit = max_column_below(row->radius_squared, depth_squared);
+      // Tiles are scanned while their inner half could still be within the radius, since walls there still cast
+      // shadows which reach back into the radius.  Tiles past that only shadow tiles outside of the radius.
+      // This is max_column_below for (2 * column - 1)^2 / 4 + depth^2 < radius^2.
+      const int scan_limit = (max_column_below(4 * row->radius_squared, 4 * depth_squared) + 1) / 2;
+      column_first = TCODFOV_MAX(column_first, -scan_limit);
+      column_last = TCODFOV_MIN(column_last, scan_limit);
+    } else {
+      row->visible_limit = TCODFOV_MAX(TCODFOV_ABS(column_min), TCODFOV_ABS(column_max));
+    }
+    bool prev_tile_is_wall = false;
+    if (kind == TCODFOV_MAP_KIND_BITPACKED && xy != 0) {
+      const TCODFOV_Error err = scan_row_bitpacked(
+          transparent, fov, row, column_min, column_first, column_last, pending, &prev_tile_is_wall);
+      if (err < 0) return err;
+    } else {
+      for (int column = column_first; column <= column_last; ++column) {
+        const int map_x = row->pov_x + row->depth * xx + column * xy;
+        const int map_y = row->pov_y + row->depth * yx + column * yy;
+        if (!TCODFOV_access_in_bounds(fov, map_x, map_y)) {
+          continue;  // Tile is out-of-bounds.
+        }
+        const bool is_wall = !TCODFOV_access_get(transparent, kind, map_x, map_y);
+        if ((is_wall ? row->light_walls : is_symmetric(row, column)) && TCODFOV_ABS(column) <= row->visible_limit) {
+          TCODFOV_access_set(fov, kind, map_x, map_y, true);
+        }
+        if (prev_tile_is_wall && !is_wall) {  // Floor tile to wall tile.
+          row->slope_low = slope(row->depth, column);  // Shrink the view.
+        }
+        if (column != column_min && !prev_tile_is_wall && is_wall) {  // Wall tile to floor tile.
+          // Track the slopes of the last transparent tiles and queue them.
+          const Row next_row = {
+              .pov_x = row->pov_x,
+              .pov_y = row->pov_y,
+              .quadrant = row->quadrant,
+              .radius_squared = row->radius_squared,
+              .light_walls = row->light_walls,
+              .depth = row->depth + 1,
+              .slope_low = row->slope_low,
+              .slope_high = slope(row->depth, column),
+          };
+          const TCODFOV_Error err = TCODFOV_work_stack_push(pending, &next_row);
+          if (err < 0) return err;
+        }
+        prev_tile_is_wall = is_wall;
+      }
+    }
+    if (prev_tile_is_wall) return TCODFOV_E_OK;
+    // Continue into the next row.
   }
-  const int column_min = round_half_up(row->depth * row->slope_low);
-  const int column_max = round_half_down(row->depth * row->slope_high);
-  bool prev_tile_is_wall = false;
-  for (int column = column_min; column <= column_max; ++column) {
-    const int map_x = row->pov_x + row->depth * xx + column * xy;
-    const int map_y = row->pov_y + row->depth * yx + column * yy;
-    if (!TCODFOV_map2d_in_bounds(fov, map_x, map_y)) {
-      continue;  // Tile is out-of-bounds.
-    }
-    const bool is_wall = !TCODFOV_map2d_get_bool(transparent, map_x, map_y);
-    if (is_wall || is_symmetric(row, column)) {
-      TCODFOV_map2d_set_bool(fov, map_x, map_y, true);
-    }
-    if (prev_tile_is_wall && !is_wall) {  // Floor tile to wall tile.
-      row->slope_low = slope(row->depth, column);  // Shrink the view.
-    }
-    if (column != column_min && !prev_tile_is_wall && is_wall) {  // Wall tile to floor tile.
-      // Track the slopes of the last transparent tiles and recurse into them.
-      Row next_row = {
-          .pov_x = row->pov_x,
-          .pov_y = row->pov_y,
-          .quadrant = row->quadrant,
-          .depth = row->depth + 1,
-          .slope_low = row->slope_low,
-          .slope_high = slope(row->depth, column),
-      };
-      scan(transparent, fov, &next_row);
+}
+/**
+    Scan all rows of a quadrant, starting with the full quadrant.
+ */
+TCODFOV_FORCE_INLINE TCODFOV_Error scan_quadrant_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    const Row* __restrict first_row,
+    const TCODFOV_MapKind kind) {
+  Row inline_rows[ROW_INLINE_CAPACITY];
+  TCODFOV_WorkStack pending = TCODFOV_work_stack_init(inline_rows, ROW_INLINE_CAPACITY, sizeof(Row));
+  TCODFOV_Error err = TCODFOV_work_stack_push(&pending, first_row);
+  const Row* next_row;
+  while (err >= 0 && (next_row = TCODFOV_work_stack_pop(&pending)) != NULL) {
+    Row row = *next_row;
+    err = scan_kind(transparent, fov, &row, &pending, kind);
+  }
+  TCODFOV_work_stack_free(&pending);
+  return err;
+}
+/**
+    The largest radius computed with the bitboard kernel.
+
+    Every tile scanned within this radius fits in a 64x64 window centered on the point-of-view.
+ */
+#define BITBOARD_MAX_RADIUS 31
+/**
+    Bit of a bitboard row holding column zero, the column of the point-of-view.
+ */
+#define BITBOARD_CENTER 32
+/**
+    Windows within this radius are transposed one tile at a time instead of as a whole.
+ */
+#define BITBOARD_TRANSPOSE_RADIUS 16
+/**
+    Consecutive views which are checked against the lit tiles before a quadrant stops checking.
+ */
+#define BITBOARD_MAX_LIT_CHECK_FAILURES 4
+/**
+    Misses in a row before a union stops checking for lit tiles, a point-of-view which skips fewer rows than its
+    radius is a miss.
+ */
+#define UNION_MAX_MISSES 1
+/**
+    A union which stopped checking for lit tiles checks again for every point-of-view at this interval.
+ */
+#define UNION_RETRY_INTERVAL 8
+/**
+    A pending view of the bitboard kernel.
+ */
+typedef struct BitboardRow {
+  int depth;
+  float slope_low;
+  float slope_high;
+} BitboardRow;
+/**
+    Return `word` with the order of its bits reversed.
+ */
+static uint64_t reverse_bits64(uint64_t word) {
+  word = ((word >> 1) & 0x5555555555555555) | ((word & 0x5555555555555555) << 1);
+  word = ((word >> 2) & 0x3333333333333333) | ((word & 0x3333333333333333) << 2);
+  word = ((word >> 4) & 0x0F0F0F0F0F0F0F0F) | ((word & 0x0F0F0F0F0F0F0F0F) << 4);
+  word = ((word >> 8) & 0x00FF00FF00FF00FF) | ((word & 0x00FF00FF00FF00FF) << 8);
+  word = ((word >> 16) & 0x0000FFFF0000FFFF) | ((word & 0x0000FFFF0000FFFF) << 16);
+  return (word >> 32) | (word << 32);
+}
+/**
+    Mirror a bitboard row around `BITBOARD_CENTER`, moving column `c` to column `-c`.
+
+    This is its own inverse for the columns `[-31, 31]`.
+ */
+static uint64_t bitboard_mirror(uint64_t row) { return reverse_bits64(row) << 1; }
+/**
+    Transpose a 64x64 bitboard in place, so that bit `x` of row `y` becomes bit `y` of row `x`.
+ */
+static void bitboard_transpose(uint64_t* __restrict board) {
+  uint64_t mask = 0x00000000FFFFFFFF;
+  for (int width = 32; width; width >>= 1, mask ^= mask << width) {
+    for (int y = 0; y < 64; y = (y + width + 1) & ~width) {
+      const uint64_t swap = ((board[y] >> width) ^ board[y + width]) & mask;
+      board[y] ^= swap << width;
+      board[y + width] ^= swap;
     }
-    prev_tile_is_wall = is_wall;
   }
-  if (!prev_tile_is_wall) {
-    // Tail recuse into the next row.
-    row->depth += 1;
-    scan(transparent, fov, row);
+}
+/**
+    Return the bits of the columns `[column_first, column_last]`, which must be within `[-32, 31]` if not empty.
+ */
+static uint64_t bitboard_columns(int column_first, int column_last) {
+  if (column_first > column_last) return 0;
+  const uint64_t below_end =
+      column_last + 1 + BITBOARD_CENTER >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << (column_last + 1 + BITBOARD_CENTER)) - 1;
+  return below_end & (~(uint64_t)0 << (column_first + BITBOARD_CENTER));
+}
+/**
+    Transpose the tiles within `radius` of the center of `board` into `out`, which must be zeroed.
+
+    Small radii set each tile one at a time, which is cheaper than transposing the whole board.
+ */
+static void bitboard_transpose_radius(const uint64_t* __restrict board, uint64_t* __restrict out, int radius) {
+  if (radius > BITBOARD_TRANSPOSE_RADIUS) {
+    memcpy(out, board, 64 * sizeof(*out));
+    bitboard_transpose(out);
+    return;
+  }
+  const uint64_t square = bitboard_columns(-radius, radius);
+  for (int y = BITBOARD_CENTER - radius; y <= BITBOARD_CENTER + radius; ++y) {
+    for (uint64_t bits = board[y] & square; bits; bits &= bits - 1) out[TCODFOV_ctz64(bits)] |= (uint64_t)1 << y;
+  }
+}
+/**
+    Return true if `row` and the views split from it can not mark any of the tiles in `unlit[depth]`.
+
+    Split views stay between the slopes of `row`, so this checks those slopes with one extra column on each side to
+    cover rounding.  A row of walls stops every view which scans it, but a view of zero width can pass exactly
+    between two walls.  No view can do this on two rows in a row, so the check stops at the second row in a row
+    where every tile between the slopes is a scanned wall.
+ */
+static bool bitboard_view_is_lit(
+    const BitboardRow* __restrict row,
+    const uint64_t* __restrict tiles,
+    const uint64_t* __restrict scan_masks,
+    const uint64_t* __restrict unlit,
+    const uint64_t* __restrict out,
+    int last_depth) {
+  int wall_rows = 0;
+  for (int depth = row->depth; depth <= last_depth; ++depth) {
+    // Flooring through a positive offset avoids calling into libm, `depth * slope` is never below -BITBOARD_CENTER.
+    const int low_floor = (int)(depth * row->slope_low + BITBOARD_CENTER) - BITBOARD_CENTER;
+    const int high_ceil = BITBOARD_CENTER - (int)(BITBOARD_CENTER - depth * row->slope_high);
+    const uint64_t cone = bitboard_columns(low_floor - 1, high_ceil + 1);
+    if (cone & unlit[depth] & ~out[depth]) return false;
+    wall_rows = cone & (tiles[depth] | ~scan_masks[depth]) ? 0 : wall_rows + 1;
+    if (wall_rows == 2) return true;
+  }
+  return true;
+}
+/**
+    Scan one quadrant of a bitboard window, one row of 64 tiles at a time.
+
+    `tiles[depth]` holds the transparent tiles of each row of the quadrant and `scan_masks[depth]` holds the columns
+    which are within the map and the scanned radius.  Visible tiles are set in `out[depth]`, which must be zeroed.
+    `visible_masks[depth]` holds the columns within the radius.  `last_depth` is the last depth within the map and
+    radius.  If `unlit` is not NULL then views which can not mark any tile in `unlit[depth]` are skipped and the rows
+    they would have scanned are added to `skipped_rows`.
+
+    This has the same effects as `scan_kind`.  Floors are visible unless they are one of the two end tiles and their
+    center is outside of the view, so only the runs of walls and floors which split the view are visited one by one.
+ */
+static TCODFOV_Error bitboard_scan_quadrant(
+    const uint64_t* __restrict tiles,
+    const uint64_t* __restrict scan_masks,
+    const uint64_t* __restrict visible_masks,
+    const uint64_t* __restrict unlit,
+    uint64_t* __restrict out,
+    int last_depth,
+    bool light_walls,
+    int* __restrict skipped_rows) {
+  BitboardRow inline_rows[ROW_INLINE_CAPACITY];
+  TCODFOV_WorkStack pending = TCODFOV_work_stack_init(inline_rows, ROW_INLINE_CAPACITY, sizeof(BitboardRow));
+  TCODFOV_Error err = TCODFOV_work_stack_push(&pending, &(BitboardRow){.depth = 1, .slope_low = -1, .slope_high = 1});
+  const BitboardRow* next_row;
+  int check_failures = 0;  // Checks which did not skip a view since the last one which did.
+  while (err >= 0 && (next_row = TCODFOV_work_stack_pop(&pending)) != NULL) {
+    BitboardRow row = *next_row;
+    if (unlit && check_failures < BITBOARD_MAX_LIT_CHECK_FAILURES) {
+      if (bitboard_view_is_lit(&row, tiles, scan_masks, unlit, out, last_depth)) {
+        check_failures = 0;
+        *skipped_rows += last_depth - row.depth + 1;
+        continue;
+      }
+      ++check_failures;
+    }
+    for (; row.depth <= last_depth; ++row.depth) {
+      const int depth = row.depth;
+      const int column_min = round_half_up(depth * row.slope_low);
+      const int column_max = round_half_down(depth * row.slope_high);
+      const uint64_t scanned = bitboard_columns(column_min, column_max) & scan_masks[depth];
+      if (!scanned) continue;  // The view continues unchanged.
+      const uint64_t walls = scanned & ~tiles[depth];
+      const uint64_t floors = scanned & tiles[depth];
+      uint64_t visible = floors;
+      if (!(column_min >= depth * row.slope_low)) visible &= ~bitboard_columns(column_min, column_min);
+      if (!(column_max <= depth * row.slope_high)) visible &= ~bitboard_columns(column_max, column_max);
+      if (light_walls) visible |= walls;
+      out[depth] |= visible & visible_masks[depth];
+      // Walls after floors split off the view so far, floors after walls start a new view.
+      const uint64_t wall_starts = walls & ~(walls << 1) & ~bitboard_columns(column_min, column_min);
+      const uint64_t floor_starts = floors & (walls << 1);
+      for (uint64_t starts = wall_starts | floor_starts; starts; starts &= starts - 1) {
+        const int bit = TCODFOV_ctz64(starts);
+        if (floor_starts >> bit & 1) {
+          row.slope_low = slope(depth, bit - BITBOARD_CENTER);  // Shrink the view.
+          continue;
+        }
+        const BitboardRow split_row = {
+            .depth = depth + 1, .slope_low = row.slope_low, .slope_high = slope(depth, bit - BITBOARD_CENTER)};
+        err = TCODFOV_work_stack_push(&pending, &split_row);
+        if (err < 0) break;
+      }
+      if (err < 0 || walls >> (63 - TCODFOV_clz64(scanned)) & 1) break;  // The last tile was a wall.
+    }
+  }
+  TCODFOV_work_stack_free(&pending);
+  return err;
+}
+/**
+    Compute the field-of-view of bitpacked maps within a radius of `BITBOARD_MAX_RADIUS` using a bitboard window.
+
+    The window is loaded once and transposed, so that all four quadrants scan rows of 64 tiles at once.
+    If `skipped_rows` is not NULL then views which would only mark tiles already set in `fov` are skipped and the
+    rows they would have scanned are added to `skipped_rows`.
+ */
+static TCODFOV_Error compute_symmetric_bitboard(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int* __restrict skipped_rows) {
+  const bool skip_lit = skipped_rows != NULL;
+  if (light_walls || TCODFOV_access_get(transparent, TCODFOV_MAP_KIND_BITPACKED, pov_x, pov_y)) {
+    TCODFOV_access_set(fov, TCODFOV_MAP_KIND_BITPACKED, pov_x, pov_y, true);
+  }
+  const int window_x = pov_x - BITBOARD_CENTER;
+  const int window_y = pov_y - BITBOARD_CENTER;
+  uint64_t rows[64] = {0};  // Bit `x` of row `y` is tile `window_x + x, window_y + y`.
+  uint64_t columns[64] = {0};  // The transpose of `rows`.
+  const int y_first = TCODFOV_MAX(BITBOARD_CENTER - max_radius, -window_y);
+  const int y_last = TCODFOV_MIN(BITBOARD_CENTER + max_radius, fov->height - 1 - window_y);
+  for (int y = y_first; y <= y_last; ++y) rows[y] = TCODFOV_bitpacked_row_load64(transparent, window_x, window_y + y);
+  bitboard_transpose_radius(rows, columns, max_radius);
+  uint64_t lit_rows[64] = {0};  // The tiles of `fov` in the window, if `skip_lit` is true.
+  uint64_t lit_columns[64] = {0};
+  if (skip_lit) {
+    for (int y = y_first; y <= y_last; ++y) lit_rows[y] = TCODFOV_bitpacked_row_load64(fov, window_x, window_y + y);
+    bitboard_transpose_radius(lit_rows, lit_columns, max_radius);
+  }
+  // Per-depth limits of the radius, the same as in `scan_kind`.
+  const int radius_squared = max_radius * max_radius;
+  uint64_t scan_masks[BITBOARD_MAX_RADIUS];
+  uint64_t visible_masks[BITBOARD_MAX_RADIUS];
+  for (int depth = 1; depth < max_radius; ++depth) {
+    const int visible_limit = max_column_below(radius_squared, depth * depth);
+    const int scan_limit = (max_column_below(4 * radius_squared, 4 * depth * depth) + 1) / 2;
+    scan_masks[depth] = bitboard_columns(-scan_limit, scan_limit);
+    visible_masks[depth] = bitboard_columns(-visible_limit, visible_limit);
+  }
+  const uint64_t inside_x = bitboard_columns(
+      TCODFOV_MAX(-pov_x, -BITBOARD_CENTER), TCODFOV_MIN(fov->width - 1 - pov_x, 63 - BITBOARD_CENTER));
+  const uint64_t inside_y = bitboard_columns(
+      TCODFOV_MAX(-pov_y, -BITBOARD_CENTER), TCODFOV_MIN(fov->height - 1 - pov_y, 63 - BITBOARD_CENTER));
+  uint64_t columns_out[64] = {0};  // Visible tiles of the quadrants scanning `columns`.
+  for (int quadrant = 0; quadrant < 4; ++quadrant) {
+    // The quadrants along the y-axis scan `columns`, the others scan `rows`.  Negative quadrants are mirrored.
+    const bool along_x = quadrant_table[quadrant][1] != 0;
+    const int direction = quadrant_table[quadrant][0] + quadrant_table[quadrant][2];
+    const uint64_t* board = along_x ? rows : columns;
+    const uint64_t* lit_board = along_x ? lit_rows : lit_columns;
+    const int pov_depth = along_x ? pov_y : pov_x;
+    const int last_depth = TCODFOV_MIN(
+        max_radius - 1, direction > 0 ? (along_x ? fov->height : fov->width) - 1 - pov_depth : pov_depth);
+    const uint64_t inside_columns = along_x ? inside_x : inside_y;
+    const uint64_t inside = direction > 0 ? inside_columns : bitboard_mirror(inside_columns);
+    uint64_t tiles[BITBOARD_MAX_RADIUS];
+    uint64_t quadrant_scan_masks[BITBOARD_MAX_RADIUS];
+    uint64_t unlit[BITBOARD_MAX_RADIUS];  // Tiles which could be marked and are not lit yet, if `skip_lit` is true.
+    uint64_t unlit_any = 0;
+    uint64_t out[BITBOARD_MAX_RADIUS];
+    for (int depth = 1; depth <= last_depth; ++depth) {
+      const uint64_t board_row = board[BITBOARD_CENTER + depth * direction];
+      const uint64_t lit_row = lit_board[BITBOARD_CENTER + depth * direction];
+      tiles[depth] = direction > 0 ? board_row : bitboard_mirror(board_row);
+      quadrant_scan_masks[depth] = scan_masks[depth] & inside;
+      unlit[depth] = quadrant_scan_masks[depth] & visible_masks[depth] & (light_walls ? ~(uint64_t)0 : tiles[depth]) &
+                     ~(direction > 0 ? lit_row : bitboard_mirror(lit_row));
+      unlit_any |= unlit[depth];
+      out[depth] = 0;
+    }
+    if (skip_lit && !unlit_any) {  // Every tile of this quadrant is already lit.
+      *skipped_rows += last_depth;
+      continue;
+    }
+    const TCODFOV_Error err = bitboard_scan_quadrant(
+        tiles,
+        quadrant_scan_masks,
+        visible_masks,
+        skip_lit ? unlit : NULL,
+        out,
+        last_depth,
+        light_walls,
+        skipped_rows);
+    if (err < 0) return err;
+    for (int depth = 1; depth <= last_depth; ++depth) {
+      if (!out[depth]) continue;
+      const uint64_t visible = direction > 0 ? out[depth] : bitboard_mirror(out[depth]);
+      if (along_x) {
+        TCODFOV_bitpacked_row_or64(fov, window_x, pov_y + depth * direction, visible);
+      } else {
+        columns_out[BITBOARD_CENTER + depth * direction] |= visible;
+      }
+    }
+  }
+  uint64_t rows_out[64] = {0};
+  bitboard_transpose_radius(columns_out, rows_out, max_radius);
+  for (int y = y_first; y <= y_last; ++y) {
+    if (rows_out[y]) TCODFOV_bitpacked_row_or64(fov, window_x, window_y + y, rows_out[y]);
+  }
+  return TCODFOV_E_OK;
+}
+/**
+    Return the first depth before `depth_end` where the full view of `row`'s quadrant has a wall, or `depth_end`.
+
+    Rows before that depth are entirely floors, so scanning them never splits or narrows the view.
+    `depth_end` must not be past the edge of the map.
+ */
+static int open_depth_bitpacked(
+    const TCODFOV_MapAccess* __restrict transparent, const Row* __restrict row, int depth_end) {
+  const int* matrix = quadrant_table[row->quadrant];
+  if (matrix[1] != 0) {  // Rows run along the x-axis.
+    for (int depth = 1; depth < depth_end; ++depth) {
+      const int map_y = row->pov_y + depth * matrix[2];
+      const int x_begin = TCODFOV_MAX(row->pov_x - depth, 0);
+      const int x_end = TCODFOV_MIN(row->pov_x + depth + 1, transparent->width);
+      if (TCODFOV_bitpacked_row_find_next(transparent, x_begin, x_end, map_y, true) < x_end) return depth;
+    }
+    return depth_end;
+  }
+  // Rows run along the y-axis, so search along each map row for its nearest wall within the quadrant instead.
+  for (int column = 0; column < depth_end; ++column) {
+    const int depth_first = TCODFOV_MAX(column, 1);
+    for (int side = column ? -1 : 1; side <= 1; side += 2) {
+      const int map_y = row->pov_y + side * column;
+      if (map_y < 0 || map_y >= transparent->height || depth_first >= depth_end) continue;
+      if (matrix[0] > 0) {
+        depth_end = TCODFOV_bitpacked_row_find_next(
+                        transparent, row->pov_x + depth_first, row->pov_x + depth_end, map_y, true) -
+                    row->pov_x;
+      } else {
+        depth_end = row->pov_x - TCODFOV_bitpacked_row_find_prev(
+                                     transparent, row->pov_x - depth_first, row->pov_x - depth_end, map_y, true);
+      }
+    }
+  }
+  return depth_end;
+}
+/**
+    Mark the rows of `row`'s quadrant before `depth_end` as visible, these rows must be entirely floors.
+
+    This has the same effects as scanning those rows, but marks up to 64 tiles at a time in either direction.
+ */
+static void fill_open_rows_bitpacked(TCODFOV_MapAccess* __restrict fov, const Row* __restrict row, int depth_end) {
+  const int* matrix = quadrant_table[row->quadrant];
+  if (matrix[1] != 0) {  // Rows run along the x-axis.
+    for (int depth = 1; depth < depth_end; ++depth) {
+      const int limit = row->radius_squared > 0
+                            ? TCODFOV_MIN(depth, max_column_below(row->radius_squared, depth * depth))
+                            : depth;
+      TCODFOV_bitpacked_row_fill(
+          fov, row->pov_x - limit, row->pov_x + limit + 1, row->pov_y + depth * matrix[2], true);
+    }
+    return;
+  }
+  // Rows run along the y-axis, fill the part of each map row within the open rows and the radius.
+  for (int column = 1 - depth_end; column < depth_end; ++column) {
+    const int map_y = row->pov_y + column;
+    if (map_y < 0 || map_y >= fov->height) continue;
+    const int depth_first = TCODFOV_MAX(TCODFOV_ABS(column), 1);
+    int depth_last = depth_end - 1;
+    if (row->radius_squared > 0) {
+      depth_last = TCODFOV_MIN(depth_last, max_column_below(row->radius_squared, column * column));
+    }
+    if (depth_first > depth_last) continue;
+    if (matrix[0] > 0) {
+      TCODFOV_bitpacked_row_fill(fov, row->pov_x + depth_first, row->pov_x + depth_last + 1, map_y, true);
+    } else {
+      TCODFOV_bitpacked_row_fill(fov, row->pov_x - depth_last, row->pov_x - depth_first + 1, map_y, true);
+    }
+  }
+}
+/**
+    Scan one quadrant for a resolved storage kind.
+ */
+static TCODFOV_Error scan_quadrant(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int quadrant,
+    TCODFOV_MapKind kind) {
+  Row row = {
+      .pov_x = pov_x,
+      .pov_y = pov_y,
+      .quadrant = quadrant,
+      .radius_squared = max_radius > 0 ? max_radius * max_radius : 0,
+      .light_walls = light_walls,
+      .depth = 1,
+      .slope_low = -1.0f,
+      .slope_high = 1.0f,
+  };
+  if (kind == TCODFOV_MAP_KIND_BITPACKED) {
+    // Rows before the first wall keep the full view, fill them directly and start scanning at that wall.
+    const int* matrix = quadrant_table[quadrant];
+    int depth_end = 1 + (matrix[0] > 0   ? transparent->width - 1 - pov_x
+                         : matrix[0] < 0 ? pov_x
+                         : matrix[2] > 0 ? transparent->height - 1 - pov_y
+                                         : pov_y);
+    if (max_radius > 0) depth_end = TCODFOV_MIN(depth_end, max_radius);
+    row.depth = open_depth_bitpacked(transparent, &row, depth_end);
+    fill_open_rows_bitpacked(fov, &row, row.depth);
   }
+  TCODFOV_Error err = TCODFOV_E_OK;
+  TCODFOV_MAP_KIND_SWITCH(kind, K, err = scan_quadrant_kind(transparent, fov, &row, K));
+  return err;
+}
+/**
+    Compute symmetric shadowcasting from one point of view using the fastest path for `kind`.
+
+    The bitboard kernel is used for bitpacked maps with a small radius.  `skipped_rows` is passed to it and is
+    otherwise ignored, since the other paths only set tiles and setting a lit tile has no effect.
+ */
+static TCODFOV_Error compute_symmetric_kind(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    TCODFOV_MapKind kind,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int* __restrict skipped_rows) {
+  if (kind == TCODFOV_MAP_KIND_BITPACKED && max_radius > 0 && max_radius <= BITBOARD_MAX_RADIUS) {
+    return compute_symmetric_bitboard(transparent, fov, pov_x, pov_y, max_radius, light_walls, skipped_rows);
+  }
+  if (light_walls || TCODFOV_access_get(transparent, kind, pov_x, pov_y)) {
+    TCODFOV_access_set(fov, kind, pov_x, pov_y, true);
+  }
+  for (int quadrant = 0; quadrant < 4; ++quadrant) {
+    const TCODFOV_Error err = scan_quadrant(transparent, fov, pov_x, pov_y, max_radius, light_walls, quadrant, kind);
+    if (err < 0) return err;
+  }
+  return TCODFOV_E_OK;
 }
 
 TCODFOV_Error TCODFOV_map_compute_fov_symmetric_shadowcast(
@@ -157,32 +741,312 @@ TCODFOV_Error TCODFOV_map_compute_fov_symmetric_shadowcast(
     TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
     return TCODFOV_E_INVALID_ARGUMENT;
   }
-  TCODFOV_map2d_set_bool(fov, pov_x, pov_y, true);
-  for (int quadrant = 0; quadrant < 4; ++quadrant) {
-    Row row = {
-        .pov_x = pov_x,
-        .pov_y = pov_y,
-        .quadrant = quadrant,
-        .depth = 1,
-        .slope_low = -1.0f,
-        .slope_high = 1.0f,
-    };
-    scan(transparent, fov, &row);
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  return compute_symmetric_kind(&transparent_access, &fov_access, kind, pov_x, pov_y, max_radius, light_walls, NULL);
+}
+
+TCODFOV_Error TCODFOV_map_compute_fov_symmetric_shadowcast_union(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int count,
+    const int* __restrict pov_x,
+    const int* __restrict pov_y,
+    const int* __restrict max_radius,
+    bool light_walls) {
+  if (!transparent) {
+    TCODFOV_set_errorv("Input map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
   }
-  const int radius_squared = max_radius * max_radius;
-  for (int y = 0; y < TCODFOV_map2d_get_height(fov); ++y) {
-    for (int x = 0; x < TCODFOV_map2d_get_width(fov); ++x) {
-      if (!light_walls && !TCODFOV_map2d_get_bool(transparent, x, y)) {
-        TCODFOV_map2d_set_bool(fov, x, y, false);
-      }
-      if (max_radius > 0) {
-        const int dx = x - pov_x;
-        const int dy = y - pov_y;
-        if (dx * dx + dy * dy >= radius_squared) {
-          TCODFOV_map2d_set_bool(fov, x, y, false);
-        }
-      }
+  if (!fov) {
+    TCODFOV_set_errorv("Output map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count < 0) {
+    TCODFOV_set_errorvf("Point of view count must not be negative, got %i.", count);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count > 0 && (!pov_x || !pov_y || !max_radius)) {
+    TCODFOV_set_errorv("Point of view arrays must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (!TCODFOV_map2d_in_bounds(fov, pov_x[i], pov_y[i])) {
+      TCODFOV_set_errorvf("Point of view {%i, %i} at index %i is out of bounds.", pov_x[i], pov_y[i], i);
+      return TCODFOV_E_INVALID_ARGUMENT;
     }
   }
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  int misses = 0;  // Points-of-view in a row which skipped too little to be worth checking.
+  for (int i = 0; i < count; ++i) {
+    // Checking for lit tiles costs more than it saves when views do not overlap.  Views can only overlap much if
+    // this point-of-view is already lit, and after a miss checking is only retried now and then.
+    const bool check_lit = TCODFOV_map2d_get_bool(fov, pov_x[i], pov_y[i]) &&
+                           (misses < UNION_MAX_MISSES || i % UNION_RETRY_INTERVAL == 0);
+    int skipped_rows = 0;
+    const TCODFOV_Error err = compute_symmetric_kind(
+        &transparent_access,
+        &fov_access,
+        kind,
+        pov_x[i],
+        pov_y[i],
+        max_radius[i],
+        light_walls,
+        check_lit ? &skipped_rows : NULL);
+    if (err < 0) return err;
+    if (check_lit) misses = skipped_rows >= max_radius[i] ? 0 : misses + 1;
+  }
   return TCODFOV_E_OK;
 }
+/**
+    A slope on a quadrant in the same form as the edges of a view, `(2 * column - 1) / (2 * depth)`.
+
+    Repairs only scan from slopes of this form, since comparing two of them as floats always agrees with comparing
+    them exactly.
+ */
+typedef struct Edge {
+  int column;
+  int depth;
+} Edge;
+/**
+    Compare the slopes of two edges exactly, returns a negative, zero, or positive number like `strcmp`.
+ */
+static int edge_compare(Edge a, Edge b) {
+  const int64_t left = (2 * (int64_t)a.column - 1) * b.depth;
+  const int64_t right = (2 * (int64_t)b.column - 1) * a.depth;
+  return (left > right) - (left < right);
+}
+/**
+    Divide rounding towards negative infinity.  `denominator` must be positive.
+ */
+static int64_t floor_div(int64_t numerator, int64_t denominator) {
+  return numerator / denominator - (numerator % denominator < 0);
+}
+/**
+    Divide rounding towards infinity.  `denominator` must be positive.
+ */
+static int64_t ceil_div(int64_t numerator, int64_t denominator) { return -floor_div(-numerator, denominator); }
+/**
+    Tiles of a quadrant which can change when the transparency of some of its tiles changes.
+
+    A tile at `depth` and `column` can only narrow or split the views crossing its edges, so the tiles it affects are
+    itself and the tiles past it which overlap the slopes from `low` to `high`.
+ */
+typedef struct RepairWindow {
+  int quadrant;
+  int depth;  // The first depth which can change.
+  Edge low;
+  Edge high;
+} RepairWindow;
+/**
+    Sort windows by quadrant and then by their low slope.
+ */
+static int compare_repair_windows(const void* a_ptr, const void* b_ptr) {
+  const RepairWindow* a = a_ptr;
+  const RepairWindow* b = b_ptr;
+  if (a->quadrant != b->quadrant) return a->quadrant - b->quadrant;
+  return edge_compare(a->low, b->low);
+}
+/**
+    Return the low edge scanned to repair `window`.
+
+    Walls which overlap a window are at most `1 / depth` wide, so the scan is widened by that much on both sides.
+    This is the largest edge on `window->depth` with `edge + 1 / depth <= low`.
+ */
+static Edge repair_scan_low(const RepairWindow* window) {
+  const int64_t depth = window->depth;
+  const int64_t numerator = (2 * (int64_t)window->low.column - 1) * depth - window->low.depth;
+  return (Edge){(int)floor_div(numerator, 2 * (int64_t)window->low.depth), window->depth};
+}
+/**
+    Return the smallest edge on `window->depth` with `edge - 1 / depth >= high`.
+ */
+static Edge repair_scan_high(const RepairWindow* window) {
+  const int64_t depth = window->depth;
+  const int64_t numerator = (2 * (int64_t)window->high.column - 1) * depth + 3 * (int64_t)window->high.depth;
+  return (Edge){(int)ceil_div(numerator, 2 * (int64_t)window->high.depth), window->depth};
+}
+/**
+    Scan a quadrant from the first row, but only within the slopes from `slope_low` to `slope_high`.
+
+    The views of this scan are the views of the full quadrant clipped to these slopes.  Only tiles which the full
+    quadrant also marks are marked, and tiles whose centers or walls are entirely within the slopes are exact.
+ */
+static TCODFOV_Error scan_quadrant_window(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    TCODFOV_MapKind kind,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int quadrant,
+    float slope_low,
+    float slope_high) {
+  const Row row = {
+      .pov_x = pov_x,
+      .pov_y = pov_y,
+      .quadrant = quadrant,
+      .radius_squared = max_radius > 0 ? max_radius * max_radius : 0,
+      .light_walls = light_walls,
+      .depth = 1,
+      .slope_low = TCODFOV_MAX(slope_low, -1.0f),
+      .slope_high = TCODFOV_MIN(slope_high, 1.0f),
+  };
+  TCODFOV_Error err = TCODFOV_E_OK;
+  TCODFOV_MAP_KIND_SWITCH(kind, K, err = scan_quadrant_kind(transparent, fov, &row, K));
+  return err;
+}
+/**
+    Clear the tiles of `window` and compute them again.
+
+    Tiles on the diagonals are shared with the next quadrant, but both quadrants always agree on them.  Only the
+    diagonal tiles before them can block the view along a diagonal.
+ */
+static TCODFOV_Error repair_window(
+    const TCODFOV_MapAccess* __restrict transparent,
+    TCODFOV_MapAccess* __restrict fov,
+    TCODFOV_MapKind kind,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    const RepairWindow* __restrict window) {
+  const int* matrix = quadrant_table[window->quadrant];
+  const int radius_squared = max_radius > 0 ? max_radius * max_radius : 0;
+  for (int depth = window->depth;; ++depth) {
+    if (!TCODFOV_access_in_bounds(fov, pov_x + depth * matrix[0], pov_y + depth * matrix[2])) break;
+    if (radius_squared > 0 && depth * depth >= radius_squared) break;
+    // Tiles overlap the window when `(2 * column + 1) / (2 * depth) >= low` and `(2 * column - 1) / (2 * depth) <=
+    // high`, and they are never past the diagonals of the quadrant.
+    const int64_t low_numerator = (2 * (int64_t)window->low.column - 1) * depth - window->low.depth;
+    const int64_t high_numerator = (2 * (int64_t)window->high.column - 1) * depth + window->high.depth;
+    const int column_first = (int)TCODFOV_MAX(ceil_div(low_numerator, 2 * (int64_t)window->low.depth), -depth);
+    const int column_last = (int)TCODFOV_MIN(floor_div(high_numerator, 2 * (int64_t)window->high.depth), depth);
+    if (column_first > column_last) continue;
+    const int map_x = pov_x + depth * matrix[0];
+    const int map_y = pov_y + depth * matrix[2];
+    if (kind == TCODFOV_MAP_KIND_BITPACKED && matrix[1] != 0) {
+      const int x_first = map_x + (matrix[1] > 0 ? column_first : -column_last);
+      TCODFOV_bitpacked_row_fill(fov, x_first, x_first + column_last - column_first + 1, map_y, false);
+      continue;
+    }
+    for (int column = column_first; column <= column_last; ++column) {
+      TCODFOV_access_set(fov, kind, map_x + column * matrix[1], map_y + column * matrix[3], false);
+    }
+  }
+  const float slope_low = slope(window->depth, repair_scan_low(window).column);
+  const float slope_high = slope(window->depth, repair_scan_high(window).column);
+  return scan_quadrant_window(
+      transparent, fov, kind, pov_x, pov_y, max_radius, light_walls, window->quadrant, slope_low, slope_high);
+}
+TCODFOV_Error TCODFOV_map_repair_fov_symmetric_shadowcast(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int count,
+    const TCODFOV_Point* __restrict changed) {
+  if (!transparent) {
+    TCODFOV_set_errorv("Input map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!fov) {
+    TCODFOV_set_errorv("Output map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!TCODFOV_map2d_in_bounds(fov, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count < 0) {
+    TCODFOV_set_errorvf("Changed tile count must not be negative, got %i.", count);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count > 0 && !changed) {
+    TCODFOV_set_errorv("Changed tiles must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (!TCODFOV_map2d_in_bounds(fov, changed[i].x, changed[i].y)) {
+      TCODFOV_set_errorvf("Changed tile {%i, %i} at index %i is out of bounds.", changed[i].x, changed[i].y, i);
+      return TCODFOV_E_INVALID_ARGUMENT;
+    }
+  }
+  if (count == 0) return TCODFOV_E_OK;
+  RepairWindow* windows = malloc(sizeof(*windows) * 2 * (size_t)count);  // Diagonal tiles are in two quadrants.
+  if (!windows) {
+    TCODFOV_set_errorv("Out of memory.");
+    return TCODFOV_E_OUT_OF_MEMORY;
+  }
+  int window_count = 0;
+  bool pov_changed = false;
+  for (int i = 0; i < count; ++i) {
+    const int dx = changed[i].x - pov_x;
+    const int dy = changed[i].y - pov_y;
+    if (dx == 0 && dy == 0) {
+      pov_changed = true;
+      continue;
+    }
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+      const int* matrix = quadrant_table[quadrant];
+      const int depth = dx * matrix[0] + dy * matrix[2];
+      const int column = dx * matrix[1] + dy * matrix[3];
+      if (depth <= 0 || TCODFOV_ABS(column) > depth) continue;  // Not in this quadrant.
+      if (max_radius > 0 && depth >= max_radius) continue;  // Rows this deep are never scanned.
+      windows[window_count++] = (RepairWindow){quadrant, depth, {column, depth}, {column + 1, depth}};
+    }
+  }
+  qsort(windows, (size_t)window_count, sizeof(*windows), compare_repair_windows);
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  TCODFOV_Error err = TCODFOV_E_OK;
+  for (int i = 0; i < window_count && err >= 0;) {
+    RepairWindow window = windows[i++];
+    // Nearby tiles are repaired together when this window would scan over them anyway.
+    while (i < window_count && windows[i].quadrant == window.quadrant &&
+           edge_compare(windows[i].low, repair_scan_high(&window)) <= 0) {
+      if (edge_compare(windows[i].high, window.high) > 0) window.high = windows[i].high;
+      window.depth = TCODFOV_MIN(window.depth, windows[i].depth);
+      ++i;
+    }
+    err = repair_window(
+        &transparent_access, &fov_access, kind, pov_x, pov_y, max_radius, light_walls, &window);
+  }
+  if (err >= 0 && pov_changed) {
+    const bool pov_visible = light_walls || TCODFOV_access_get(&transparent_access, kind, pov_x, pov_y);
+    TCODFOV_access_set(&fov_access, kind, pov_x, pov_y, pov_visible);
+  }
+  free(windows);
+  return err;
+}
+TCODFOV_Error TCODFOV_symmetric_shadowcast_quadrant_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int quadrant) {
+  TCODFOV_MapAccess transparent_access;
+  TCODFOV_MapAccess fov_access;
+  const TCODFOV_MapKind kind = TCODFOV_map_access_init_pair(&transparent_access, &fov_access, transparent, fov);
+  return scan_quadrant(&transparent_access, &fov_access, pov_x, pov_y, max_radius, light_walls, quadrant, kind);
+}
+TCODFOV_Rect TCODFOV_symmetric_shadowcast_quadrant_bounds_(int quadrant, int pov_x, int pov_y, int extent) {
+  // Quadrants cover the tiles `pov + depth * (xx, yx) + column * (xy, yy)` for `|column| <= depth <= extent`.
+  const int* matrix = quadrant_table[quadrant];
+  const int far_x = pov_x + extent * matrix[0];
+  const int far_y = pov_y + extent * matrix[2];
+  const int x_min = TCODFOV_MIN(pov_x, far_x - extent * TCODFOV_ABS(matrix[1]));
+  const int x_max = TCODFOV_MAX(pov_x, far_x + extent * TCODFOV_ABS(matrix[1]));
+  const int y_min = TCODFOV_MIN(pov_y, far_y - extent * TCODFOV_ABS(matrix[3]));
+  const int y_max = TCODFOV_MAX(pov_y, far_y + extent * TCODFOV_ABS(matrix[3]));
+  return (TCODFOV_Rect){x_min, y_min, x_max - x_min + 1, y_max - y_min + 1};
+}
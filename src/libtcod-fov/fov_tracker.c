@@ -0,0 +1,213 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/** \file
+    Field-of-view of a moving point-of-view, tracking the tiles which enter and leave it.
+ */
+#include "fov_tracker.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "libtcod_int.h"
+#include "map_access.h"
+#include "map_inline.h"
+#include "map_types.h"
+#include "scratch.h"
+#include "utility.h"
+/**
+    A growable array of points.
+ */
+typedef struct PointList {
+  TCODFOV_Point* points;
+  int count;
+  int capacity;
+} PointList;
+struct TCODFOV_FovTracker {
+  int width;
+  int height;
+  int max_radius;
+  bool light_walls;
+  TCODFOV_fov_algorithm_t algo;
+  int current;  // Index of the current result in `fov`, the other one holds the result before it.
+  TCODFOV_Map2D fov[2];  // Bitpacked results, sharing one allocation.
+  TCODFOV_Rect dirty[2];  // The area each result of `fov` could have set.
+  PointList entered;
+  PointList left;
+  TCODFOV_Workspace workspace;
+};
+/**
+    Append the tiles of the set bits of `tiles` to `list`.  Bit 0 is at `x`, `y`.
+ */
+static TCODFOV_Error push_tiles(PointList* __restrict list, uint64_t tiles, int x, int y) {
+  const int needed = list->count + TCODFOV_popcount64(tiles);
+  if (needed > list->capacity) {
+    const int new_capacity = TCODFOV_MAX(needed, list->capacity * 2);
+    TCODFOV_Point* new_points = realloc(list->points, sizeof(*new_points) * (size_t)new_capacity);
+    if (!new_points) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+    list->points = new_points;
+    list->capacity = new_capacity;
+  }
+  for (; tiles; tiles &= tiles - 1) list->points[list->count++] = (TCODFOV_Point){x + TCODFOV_ctz64(tiles), y};
+  return TCODFOV_E_OK;
+}
+/**
+    Return the smallest rectangle containing both `a` and `b`.  Empty rectangles are ignored.
+ */
+static TCODFOV_Rect rect_union(TCODFOV_Rect a, TCODFOV_Rect b) {
+  if (a.width <= 0 || a.height <= 0) return b;
+  if (b.width <= 0 || b.height <= 0) return a;
+  const int x_min = TCODFOV_MIN(a.x, b.x);
+  const int y_min = TCODFOV_MIN(a.y, b.y);
+  const int x_max = TCODFOV_MAX(a.x + a.width, b.x + b.width);
+  const int y_max = TCODFOV_MAX(a.y + a.height, b.y + b.height);
+  return (TCODFOV_Rect){x_min, y_min, x_max - x_min, y_max - y_min};
+}
+TCODFOV_FovTracker* TCODFOV_fov_tracker_new(
+    int width, int height, int max_radius, bool light_walls, TCODFOV_fov_algorithm_t algo) {
+  if (width <= 0 || height <= 0) {
+    TCODFOV_set_errorvf("Map size must be positive, got {%i, %i}.", width, height);
+    return NULL;
+  }
+  if ((int)algo < 0 || algo >= NB_FOV_ALGORITHMS) {
+    TCODFOV_set_errorvf("Invalid field-of-view algorithm %i.", (int)algo);
+    return NULL;
+  }
+  const ptrdiff_t y_stride = (width + 7) / 8;
+  TCODFOV_FovTracker* tracker = calloc(1, sizeof(*tracker));
+  uint8_t* data = calloc((size_t)y_stride * (size_t)height, 2);
+  if (!tracker || !data) {
+    free(tracker);
+    free(data);
+    TCODFOV_set_errorv("Out of memory.");
+    return NULL;
+  }
+  tracker->width = width;
+  tracker->height = height;
+  tracker->max_radius = max_radius;
+  tracker->light_walls = light_walls;
+  tracker->algo = algo;
+  for (int i = 0; i < 2; ++i) {
+    tracker->fov[i] = (TCODFOV_Map2D){
+        .bitpacked = {
+            .type = TCODFOV_MAP2D_BITPACKED,
+            .shape = {height, width},
+            .data = data + y_stride * height * i,
+            .y_stride = y_stride,
+        }};
+  }
+  return tracker;
+}
+void TCODFOV_fov_tracker_delete(TCODFOV_FovTracker* tracker) {
+  if (!tracker) return;
+  free(tracker->fov[0].bitpacked.data);
+  free(tracker->entered.points);
+  free(tracker->left.points);
+  TCODFOV_workspace_release_(&tracker->workspace);
+  free(tracker);
+}
+TCODFOV_Error TCODFOV_fov_tracker_update(
+    TCODFOV_FovTracker* __restrict tracker, const TCODFOV_Map2D* __restrict transparent, int pov_x, int pov_y) {
+  if (!tracker || !transparent) {
+    TCODFOV_set_errorv("Tracker and input map must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (TCODFOV_map2d_get_width(transparent) != tracker->width ||
+      TCODFOV_map2d_get_height(transparent) != tracker->height) {
+    TCODFOV_set_errorvf(
+        "Input map must be the same size as the tracker {%i, %i}, got {%i, %i}.",
+        tracker->width,
+        tracker->height,
+        TCODFOV_map2d_get_width(transparent),
+        TCODFOV_map2d_get_height(transparent));
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!TCODFOV_map2d_in_bounds(transparent, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  const int previous = tracker->current;
+  const int next = 1 - previous;
+  tracker->entered.count = tracker->left.count = 0;
+  // The other map still holds the result before the previous one, only its dirty area needs to be cleared.
+  TCODFOV_Map2D* next_fov = &tracker->fov[next];
+  TCODFOV_map2d_clear_rect(next_fov, tracker->dirty[next]);
+  TCODFOV_Error err = TCODFOV_map_compute_fov_2d(
+      transparent,
+      next_fov,
+      pov_x,
+      pov_y,
+      tracker->max_radius,
+      tracker->light_walls,
+      tracker->algo,
+      &tracker->workspace,
+      &tracker->dirty[next]);
+  if (err < 0) {
+    TCODFOV_map2d_clear_rect(next_fov, (TCODFOV_Rect){0, 0, tracker->width, tracker->height});
+    TCODFOV_map2d_clear_rect(&tracker->fov[previous], tracker->dirty[previous]);
+    tracker->dirty[0] = tracker->dirty[1] = (TCODFOV_Rect){0, 0, 0, 0};
+    return err;
+  }
+  tracker->current = next;
+  // Tiles outside of both dirty areas are false in both results.
+  const TCODFOV_Rect changed = rect_union(tracker->dirty[previous], tracker->dirty[next]);
+  TCODFOV_MapAccess previous_access;
+  TCODFOV_MapAccess next_access;
+  TCODFOV_map_access_init(&previous_access, &tracker->fov[previous]);
+  TCODFOV_map_access_init(&next_access, next_fov);
+  for (int y = changed.y; y < changed.y + changed.height; ++y) {
+    for (int x = changed.x; x < changed.x + changed.width; x += 64) {
+      const uint64_t before = TCODFOV_bitpacked_row_load64(&previous_access, x, y);
+      const uint64_t after = TCODFOV_bitpacked_row_load64(&next_access, x, y);
+      if (before == after) continue;
+      if ((err = push_tiles(&tracker->entered, after & ~before, x, y)) < 0) return err;
+      if ((err = push_tiles(&tracker->left, before & ~after, x, y)) < 0) return err;
+    }
+  }
+  return TCODFOV_E_OK;
+}
+const TCODFOV_Map2D* TCODFOV_fov_tracker_get_fov(const TCODFOV_FovTracker* tracker) {
+  return tracker ? &tracker->fov[tracker->current] : NULL;
+}
+int TCODFOV_fov_tracker_get_entered(
+    const TCODFOV_FovTracker* __restrict tracker, const TCODFOV_Point** __restrict points) {
+  if (points) *points = tracker ? tracker->entered.points : NULL;
+  return tracker ? tracker->entered.count : 0;
+}
+int TCODFOV_fov_tracker_get_left(
+    const TCODFOV_FovTracker* __restrict tracker, const TCODFOV_Point** __restrict points) {
+  if (points) *points = tracker ? tracker->left.points : NULL;
+  return tracker ? tracker->left.count : 0;
+}
@@ -5,6 +5,7 @@
 #include <string.h>
 
 #include "map_inline.h"
+#include "scratch.h"
 
 /// @brief Compute the reachability of tiles on this side of the row.
 static void triage_scan_line(
@@ -47,35 +48,37 @@ static void triage_scan_line(
   }
 }
 
-/// @brief Compute the next row of visiblity, continue until out-of-bounds
-static void triage_scan_next_row(
+/// @brief Compute each row of triage data in the `scan_dir` direction until out-of-bounds
+static void triage_scan_rows(
     const TCODFOV_Map2D* __restrict transparent,  // Input transparency
     TCODFOV_Map2D* __restrict out,  // Triage output
     int pov_x,  // X position
-    int scan_y,  // Y position
+    int scan_y,  // Y position of the first row
     int_fast8_t scan_dir,  // Y step direction, -1 or 1
-    int iteration,  // Distance from pov_y, always `abs(scan_y - pov_y)`
     int8_t* __restrict prev_row,  // Previous row buffer
     int8_t* __restrict next_row  // Active row buffer
 ) {
-  if (scan_y < 0 || scan_y >= TCODFOV_map2d_get_height(out)) return;  // Finished, out-of-bounds
+  // `iteration` is the distance from pov_y, always `abs(scan_y - pov_y)`
+  for (int iteration = 1; 0 <= scan_y && scan_y < TCODFOV_map2d_get_height(out); scan_y += scan_dir, ++iteration) {
+    // Compute tile at pov_x, scan_y
+    next_row[pov_x] = prev_row[pov_x] & 0b100 ? prev_row[pov_x] : 0;
+    if (next_row[pov_x] && TCODFOV_map2d_get_bool(transparent, pov_x, scan_y)) next_row[pov_x] &= 0b11;
 
-  // Compute tile at pov_x, scan_y
-  next_row[pov_x] = prev_row[pov_x] & 0b100 ? prev_row[pov_x] : 0;
-  if (next_row[pov_x] && TCODFOV_map2d_get_bool(transparent, pov_x, scan_y)) next_row[pov_x] &= 0b11;
+    // Compute tiles on sides of active row
+    triage_scan_line(transparent, pov_x, scan_y, iteration, prev_row, next_row, pov_x - 1, -1, -1);
+    triage_scan_line(
+        transparent, pov_x, scan_y, iteration, prev_row, next_row, pov_x + 1, TCODFOV_map2d_get_width(out), 1);
 
-  // Compute tiles on sides of active row
-  triage_scan_line(transparent, pov_x, scan_y, iteration, prev_row, next_row, pov_x - 1, -1, -1);
-  triage_scan_line(
-      transparent, pov_x, scan_y, iteration, prev_row, next_row, pov_x + 1, TCODFOV_map2d_get_width(out), 1);
+    // Output triage data
+    for (int x = 0; x < TCODFOV_map2d_get_width(out); ++x) {
+      TCODFOV_map2d_set_u8(out, x, scan_y, next_row[x] & 0b11);
+    }
 
-  // Output triage data
-  for (int x = 0; x < TCODFOV_map2d_get_width(out); ++x) {
-    TCODFOV_map2d_set_u8(out, x, scan_y, next_row[x] & 0b11);
+    // Swap next_row and prev_row and continue
+    int8_t* const swap = prev_row;
+    prev_row = next_row;
+    next_row = swap;
   }
-
-  // Swap next_row and prev_row and continue
-  triage_scan_next_row(transparent, out, pov_x, scan_y + scan_dir, scan_dir, iteration + 1, next_row, prev_row);
 }
 
 /// @brief Compute initial triage data for the middle row.
@@ -99,25 +102,37 @@ static void triage_scan_init(
   }
 }
 
-TCODFOV_Error TCODFOV_triage_2d(
-    const TCODFOV_Map2D* __restrict transparent, TCODFOV_Map2D* __restrict out, int pov_x, int pov_y) {
+TCODFOV_Error TCODFOV_triage_2d_ex(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict out,
+    int pov_x,
+    int pov_y,
+    TCODFOV_Workspace* __restrict workspace) {
+  if (!workspace) {
+    TCODFOV_Workspace temp_workspace = {0};
+    const TCODFOV_Error err = TCODFOV_triage_2d_ex(transparent, out, pov_x, pov_y, &temp_workspace);
+    TCODFOV_workspace_release_(&temp_workspace);
+    return err;
+  }
   // Triage data on row format: 0bXYZ
   // X = transparent: caches input transparency if applicable
   // Y = always visible: all tiles to this tile are always visible
   // Z = maybe visible: at least one tile to this tile is maybe visible
-  int8_t* __restrict row = malloc(TCODFOV_map2d_get_width(out) * 3 * sizeof(*row));
-  if (!row) {
-    TCODFOV_set_errorv("Out of memory.");
-    return TCODFOV_E_OUT_OF_MEMORY;
-  }
+  int8_t* __restrict row = TCODFOV_workspace_reserve_(
+      workspace, TCODFOV_SCRATCH_ROWS, (size_t)TCODFOV_map2d_get_width(out) * 3 * sizeof(*row));
+  if (!row) return TCODFOV_E_OUT_OF_MEMORY;
   int8_t* __restrict row2 = row + TCODFOV_map2d_get_width(out);
   int8_t* __restrict row3 = row + TCODFOV_map2d_get_width(out) * 2;
 
   triage_scan_init(transparent, out, pov_x, pov_y, row);
 
   memcpy(row2, row, TCODFOV_map2d_get_width(out) * sizeof(*row));
-  triage_scan_next_row(transparent, out, pov_x, pov_y - 1, -1, 1, row2, row3);
+  triage_scan_rows(transparent, out, pov_x, pov_y - 1, -1, row2, row3);
   memcpy(row2, row, TCODFOV_map2d_get_width(out) * sizeof(*row));
-  triage_scan_next_row(transparent, out, pov_x, pov_y + 1, 1, 1, row2, row3);
+  triage_scan_rows(transparent, out, pov_x, pov_y + 1, 1, row2, row3);
   return TCODFOV_E_OK;
 }
+TCODFOV_Error TCODFOV_triage_2d(
+    const TCODFOV_Map2D* __restrict transparent, TCODFOV_Map2D* __restrict out, int pov_x, int pov_y) {
+  return TCODFOV_triage_2d_ex(transparent, out, pov_x, pov_y, NULL);
+}
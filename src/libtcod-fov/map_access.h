@@ -0,0 +1,402 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/** \file
+    Private map accessors specialized per storage kind.
+
+    FOV kernels resolve their maps into a `TCODFOV_MapAccess` once at the public entry point, then pass the resolved
+    `TCODFOV_MapKind` down as a compile-time constant using `TCODFOV_MAP_KIND_SWITCH`.  Kernels marked with
+    `TCODFOV_FORCE_INLINE` are then instantiated once per storage kind with the type switches optimized away.
+
+    Bitpacked maps also have row-span primitives which read, search, and fill up to 64 tiles of a row at once.
+ */
+#pragma once
+#ifndef TCODFOV_MAP_ACCESS_H_
+#define TCODFOV_MAP_ACCESS_H_
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fov_types.h"
+#include "map_inline.h"
+#include "map_types.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define TCODFOV_FORCE_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define TCODFOV_FORCE_INLINE static __forceinline
+#else
+#define TCODFOV_FORCE_INLINE static inline
+#endif
+
+/// @brief Storage kinds which FOV kernels are specialized for.
+typedef enum TCODFOV_MapKind {
+  TCODFOV_MAP_KIND_GENERIC = 0,  // Any map, uses the public accessors.
+  TCODFOV_MAP_KIND_BITPACKED,  // Both maps are `TCODFOV_MAP2D_BITPACKED` or `TCODFOV_MAP2D_DEPRECATED`.
+  TCODFOV_MAP_KIND_BOOL,  // Both maps are `TCODFOV_MAP2D_CONTIGIOUS` of `TCODFOV_DATATYPE_BOOL`.
+  TCODFOV_MAP_KIND_UINT8,  // Both maps are `TCODFOV_MAP2D_CONTIGIOUS` of `TCODFOV_DATATYPE_UINT8`.
+  TCODFOV_MAP_KIND_CALLBACK,  // Both maps are `TCODFOV_MAP2D_CALLBACK`.
+  TCODFOV_MAP_KIND_EPOCH,  // The input map is bitpacked and the output map is `TCODFOV_MAP2D_EPOCH`.
+} TCODFOV_MapKind;
+
+/// @brief A map with its shape and storage resolved ahead of time.
+typedef struct TCODFOV_MapAccess {
+  TCODFOV_Map2D* map;  // The original map, used by the generic and callback kinds.
+  uint8_t* data;  // First item of the array, or the selected plane for deprecated maps.
+  ptrdiff_t y_stride;  // Array stride along the y-axis in items, or in bytes for bitpacked maps.
+  uint32_t epoch;  // Current epoch of epoch-stamped maps, zero for all other maps.
+  int width;
+  int height;
+} TCODFOV_MapAccess;
+
+/// @brief Return the kind a single map can be specialized as.
+static inline TCODFOV_MapKind TCODFOV_map_kind_of_(const TCODFOV_Map2D* __restrict map) {
+  switch (map->type) {
+    case TCODFOV_MAP2D_BITPACKED:
+    case TCODFOV_MAP2D_DEPRECATED:  // Deprecated maps are views of bitpacked planes.
+      return TCODFOV_MAP_KIND_BITPACKED;
+    case TCODFOV_MAP2D_CONTIGIOUS:
+      switch (map->contigious.item_type) {
+        case TCODFOV_DATATYPE_BOOL:
+          return TCODFOV_MAP_KIND_BOOL;
+        case TCODFOV_DATATYPE_UINT8:
+          return TCODFOV_MAP_KIND_UINT8;
+        default:
+          return TCODFOV_MAP_KIND_GENERIC;
+      }
+    case TCODFOV_MAP2D_CALLBACK:
+      return TCODFOV_MAP_KIND_CALLBACK;
+    default:
+      return TCODFOV_MAP_KIND_GENERIC;
+  }
+}
+
+/// @brief Resolve the storage of `map` into `access`.
+/// @param access Output access struct.
+/// @param map Map to resolve.  Const maps may be passed here as long as the access is only read from.
+static inline void TCODFOV_map_access_init(TCODFOV_MapAccess* __restrict access, const TCODFOV_Map2D* __restrict map) {
+  *access = (TCODFOV_MapAccess){
+      .map = (TCODFOV_Map2D*)map,
+      .width = TCODFOV_map2d_get_width(map),
+      .height = TCODFOV_map2d_get_height(map),
+  };
+  switch (map->type) {
+    case TCODFOV_MAP2D_BITPACKED:
+      access->data = map->bitpacked.data;
+      access->y_stride = map->bitpacked.y_stride;
+      break;
+    case TCODFOV_MAP2D_DEPRECATED:
+      access->data = TCODFOV_map2d_deprecated_plane_(&map->deprecated_map);
+      access->y_stride = map->deprecated_map.map.y_stride;
+      break;
+    case TCODFOV_MAP2D_CONTIGIOUS:
+      access->data = map->contigious.data;
+      access->y_stride = access->width;
+      break;
+    case TCODFOV_MAP2D_EPOCH:
+      access->data = (uint8_t*)map->epoch.data;
+      access->y_stride = access->width;
+      access->epoch = map->epoch.epoch;
+      break;
+    default:
+      break;
+  }
+}
+
+/// @brief Resolve a pair of input/output maps and return the kind they can share.
+/// @return The specialized kind if both maps share a storage kind, otherwise `TCODFOV_MAP_KIND_GENERIC`.
+static inline TCODFOV_MapKind TCODFOV_map_access_init_pair(
+    TCODFOV_MapAccess* __restrict transparent_access,
+    TCODFOV_MapAccess* __restrict fov_access,
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov) {
+  TCODFOV_map_access_init(transparent_access, transparent);
+  TCODFOV_map_access_init(fov_access, fov);
+  const TCODFOV_MapKind kind = TCODFOV_map_kind_of_(transparent);
+  if (kind == TCODFOV_MAP_KIND_BITPACKED && fov->type == TCODFOV_MAP2D_EPOCH) return TCODFOV_MAP_KIND_EPOCH;
+  return kind == TCODFOV_map_kind_of_(fov) ? kind : TCODFOV_MAP_KIND_GENERIC;
+}
+
+/// @brief Return true if `x`, `y` is within the bounds of `access`.
+TCODFOV_FORCE_INLINE bool TCODFOV_access_in_bounds(const TCODFOV_MapAccess* __restrict access, int x, int y) {
+  return (unsigned)x < (unsigned)access->width && (unsigned)y < (unsigned)access->height;
+}
+
+/// @brief Return the boolean at `x`, `y`, or false if out-of-bounds.
+/// @param kind Storage kind of `access`, should be a compile-time constant.
+TCODFOV_FORCE_INLINE bool TCODFOV_access_get(
+    const TCODFOV_MapAccess* __restrict access, const TCODFOV_MapKind kind, int x, int y) {
+  if (kind == TCODFOV_MAP_KIND_GENERIC) return TCODFOV_map2d_get_bool(access->map, x, y);
+  if (!TCODFOV_access_in_bounds(access, x, y)) return false;
+  switch (kind) {
+    case TCODFOV_MAP_KIND_EPOCH:
+      if (access->epoch) return ((const uint32_t*)access->data)[access->y_stride * y + x] == access->epoch;
+      // Otherwise this is the bitpacked input map.
+      /* fall through */
+    case TCODFOV_MAP_KIND_BITPACKED:
+      return (access->data[access->y_stride * y + (x >> 3)] >> (x & 7)) & 1;
+    case TCODFOV_MAP_KIND_BOOL:
+      return ((const bool*)access->data)[access->y_stride * y + x];
+    case TCODFOV_MAP_KIND_UINT8:
+      return access->data[access->y_stride * y + x] != 0;
+    case TCODFOV_MAP_KIND_CALLBACK:
+      if (!access->map->bool_callback.get) return false;
+      return access->map->bool_callback.get(access->map->bool_callback.userdata, x, y);
+    default:
+      return TCODFOV_map2d_get_bool(access->map, x, y);
+  }
+}
+
+/// @brief Assign `value` to `x`, `y`.  Out-of-bounds writes are ignored.
+/// @param kind Storage kind of `access`, should be a compile-time constant.
+TCODFOV_FORCE_INLINE void TCODFOV_access_set(
+    TCODFOV_MapAccess* __restrict access, const TCODFOV_MapKind kind, int x, int y, bool value) {
+  if (kind == TCODFOV_MAP_KIND_GENERIC) {
+    TCODFOV_map2d_set_bool(access->map, x, y, value);
+    return;
+  }
+  if (!TCODFOV_access_in_bounds(access, x, y)) return;
+  switch (kind) {
+    case TCODFOV_MAP_KIND_EPOCH:
+      if (access->epoch) {
+        ((uint32_t*)access->data)[access->y_stride * y + x] = value ? access->epoch : 0;
+        return;
+      }
+      // Otherwise this is the bitpacked input map.
+      /* fall through */
+    case TCODFOV_MAP_KIND_BITPACKED: {
+      uint8_t* byte = &access->data[access->y_stride * y + (x >> 3)];
+      const uint8_t active_bit = (uint8_t)(1 << (x & 7));
+      *byte = (uint8_t)((*byte & ~active_bit) | (value ? active_bit : 0));
+      return;
+    }
+    case TCODFOV_MAP_KIND_BOOL:
+      ((bool*)access->data)[access->y_stride * y + x] = value;
+      return;
+    case TCODFOV_MAP_KIND_UINT8:
+      access->data[access->y_stride * y + x] = value;
+      return;
+    case TCODFOV_MAP_KIND_CALLBACK:
+      if (!access->map->bool_callback.set) return;
+      access->map->bool_callback.set(access->map->bool_callback.userdata, x, y, value);
+      return;
+    default:
+      TCODFOV_map2d_set_bool(access->map, x, y, value);
+      return;
+  }
+}
+
+/// @brief Return the index of the lowest set bit of `word`, which must not be zero.
+TCODFOV_FORCE_INLINE int TCODFOV_ctz64(uint64_t word) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return (int)index;
+#else
+  int index = 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+/// @brief Return the number of leading zero bits of `word`, which must not be zero.
+TCODFOV_FORCE_INLINE int TCODFOV_clz64(uint64_t word) {
+#if defined(__GNUC__)
+  return __builtin_clzll(word);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long index;
+  _BitScanReverse64(&index, word);
+  return 63 - (int)index;
+#else
+  int count = 0;
+  while (!(word & ((uint64_t)1 << 63))) {
+    word <<= 1;
+    ++count;
+  }
+  return count;
+#endif
+}
+/// @brief Return the number of set bits of `word`.
+TCODFOV_FORCE_INLINE int TCODFOV_popcount64(uint64_t word) {
+#if defined(__GNUC__)
+  return __builtin_popcountll(word);
+#else
+  word -= (word >> 1) & 0x5555555555555555u;
+  word = (word & 0x3333333333333333u) + ((word >> 2) & 0x3333333333333333u);
+  word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Fu;
+  return (int)((word * 0x0101010101010101u) >> 56);
+#endif
+}
+/**
+    Return 64 tiles of row `y` of a bitpacked map, starting at `x`.
+
+    Bit 0 of the result is tile `x`.  Tiles outside of the map, including negative `x` values, are returned as zero.
+    `y` must be in bounds.
+ */
+TCODFOV_FORCE_INLINE uint64_t TCODFOV_bitpacked_row_load64(const TCODFOV_MapAccess* __restrict access, int x, int y) {
+  if (x <= -64 || x >= access->width) return 0;
+  const int shift_up = x < 0 ? -x : 0;  // Leading out-of-bounds tiles.
+  x += shift_up;
+  const uint8_t* __restrict row = access->data + access->y_stride * y;
+  const int byte_index = x >> 3;
+  const int bytes_left = ((access->width + 7) >> 3) - byte_index;
+  uint64_t word = 0;
+  if (bytes_left >= 8) {
+    word = (uint64_t)row[byte_index] | (uint64_t)row[byte_index + 1] << 8 | (uint64_t)row[byte_index + 2] << 16 |
+           (uint64_t)row[byte_index + 3] << 24 | (uint64_t)row[byte_index + 4] << 32 |
+           (uint64_t)row[byte_index + 5] << 40 | (uint64_t)row[byte_index + 6] << 48 |
+           (uint64_t)row[byte_index + 7] << 56;
+  } else {
+    for (int i = 0; i < bytes_left; ++i) word |= (uint64_t)row[byte_index + i] << (i * 8);
+  }
+  word >>= x & 7;
+  if ((x & 7) && bytes_left > 8) word |= (uint64_t)row[byte_index + 8] << (64 - (x & 7));
+  const int tiles_left = access->width - x;
+  if (tiles_left < 64) word &= ((uint64_t)1 << tiles_left) - 1;
+  return word << shift_up;
+}
+/**
+    Return the first tile in `[x, x_end)` of row `y` whose value is not `value`, or `x_end` if there is none.
+
+    Skips over runs of `value` up to 64 tiles at a time.  `x_end` must not be past the width of the map.
+ */
+TCODFOV_FORCE_INLINE int TCODFOV_bitpacked_row_find_next(
+    const TCODFOV_MapAccess* __restrict access, int x, int x_end, int y, bool value) {
+  const uint64_t invert = value ? ~(uint64_t)0 : 0;
+  for (; x < x_end; x += 64) {
+    const uint64_t differs = TCODFOV_bitpacked_row_load64(access, x, y) ^ invert;
+    if (differs) {
+      const int found = x + TCODFOV_ctz64(differs);
+      return found < x_end ? found : x_end;
+    }
+  }
+  return x_end;
+}
+/**
+    Return the last tile in `(x_rend, x]` of row `y` whose value is not `value`, or `x_rend` if there is none.
+
+    This is `TCODFOV_bitpacked_row_find_next` searching towards the left.  `x_rend` must be at least -1.
+ */
+TCODFOV_FORCE_INLINE int TCODFOV_bitpacked_row_find_prev(
+    const TCODFOV_MapAccess* __restrict access, int x, int x_rend, int y, bool value) {
+  const uint64_t invert = value ? ~(uint64_t)0 : 0;
+  for (; x > x_rend; x -= 64) {
+    const uint64_t differs = TCODFOV_bitpacked_row_load64(access, x - 63, y) ^ invert;  // Bit 63 is tile `x`.
+    if (differs) {
+      const int found = x - TCODFOV_clz64(differs);
+      return found > x_rend ? found : x_rend;
+    }
+  }
+  return x_rend;
+}
+/// @brief Assign `value` to the tiles `[x_begin, x_end)` of row `y`.  Tiles outside of the map are ignored.
+TCODFOV_FORCE_INLINE void TCODFOV_bitpacked_row_fill(
+    TCODFOV_MapAccess* __restrict access, int x_begin, int x_end, int y, bool value) {
+  if (x_begin < 0) x_begin = 0;
+  if (x_end > access->width) x_end = access->width;
+  if (x_begin >= x_end) return;
+  uint8_t* __restrict row = access->data + access->y_stride * y;
+  const int byte_first = x_begin >> 3;
+  const int byte_last = (x_end - 1) >> 3;
+  uint8_t mask_first = (uint8_t)(0xFF << (x_begin & 7));
+  const uint8_t mask_last = (uint8_t)(0xFF >> (7 - ((x_end - 1) & 7)));
+  if (byte_first == byte_last) mask_first &= mask_last;
+  row[byte_first] = (uint8_t)(value ? row[byte_first] | mask_first : row[byte_first] & ~mask_first);
+  if (byte_first == byte_last) return;
+  memset(row + byte_first + 1, value ? 0xFF : 0, (size_t)(byte_last - byte_first - 1));
+  row[byte_last] = (uint8_t)(value ? row[byte_last] | mask_last : row[byte_last] & ~mask_last);
+}
+/**
+    Set the tiles of row `y` of a bitpacked map whose bits are set in `word`, starting at `x`.
+
+    Bit 0 of `word` is tile `x`.  Other tiles are left as they are and tiles outside of the map are ignored.
+    `y` must be in bounds.
+ */
+TCODFOV_FORCE_INLINE void TCODFOV_bitpacked_row_or64(
+    TCODFOV_MapAccess* __restrict access, int x, int y, uint64_t word) {
+  if (x <= -64 || x >= access->width) return;
+  if (x < 0) {
+    word >>= -x;
+    x = 0;
+  }
+  const int tiles_left = access->width - x;
+  if (tiles_left < 64) word &= ((uint64_t)1 << tiles_left) - 1;
+  uint8_t* __restrict row = access->data + access->y_stride * y;
+  int byte_index = x >> 3;
+  row[byte_index] = (uint8_t)(row[byte_index] | (uint8_t)(word << (x & 7)));
+  for (word >>= 8 - (x & 7); word; word >>= 8) {
+    ++byte_index;
+    row[byte_index] = (uint8_t)(row[byte_index] | (uint8_t)word);
+  }
+}
+
+/**
+    Run `statement` with `K` declared as the compile-time constant equal to the runtime `kind`.
+
+    Force-inlined kernels called from `statement` with `K` are instantiated once per storage kind.
+ */
+#define TCODFOV_MAP_KIND_SWITCH(kind, K, statement)          \
+  switch (kind) {                                            \
+    case TCODFOV_MAP_KIND_BITPACKED: {                       \
+      const TCODFOV_MapKind K = TCODFOV_MAP_KIND_BITPACKED;   \
+      statement;                                             \
+    } break;                                                 \
+    case TCODFOV_MAP_KIND_BOOL: {                            \
+      const TCODFOV_MapKind K = TCODFOV_MAP_KIND_BOOL;        \
+      statement;                                             \
+    } break;                                                 \
+    case TCODFOV_MAP_KIND_UINT8: {                           \
+      const TCODFOV_MapKind K = TCODFOV_MAP_KIND_UINT8;       \
+      statement;                                             \
+    } break;                                                 \
+    case TCODFOV_MAP_KIND_CALLBACK: {                        \
+      const TCODFOV_MapKind K = TCODFOV_MAP_KIND_CALLBACK;    \
+      statement;                                             \
+    } break;                                                 \
+    case TCODFOV_MAP_KIND_EPOCH: {                           \
+      const TCODFOV_MapKind K = TCODFOV_MAP_KIND_EPOCH;       \
+      statement;                                             \
+    } break;                                                 \
+    default: {                                               \
+      const TCODFOV_MapKind K = TCODFOV_MAP_KIND_GENERIC;     \
+      statement;                                             \
+    } break;                                                 \
+  }
+#endif  // TCODFOV_MAP_ACCESS_H_
@@ -0,0 +1,100 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_PARALLEL_H_
+#define TCODFOV_PARALLEL_H_
+
+#include <stdbool.h>
+
+#include "error.h"
+#include "map_types.h"
+#include "thread_pool.h"
+#include "workspace.h"
+
+/**
+    A task run by `TCODFOV_thread_pool_run_` for one index.
+
+    `workspace` belongs to the thread running the task and is never NULL.
+ */
+typedef TCODFOV_Error (*TCODFOV_ParallelTask)(void* userdata, int index, TCODFOV_Workspace* __restrict workspace);
+/**
+    Run `task` once for every index in `[0, count)` using the threads of `pool`, then wait for all of them to finish.
+
+    Indexes are run in an unspecified order on any thread.  If `pool` is NULL then the tasks are run in order on the
+    calling thread with a temporary workspace.
+    Returns the error of the first task which failed, any tasks not started yet are skipped after a failure.
+ */
+TCODFOV_Error TCODFOV_thread_pool_run_(
+    TCODFOV_ThreadPool* __restrict pool, int count, TCODFOV_ParallelTask task, void* userdata);
+/**
+    Set the error message of the calling thread without logging it.
+
+    Error messages are thread-local, this moves the message of a failed task back to the thread which started it.
+ */
+void TCODFOV_restore_error_(const char* msg);
+
+/**
+    Sectors of the field-of-view algorithms which can be computed independently of each other.
+
+    Each sector only reads and writes the tiles within the rectangle returned by its bounds function, so a sector
+    gives the same results when both maps are views of only that rectangle.
+    The point-of-view itself is not marked by any sector.
+ */
+/// Return the radius used by recursive shadowcasting for `max_radius`, which is derived from the map if zero or less.
+int TCODFOV_recursive_shadowcasting_radius_(const TCODFOV_Map2D* __restrict fov, int pov_x, int pov_y, int max_radius);
+/// Cast one of the 8 octants of recursive shadowcasting, `max_radius` must already be resolved.
+TCODFOV_Error TCODFOV_recursive_shadowcasting_octant_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int octant);
+/// Return the tiles used by an octant of recursive shadowcasting, not clipped to the map.
+TCODFOV_Rect TCODFOV_recursive_shadowcasting_octant_bounds_(int octant, int pov_x, int pov_y, int max_radius);
+/// Scan one of the 4 quadrants of symmetric shadowcasting.
+TCODFOV_Error TCODFOV_symmetric_shadowcast_quadrant_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int quadrant);
+/**
+    Return the tiles used by a quadrant of symmetric shadowcasting up to `extent` tiles away, not clipped to the map.
+
+    `extent` must be at least the radius, or at least the size of the map if there is no radius.
+ */
+TCODFOV_Rect TCODFOV_symmetric_shadowcast_quadrant_bounds_(int quadrant, int pov_x, int pov_y, int extent);
+#endif  // TCODFOV_PARALLEL_H_
@@ -0,0 +1,123 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_SCRATCH_H_
+#define TCODFOV_SCRATCH_H_
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "error.h"
+#include "map_types.h"
+#include "workspace.h"
+
+/// Scratch buffers held by a workspace, one slot per kind of temporary array used by the algorithms.
+enum TCODFOV_ScratchSlot {
+  TCODFOV_SCRATCH_VIEWS,  // Permissive views.
+  TCODFOV_SCRATCH_VIEW_BUMPS,  // Permissive view bumps.
+  TCODFOV_SCRATCH_RAYCAST_GRID,  // Diamond raycasting tiles.
+  TCODFOV_SCRATCH_ANGLES,  // Restrictive shadowcasting obstacles.
+  TCODFOV_SCRATCH_ROWS,  // Triage row buffers.
+  TCODFOV_SCRATCH_COUNT,
+};
+/// Number of circular raycasting ray tries kept by a workspace.  The least recently used one is replaced.
+#define TCODFOV_RAY_TRIE_CACHE_SIZE 4
+struct TCODFOV_Workspace {
+  struct {
+    void* data;
+    size_t capacity;  // Size of `data` in bytes.
+  } buffers[TCODFOV_SCRATCH_COUNT];
+  /// Ray tries of circular raycasting, kept between calls.
+  struct TCODFOV_RayTrie {
+    void* data;  // The trie nodes followed by the arrays used to walk them.
+    size_t capacity;  // Size of `data` in bytes.
+    bool seen;  // True if a call used the bounds below.
+    int count;  // Number of nodes in the trie, or zero if no trie was built for these bounds.
+    int leaf_count;  // Number of rays in the trie.
+    int frontier_capacity;  // Size of each frontier array which follows the trie nodes.
+    int x_min, y_min, x_max, y_max;  // The unclipped perimeter the rays are cast to, relative to the point-of-view.
+    unsigned last_used;  // The value of `ray_trie_clock` when this trie was last used.
+  } ray_tries[TCODFOV_RAY_TRIE_CACHE_SIZE];
+  unsigned ray_trie_clock;  // Incremented for each call which uses a ray trie.
+};
+/**
+    Return a buffer of at least `size` bytes from `slot` of `workspace`.
+
+    The contents of the buffer are unspecified.
+    Returns NULL and sets an error if memory could not be allocated.
+ */
+void* TCODFOV_workspace_reserve_(TCODFOV_Workspace* __restrict workspace, enum TCODFOV_ScratchSlot slot, size_t size);
+/// Free all buffers of `workspace` without freeing `workspace` itself.
+void TCODFOV_workspace_release_(TCODFOV_Workspace* __restrict workspace);
+
+/**
+    Return the area around `pov_x`, `pov_y` within `max_radius` clipped to `fov`.
+
+    Field-of-view calls never modify tiles outside of this area, this is the `dirty` area of
+    `TCODFOV_map_compute_fov_2d`.
+ */
+TCODFOV_Rect TCODFOV_map2d_fov_bounds_(const TCODFOV_Map2D* __restrict fov, int pov_x, int pov_y, int max_radius);
+
+/// Variants of the FOV algorithms which take their scratch memory from `workspace`, which must not be NULL.
+TCODFOV_Error TCODFOV_map_compute_fov_circular_raycasting_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_Workspace* __restrict workspace);
+TCODFOV_Error TCODFOV_map_compute_fov_diamond_raycasting_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_Workspace* __restrict workspace);
+TCODFOV_Error TCODFOV_map_compute_fov_permissive2_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    int permissiveness,
+    TCODFOV_Workspace* __restrict workspace);
+TCODFOV_Error TCODFOV_map_compute_fov_restrictive_shadowcasting_(
+    const TCODFOV_Map2D* __restrict transparent,
+    TCODFOV_Map2D* __restrict fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls,
+    TCODFOV_Workspace* __restrict workspace);
+#endif  // TCODFOV_SCRATCH_H_
@@ -0,0 +1,318 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L  // For sysconf.
+#endif
+#include "thread_pool.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "error.h"
+#include "parallel.h"
+#include "scratch.h"
+/******************************************
+ threads, mutexes, and condition variables
+ ******************************************/
+#ifdef _WIN32
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Condition;
+typedef HANDLE Thread;
+static void mutex_init(Mutex* mutex) { InitializeCriticalSection(mutex); }
+static void mutex_destroy(Mutex* mutex) { DeleteCriticalSection(mutex); }
+static void mutex_lock(Mutex* mutex) { EnterCriticalSection(mutex); }
+static void mutex_unlock(Mutex* mutex) { LeaveCriticalSection(mutex); }
+static void condition_init(Condition* condition) { InitializeConditionVariable(condition); }
+static void condition_destroy(Condition* condition) { (void)condition; }
+static void condition_wait(Condition* condition, Mutex* mutex) { SleepConditionVariableCS(condition, mutex, INFINITE); }
+static void condition_broadcast(Condition* condition) { WakeAllConditionVariable(condition); }
+static void condition_signal(Condition* condition) { WakeConditionVariable(condition); }
+#else
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+typedef pthread_t Thread;
+static void mutex_init(Mutex* mutex) { pthread_mutex_init(mutex, NULL); }
+static void mutex_destroy(Mutex* mutex) { pthread_mutex_destroy(mutex); }
+static void mutex_lock(Mutex* mutex) { pthread_mutex_lock(mutex); }
+static void mutex_unlock(Mutex* mutex) { pthread_mutex_unlock(mutex); }
+static void condition_init(Condition* condition) { pthread_cond_init(condition, NULL); }
+static void condition_destroy(Condition* condition) { pthread_cond_destroy(condition); }
+static void condition_wait(Condition* condition, Mutex* mutex) { pthread_cond_wait(condition, mutex); }
+static void condition_broadcast(Condition* condition) { pthread_cond_broadcast(condition); }
+static void condition_signal(Condition* condition) { pthread_cond_signal(condition); }
+#endif
+/**
+    Return the number of processors, or 1 if it is unknown.
+ */
+static int processor_count(void) {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+  const long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+#endif
+}
+/******************************************
+ thread pool
+ ******************************************/
+/**
+    The range of indexes owned by one thread of a pool.
+ */
+typedef struct Worker {
+  struct TCODFOV_ThreadPool* pool;
+  int index;  // Index of this worker in the pool, zero for the calling thread.
+  Mutex lock;  // Guards `begin` and `end`.
+  int begin;  // The next index this worker will run.
+  int end;  // The end of the indexes owned by this worker.
+  TCODFOV_Workspace workspace;
+} Worker;
+struct TCODFOV_ThreadPool {
+  int thread_count;  // Number of workers, including the calling thread.
+  Worker* workers;
+  Thread* threads;  // The threads of every worker after the first.
+  int threads_started;  // Number of threads in `threads` which were started.
+  Mutex lock;  // Guards all of the fields below.
+  Condition job_ready;  // Signaled when `generation` changes or `quit` is set.
+  Condition job_done;  // Signaled when `running` reaches zero.
+  unsigned generation;  // Incremented for each job.
+  int running;  // Number of pool threads still working on the current job.
+  bool quit;  // If true then the pool threads exit.
+  bool cancelled;  // If true then an index of the current job failed and no more indexes are taken.
+  TCODFOV_ParallelTask task;
+  void* userdata;
+  TCODFOV_Error error;  // The first error of the current job.
+  char error_message[1024];  // The error message of `error`, copied from the thread which set it.
+};
+/**
+    Return true if the current job of `pool` was cancelled.
+ */
+static bool pool_is_cancelled(TCODFOV_ThreadPool* __restrict pool) {
+  mutex_lock(&pool->lock);
+  const bool cancelled = pool->cancelled;
+  mutex_unlock(&pool->lock);
+  return cancelled;
+}
+/**
+    Take the next index of `worker`.  Returns false if it has none left or the job was cancelled.
+ */
+static bool worker_take(Worker* __restrict worker, int* __restrict index) {
+  if (pool_is_cancelled(worker->pool)) return false;
+  mutex_lock(&worker->lock);
+  const bool found = worker->begin < worker->end;
+  if (found) *index = worker->begin++;
+  mutex_unlock(&worker->lock);
+  return found;
+}
+/**
+    Take the upper half of the remaining indexes of another worker and return the first of them.
+
+    Returns false if no other worker has any indexes left or the job was cancelled.
+ */
+static bool worker_steal(Worker* __restrict worker, int* __restrict index) {
+  TCODFOV_ThreadPool* pool = worker->pool;
+  for (int i = 1; i < pool->thread_count; ++i) {
+    if (pool_is_cancelled(pool)) return false;
+    Worker* victim = &pool->workers[(worker->index + i) % pool->thread_count];
+    mutex_lock(&victim->lock);
+    const int stolen_begin = victim->end - (victim->end - victim->begin + 1) / 2;
+    const int stolen_end = victim->end;
+    if (stolen_begin < stolen_end) victim->end = stolen_begin;
+    mutex_unlock(&victim->lock);
+    if (stolen_begin >= stolen_end) continue;
+    // The job may have been cancelled while the victim was unlocked, the stolen indexes are then dropped.
+    if (pool_is_cancelled(pool)) return false;
+    mutex_lock(&worker->lock);
+    worker->begin = stolen_begin + 1;
+    worker->end = stolen_end;
+    mutex_unlock(&worker->lock);
+    *index = stolen_begin;
+    return true;
+  }
+  return false;
+}
+/**
+    Run the current job of the pool until no worker has any indexes left.
+ */
+static void worker_run(Worker* __restrict worker) {
+  TCODFOV_ThreadPool* pool = worker->pool;
+  int index;
+  while (worker_take(worker, &index) || worker_steal(worker, &index)) {
+    const TCODFOV_Error err = pool->task(pool->userdata, index, &worker->workspace);
+    if (err >= 0) continue;
+    mutex_lock(&pool->lock);
+    if (pool->error >= 0) {
+      pool->error = err;
+      strncpy(pool->error_message, TCODFOV_get_error(), sizeof(pool->error_message) - 1);
+    }
+    pool->cancelled = true;  // Workers stop taking indexes, including ones they are in the middle of stealing.
+    mutex_unlock(&pool->lock);
+  }
+}
+/**
+    Wait for jobs and run them until the pool is deleted.
+ */
+static void worker_thread_main(Worker* __restrict worker) {
+  TCODFOV_ThreadPool* pool = worker->pool;
+  unsigned generation = 0;  // Threads which start late still see the jobs started before them.
+  mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->quit && pool->generation == generation) condition_wait(&pool->job_ready, &pool->lock);
+    if (pool->quit) break;
+    generation = pool->generation;
+    mutex_unlock(&pool->lock);
+    worker_run(worker);
+    mutex_lock(&pool->lock);
+    if (--pool->running == 0) condition_signal(&pool->job_done);
+  }
+  mutex_unlock(&pool->lock);
+}
+#ifdef _WIN32
+static DWORD WINAPI worker_thread_entry(LPVOID worker) {
+  worker_thread_main(worker);
+  return 0;
+}
+#else
+static void* worker_thread_entry(void* worker) {
+  worker_thread_main(worker);
+  return NULL;
+}
+#endif
+
+TCODFOV_ThreadPool* TCODFOV_thread_pool_new(int thread_count) {
+  if (thread_count <= 0) thread_count = processor_count();
+  TCODFOV_ThreadPool* pool = calloc(1, sizeof(*pool));
+  if (!pool) {
+    TCODFOV_set_errorv("Out of memory.");
+    return NULL;
+  }
+  pool->workers = calloc((size_t)thread_count, sizeof(*pool->workers));
+  pool->threads = calloc((size_t)thread_count, sizeof(*pool->threads));
+  if (!pool->workers || !pool->threads) {
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+    TCODFOV_set_errorv("Out of memory.");
+    return NULL;
+  }
+  pool->thread_count = thread_count;
+  mutex_init(&pool->lock);
+  condition_init(&pool->job_ready);
+  condition_init(&pool->job_done);
+  for (int i = 0; i < thread_count; ++i) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    mutex_init(&pool->workers[i].lock);
+  }
+  for (int i = 1; i < thread_count; ++i) {
+#ifdef _WIN32
+    pool->threads[i] = CreateThread(NULL, 0, worker_thread_entry, &pool->workers[i], 0, NULL);
+    const bool started = pool->threads[i] != NULL;
+#else
+    const bool started = pthread_create(&pool->threads[i], NULL, worker_thread_entry, &pool->workers[i]) == 0;
+#endif
+    if (!started) {
+      TCODFOV_thread_pool_delete(pool);
+      TCODFOV_set_errorvf("Could not start thread %i of %i.", i, thread_count);
+      return NULL;
+    }
+    pool->threads_started = i;
+  }
+  return pool;
+}
+void TCODFOV_thread_pool_delete(TCODFOV_ThreadPool* pool) {
+  if (!pool) return;
+  mutex_lock(&pool->lock);
+  pool->quit = true;
+  condition_broadcast(&pool->job_ready);
+  mutex_unlock(&pool->lock);
+  for (int i = 1; i <= pool->threads_started; ++i) {
+#ifdef _WIN32
+    WaitForSingleObject(pool->threads[i], INFINITE);
+    CloseHandle(pool->threads[i]);
+#else
+    pthread_join(pool->threads[i], NULL);
+#endif
+  }
+  for (int i = 0; i < pool->thread_count; ++i) {
+    mutex_destroy(&pool->workers[i].lock);
+    TCODFOV_workspace_release_(&pool->workers[i].workspace);
+  }
+  condition_destroy(&pool->job_done);
+  condition_destroy(&pool->job_ready);
+  mutex_destroy(&pool->lock);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool);
+}
+int TCODFOV_thread_pool_get_thread_count(const TCODFOV_ThreadPool* pool) { return pool ? pool->thread_count : 1; }
+TCODFOV_Error TCODFOV_thread_pool_run_(
+    TCODFOV_ThreadPool* __restrict pool, int count, TCODFOV_ParallelTask task, void* userdata) {
+  if (!pool || pool->thread_count == 1 || count <= 1) {
+    TCODFOV_Workspace temp_workspace = {0};
+    TCODFOV_Workspace* workspace = pool ? &pool->workers[0].workspace : &temp_workspace;
+    TCODFOV_Error err = TCODFOV_E_OK;
+    for (int i = 0; i < count && err >= 0; ++i) err = task(userdata, i, workspace);
+    TCODFOV_workspace_release_(&temp_workspace);
+    return err;
+  }
+  for (int i = 0; i < pool->thread_count; ++i) {
+    pool->workers[i].begin = (int)((long long)count * i / pool->thread_count);
+    pool->workers[i].end = (int)((long long)count * (i + 1) / pool->thread_count);
+  }
+  mutex_lock(&pool->lock);
+  pool->task = task;
+  pool->userdata = userdata;
+  pool->error = TCODFOV_E_OK;
+  pool->cancelled = false;
+  pool->running = pool->thread_count - 1;
+  ++pool->generation;
+  condition_broadcast(&pool->job_ready);
+  mutex_unlock(&pool->lock);
+  worker_run(&pool->workers[0]);
+  mutex_lock(&pool->lock);
+  while (pool->running) condition_wait(&pool->job_done, &pool->lock);
+  const TCODFOV_Error err = pool->error;
+  if (err < 0) TCODFOV_restore_error_(pool->error_message);
+  mutex_unlock(&pool->lock);
+  return err;
+}
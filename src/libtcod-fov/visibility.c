@@ -0,0 +1,548 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/** \file
+    Fields-of-view of many viewers which are recomputed only after the map changes around them.
+ */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L  // For clock_gettime.
+#endif
+#include "visibility.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "libtcod_int.h"
+#include "map_inline.h"
+#include "map_types.h"
+#include "parallel.h"
+#include "scratch.h"
+#include "utility.h"
+/**
+    Viewers are indexed by square cells of `1 << GRID_CELL_SHIFT` tiles on each side.
+ */
+#define GRID_CELL_SHIFT 5
+/**
+    The order of a dirty viewer in a budgeted update.
+ */
+typedef struct DirtyViewer {
+  int priority;
+  int64_t dirty_since;
+  int index;
+} DirtyViewer;
+/**
+    A growable array of viewer indexes.
+ */
+typedef struct IndexList {
+  int* items;
+  int count;
+  int capacity;
+} IndexList;
+/**
+    One viewer and its last field-of-view.
+ */
+typedef struct Viewer {
+  bool active;  // False if this viewer was removed and its index is free.
+  bool dirty;  // True if this viewer is in the dirty list of the system.
+  int priority;  // Dirty viewers with a higher priority are computed first by a budgeted update.
+  int64_t dirty_since;  // The update count of the system when this viewer was marked.
+  int pov_x;
+  int pov_y;
+  int max_radius;
+  TCODFOV_Rect bounds;  // The tiles this viewer can see, clipped to the map.
+  TCODFOV_Rect window;  // `bounds` extended left to a multiple of 8 tiles, so a bitpacked view of it starts on a byte.
+  TCODFOV_Map2D fov;  // Bitpacked results, indexed relative to `window`.
+  size_t fov_capacity;  // Bytes allocated for the data of `fov`.
+} Viewer;
+struct TCODFOV_Visibility {
+  int width;
+  int height;
+  bool light_walls;
+  TCODFOV_fov_algorithm_t algo;
+  TCODFOV_Map2D transparent;  // Bitpacked transparency, always changed through `map`.
+  TCODFOV_Map2D map;  // Callbacks to `transparent` which mark the viewers near each changed tile.
+  Viewer** viewers;  // Viewers are allocated separately so that their field-of-view maps never move.
+  int viewer_count;
+  int viewer_capacity;
+  IndexList free_viewers;  // Indexes of removed viewers.  Its capacity is always `viewer_capacity`.
+  IndexList dirty;  // Indexes of the viewers to recompute.  Its capacity is always `viewer_capacity`.
+  DirtyViewer* order;  // Scratch space to sort the dirty list, with a capacity of `viewer_capacity`.
+  int64_t update_count;  // The number of updates so far, used to tell how stale a viewer is.
+  double ns_per_tile;  // Average time to compute a tile of a viewer's bounds, or 0 before the first budgeted update.
+  int grid_width;
+  int grid_height;
+  IndexList* grid;  // The viewers whose bounds overlap each cell.
+  TCODFOV_Workspace workspace;
+};
+/**
+    Grow `list` so that it can hold at least `capacity` items.
+ */
+static TCODFOV_Error index_list_reserve(IndexList* __restrict list, int capacity) {
+  if (capacity <= list->capacity) return TCODFOV_E_OK;
+  const int new_capacity = TCODFOV_MAX(capacity, list->capacity * 2);
+  int* new_items = realloc(list->items, sizeof(*new_items) * (size_t)new_capacity);
+  if (!new_items) {
+    TCODFOV_set_errorv("Out of memory.");
+    return TCODFOV_E_OUT_OF_MEMORY;
+  }
+  list->items = new_items;
+  list->capacity = new_capacity;
+  return TCODFOV_E_OK;
+}
+/**
+    Remove `item` from `list` if it is there.  The last item takes its place.
+ */
+static void index_list_remove(IndexList* __restrict list, int item) {
+  for (int i = 0; i < list->count; ++i) {
+    if (list->items[i] != item) continue;
+    list->items[i] = list->items[--list->count];
+    return;
+  }
+}
+/**
+    Make room in every cell overlapping `bounds` for one more viewer.
+ */
+static TCODFOV_Error grid_reserve(TCODFOV_Visibility* __restrict visibility, TCODFOV_Rect bounds) {
+  for (int y = bounds.y >> GRID_CELL_SHIFT; y <= (bounds.y + bounds.height - 1) >> GRID_CELL_SHIFT; ++y) {
+    for (int x = bounds.x >> GRID_CELL_SHIFT; x <= (bounds.x + bounds.width - 1) >> GRID_CELL_SHIFT; ++x) {
+      IndexList* cell = &visibility->grid[y * visibility->grid_width + x];
+      const TCODFOV_Error err = index_list_reserve(cell, cell->count + 1);
+      if (err < 0) return err;
+    }
+  }
+  return TCODFOV_E_OK;
+}
+/**
+    Add viewer `index` to the cells overlapping `bounds`.  `grid_reserve` must have been called first.
+ */
+static void grid_add(TCODFOV_Visibility* __restrict visibility, int index, TCODFOV_Rect bounds) {
+  for (int y = bounds.y >> GRID_CELL_SHIFT; y <= (bounds.y + bounds.height - 1) >> GRID_CELL_SHIFT; ++y) {
+    for (int x = bounds.x >> GRID_CELL_SHIFT; x <= (bounds.x + bounds.width - 1) >> GRID_CELL_SHIFT; ++x) {
+      IndexList* cell = &visibility->grid[y * visibility->grid_width + x];
+      cell->items[cell->count++] = index;
+    }
+  }
+}
+/**
+    Remove viewer `index` from the cells overlapping `bounds`.
+ */
+static void grid_remove(TCODFOV_Visibility* __restrict visibility, int index, TCODFOV_Rect bounds) {
+  for (int y = bounds.y >> GRID_CELL_SHIFT; y <= (bounds.y + bounds.height - 1) >> GRID_CELL_SHIFT; ++y) {
+    for (int x = bounds.x >> GRID_CELL_SHIFT; x <= (bounds.x + bounds.width - 1) >> GRID_CELL_SHIFT; ++x) {
+      index_list_remove(&visibility->grid[y * visibility->grid_width + x], index);
+    }
+  }
+}
+/**
+    Queue viewer `index` for the next update.
+ */
+static void mark_viewer(TCODFOV_Visibility* __restrict visibility, int index) {
+  Viewer* viewer = visibility->viewers[index];
+  if (viewer->dirty) return;
+  viewer->dirty = true;
+  viewer->dirty_since = visibility->update_count;
+  visibility->dirty.items[visibility->dirty.count++] = index;
+}
+/**
+    Set one in-bounds tile and mark the viewers which can see it if it changed.
+ */
+static void set_tile(TCODFOV_Visibility* __restrict visibility, int x, int y, bool transparent) {
+  if (TCODFOV_map2d_get_bool(&visibility->transparent, x, y) == transparent) return;
+  TCODFOV_map2d_set_bool(&visibility->transparent, x, y, transparent);
+  const IndexList* cell = &visibility->grid[(y >> GRID_CELL_SHIFT) * visibility->grid_width + (x >> GRID_CELL_SHIFT)];
+  for (int i = 0; i < cell->count; ++i) {
+    const TCODFOV_Rect bounds = visibility->viewers[cell->items[i]]->bounds;
+    if (x < bounds.x || y < bounds.y || x >= bounds.x + bounds.width || y >= bounds.y + bounds.height) continue;
+    mark_viewer(visibility, cell->items[i]);
+  }
+}
+static bool map_get(void* userdata, int x, int y) {
+  const TCODFOV_Visibility* visibility = userdata;
+  return TCODFOV_map2d_get_bool(&visibility->transparent, x, y);
+}
+static void map_set(void* userdata, int x, int y, bool value) { set_tile(userdata, x, y, value); }
+/**
+    Return the viewer at `index`, or set an error and return NULL if there is none.
+ */
+static Viewer* get_viewer(const TCODFOV_Visibility* __restrict visibility, int index) {
+  if (!visibility) {
+    TCODFOV_set_errorv("Visibility system must not be NULL.");
+    return NULL;
+  }
+  if (index < 0 || index >= visibility->viewer_count || !visibility->viewers[index]->active) {
+    TCODFOV_set_errorvf("Viewer %i does not exist.", index);
+    return NULL;
+  }
+  return visibility->viewers[index];
+}
+/**
+    Move `viewer` to `pov_x`, `pov_y` and clear its field-of-view.  Nothing is changed on failure.
+
+    The viewer is removed from the grid cells of `old_bounds`, which is empty for a new viewer.
+ */
+static TCODFOV_Error place_viewer(
+    TCODFOV_Visibility* __restrict visibility, int index, TCODFOV_Rect old_bounds, int pov_x, int pov_y) {
+  Viewer* viewer = visibility->viewers[index];
+  const TCODFOV_Rect bounds = TCODFOV_map2d_fov_bounds_(&visibility->transparent, pov_x, pov_y, viewer->max_radius);
+  const TCODFOV_Rect window = {bounds.x & ~7, bounds.y, bounds.width + (bounds.x & 7), bounds.height};
+  const ptrdiff_t y_stride = (window.width + 7) >> 3;
+  const size_t size = (size_t)y_stride * (size_t)window.height;
+  uint8_t* data = viewer->fov.bitpacked.data;
+  if (size > viewer->fov_capacity) {
+    data = malloc(size);
+    if (!data) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+  }
+  const TCODFOV_Error err = grid_reserve(visibility, bounds);
+  if (err < 0) {
+    if (data != viewer->fov.bitpacked.data) free(data);
+    return err;
+  }
+  if (old_bounds.width > 0) grid_remove(visibility, index, old_bounds);
+  grid_add(visibility, index, bounds);
+  if (data != viewer->fov.bitpacked.data) {
+    free(viewer->fov.bitpacked.data);
+    viewer->fov_capacity = size;
+  }
+  memset(data, 0, size);
+  viewer->pov_x = pov_x;
+  viewer->pov_y = pov_y;
+  viewer->bounds = bounds;
+  viewer->window = window;
+  viewer->fov = (TCODFOV_Map2D){.bitpacked = {TCODFOV_MAP2D_BITPACKED, {window.height, window.width}, data, y_stride}};
+  mark_viewer(visibility, index);
+  return TCODFOV_E_OK;
+}
+/**
+    Sort dirty viewers by higher priority first, then by the oldest first.
+ */
+static int compare_dirty_viewers(const void* a_ptr, const void* b_ptr) {
+  const DirtyViewer* a = a_ptr;
+  const DirtyViewer* b = b_ptr;
+  if (a->priority != b->priority) return a->priority > b->priority ? -1 : 1;
+  if (a->dirty_since != b->dirty_since) return a->dirty_since < b->dirty_since ? -1 : 1;
+  return a->index - b->index;
+}
+/**
+    Return the time of a monotonic clock in nanoseconds.
+ */
+static double time_ns(void) {
+#ifdef _WIN32
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+/**
+    Recompute the dirty viewer at `index` of the dirty list.
+ */
+static TCODFOV_Error update_viewer(void* userdata, int index, TCODFOV_Workspace* __restrict workspace) {
+  const TCODFOV_Visibility* visibility = userdata;
+  Viewer* viewer = visibility->viewers[visibility->dirty.items[index]];
+  const TCODFOV_Rect window = viewer->window;
+  // A field-of-view never reads past its radius, so a view of only the window gives the same results.
+  const ptrdiff_t y_stride = visibility->transparent.bitpacked.y_stride;
+  const TCODFOV_Map2D transparent = {
+      .bitpacked = {
+          .type = TCODFOV_MAP2D_BITPACKED,
+          .shape = {window.height, window.width},
+          .data = visibility->transparent.bitpacked.data + y_stride * window.y + (window.x >> 3),
+          .y_stride = y_stride,
+      }};
+  memset(viewer->fov.bitpacked.data, 0, (size_t)viewer->fov.bitpacked.y_stride * (size_t)window.height);
+  return TCODFOV_map_compute_fov_2d(
+      &transparent,
+      &viewer->fov,
+      viewer->pov_x - window.x,
+      viewer->pov_y - window.y,
+      viewer->max_radius,
+      visibility->light_walls,
+      visibility->algo,
+      workspace,
+      NULL);
+}
+TCODFOV_Visibility* TCODFOV_visibility_new(int width, int height, bool light_walls, TCODFOV_fov_algorithm_t algo) {
+  if (width <= 0 || height <= 0) {
+    TCODFOV_set_errorvf("Map size must be positive, got {%i, %i}.", width, height);
+    return NULL;
+  }
+  if ((int)algo < 0 || algo >= NB_FOV_ALGORITHMS) {
+    TCODFOV_set_errorvf("Invalid field-of-view algorithm %i.", (int)algo);
+    return NULL;
+  }
+  const ptrdiff_t y_stride = (width + 7) / 8;
+  const int grid_width = ((width - 1) >> GRID_CELL_SHIFT) + 1;
+  const int grid_height = ((height - 1) >> GRID_CELL_SHIFT) + 1;
+  TCODFOV_Visibility* visibility = calloc(1, sizeof(*visibility));
+  uint8_t* data = calloc((size_t)y_stride * (size_t)height, 1);
+  IndexList* grid = calloc((size_t)grid_width * (size_t)grid_height, sizeof(*grid));
+  if (!visibility || !data || !grid) {
+    free(visibility);
+    free(data);
+    free(grid);
+    TCODFOV_set_errorv("Out of memory.");
+    return NULL;
+  }
+  visibility->width = width;
+  visibility->height = height;
+  visibility->light_walls = light_walls;
+  visibility->algo = algo;
+  visibility->transparent = (TCODFOV_Map2D){
+      .bitpacked = {
+          .type = TCODFOV_MAP2D_BITPACKED,
+          .shape = {height, width},
+          .data = data,
+          .y_stride = y_stride,
+      }};
+  visibility->map = (TCODFOV_Map2D){
+      .bool_callback = {
+          .type = TCODFOV_MAP2D_CALLBACK,
+          .shape = {height, width},
+          .userdata = visibility,
+          .get = map_get,
+          .set = map_set,
+      }};
+  visibility->grid_width = grid_width;
+  visibility->grid_height = grid_height;
+  visibility->grid = grid;
+  return visibility;
+}
+void TCODFOV_visibility_delete(TCODFOV_Visibility* visibility) {
+  if (!visibility) return;
+  for (int i = 0; i < visibility->viewer_count; ++i) {
+    free(visibility->viewers[i]->fov.bitpacked.data);
+    free(visibility->viewers[i]);
+  }
+  for (int i = 0; i < visibility->grid_width * visibility->grid_height; ++i) free(visibility->grid[i].items);
+  free(visibility->grid);
+  free(visibility->viewers);
+  free(visibility->free_viewers.items);
+  free(visibility->dirty.items);
+  free(visibility->order);
+  free(visibility->transparent.bitpacked.data);
+  TCODFOV_workspace_release_(&visibility->workspace);
+  free(visibility);
+}
+TCODFOV_Map2D* TCODFOV_visibility_get_map(TCODFOV_Visibility* visibility) {
+  return visibility ? &visibility->map : NULL;
+}
+TCODFOV_Error TCODFOV_visibility_set_tiles(
+    TCODFOV_Visibility* __restrict visibility,
+    int count,
+    const TCODFOV_Point* __restrict points,
+    const bool* __restrict transparent) {
+  if (!visibility) {
+    TCODFOV_set_errorv("Visibility system must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count < 0) {
+    TCODFOV_set_errorvf("Tile count must not be negative, got %i.", count);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (count > 0 && (!points || !transparent)) {
+    TCODFOV_set_errorv("Tile arrays must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (!TCODFOV_map2d_in_bounds(&visibility->transparent, points[i].x, points[i].y)) {
+      TCODFOV_set_errorvf("Tile {%i, %i} at index %i is out of bounds.", points[i].x, points[i].y, i);
+      return TCODFOV_E_INVALID_ARGUMENT;
+    }
+  }
+  for (int i = 0; i < count; ++i) set_tile(visibility, points[i].x, points[i].y, transparent[i]);
+  return TCODFOV_E_OK;
+}
+int TCODFOV_visibility_add_viewer(TCODFOV_Visibility* visibility, int pov_x, int pov_y, int max_radius) {
+  if (!visibility) {
+    TCODFOV_set_errorv("Visibility system must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (!TCODFOV_map2d_in_bounds(&visibility->transparent, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (visibility->free_viewers.count == 0 && visibility->viewer_count == visibility->viewer_capacity) {
+    const int new_capacity = TCODFOV_MAX(16, visibility->viewer_capacity * 2);
+    Viewer** new_viewers = realloc(visibility->viewers, sizeof(*new_viewers) * (size_t)new_capacity);
+    if (new_viewers) visibility->viewers = new_viewers;
+    DirtyViewer* new_order = realloc(visibility->order, sizeof(*new_order) * (size_t)new_capacity);
+    if (new_order) visibility->order = new_order;
+    if (!new_viewers || !new_order || index_list_reserve(&visibility->free_viewers, new_capacity) < 0 ||
+        index_list_reserve(&visibility->dirty, new_capacity) < 0) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+    visibility->viewer_capacity = new_capacity;
+  }
+  int index;
+  if (visibility->free_viewers.count > 0) {
+    index = visibility->free_viewers.items[--visibility->free_viewers.count];
+  } else {
+    Viewer* viewer = calloc(1, sizeof(*viewer));
+    if (!viewer) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+    index = visibility->viewer_count++;
+    visibility->viewers[index] = viewer;
+  }
+  Viewer* viewer = visibility->viewers[index];
+  viewer->max_radius = max_radius;
+  const TCODFOV_Error err = place_viewer(visibility, index, (TCODFOV_Rect){0, 0, 0, 0}, pov_x, pov_y);
+  if (err < 0) {
+    visibility->free_viewers.items[visibility->free_viewers.count++] = index;
+    return err;
+  }
+  viewer->active = true;
+  return index;
+}
+TCODFOV_Error TCODFOV_visibility_move_viewer(TCODFOV_Visibility* visibility, int viewer, int pov_x, int pov_y) {
+  Viewer* moved = get_viewer(visibility, viewer);
+  if (!moved) return TCODFOV_E_INVALID_ARGUMENT;
+  if (!TCODFOV_map2d_in_bounds(&visibility->transparent, pov_x, pov_y)) {
+    TCODFOV_set_errorvf("Point of view {%i, %i} is out of bounds.", pov_x, pov_y);
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  if (moved->pov_x == pov_x && moved->pov_y == pov_y) return TCODFOV_E_OK;
+  return place_viewer(visibility, viewer, moved->bounds, pov_x, pov_y);
+}
+TCODFOV_Error TCODFOV_visibility_remove_viewer(TCODFOV_Visibility* visibility, int viewer) {
+  Viewer* removed = get_viewer(visibility, viewer);
+  if (!removed) return TCODFOV_E_INVALID_ARGUMENT;
+  grid_remove(visibility, viewer, removed->bounds);
+  if (removed->dirty) index_list_remove(&visibility->dirty, viewer);
+  free(removed->fov.bitpacked.data);
+  *removed = (Viewer){0};
+  visibility->free_viewers.items[visibility->free_viewers.count++] = viewer;
+  return TCODFOV_E_OK;
+}
+TCODFOV_Error TCODFOV_visibility_update(
+    TCODFOV_Visibility* __restrict visibility, TCODFOV_ThreadPool* __restrict pool) {
+  if (!visibility) {
+    TCODFOV_set_errorv("Visibility system must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  TCODFOV_Error err = TCODFOV_E_OK;
+  if (pool) {
+    err = TCODFOV_thread_pool_run_(pool, visibility->dirty.count, update_viewer, visibility);
+  } else {
+    for (int i = 0; i < visibility->dirty.count && err >= 0; ++i) {
+      err = update_viewer(visibility, i, &visibility->workspace);
+    }
+  }
+  ++visibility->update_count;
+  if (err < 0) return err;
+  for (int i = 0; i < visibility->dirty.count; ++i) visibility->viewers[visibility->dirty.items[i]]->dirty = false;
+  visibility->dirty.count = 0;
+  return TCODFOV_E_OK;
+}
+TCODFOV_Error TCODFOV_visibility_update_budget(TCODFOV_Visibility* visibility, int budget_us) {
+  if (!visibility) {
+    TCODFOV_set_errorv("Visibility system must not be NULL.");
+    return TCODFOV_E_INVALID_ARGUMENT;
+  }
+  const int count = visibility->dirty.count;
+  for (int i = 0; i < count; ++i) {
+    const int index = visibility->dirty.items[i];
+    const Viewer* viewer = visibility->viewers[index];
+    visibility->order[i] = (DirtyViewer){viewer->priority, viewer->dirty_since, index};
+  }
+  qsort(visibility->order, (size_t)count, sizeof(*visibility->order), compare_dirty_viewers);
+  const double start = time_ns();
+  const double budget_ns = (double)budget_us * 1000.0;
+  TCODFOV_Error err = TCODFOV_E_OK;
+  int done = 0;
+  for (; done < count; ++done) {
+    const Viewer* viewer = visibility->viewers[visibility->order[done].index];
+    const double tiles = (double)viewer->bounds.width * (double)viewer->bounds.height;
+    const double before = time_ns();
+    // Viewers are run strictly in order so that none can be starved by cheaper ones behind it.  The first one is
+    // always run so that every update makes progress.
+    if (done > 0 && before - start + tiles * visibility->ns_per_tile > budget_ns) break;
+    visibility->dirty.items[done] = visibility->order[done].index;
+    if ((err = update_viewer(visibility, done, &visibility->workspace)) < 0) break;
+    const double ns_per_tile = (time_ns() - before) / tiles;
+    visibility->ns_per_tile =
+        visibility->ns_per_tile > 0 ? visibility->ns_per_tile * 0.75 + ns_per_tile * 0.25 : ns_per_tile;
+  }
+  ++visibility->update_count;
+  // Keep the viewers which were not computed, in their new order.
+  visibility->dirty.count = 0;
+  for (int i = 0; i < count; ++i) {
+    Viewer* viewer = visibility->viewers[visibility->order[i].index];
+    if (i < done) {
+      viewer->dirty = false;
+    } else {
+      visibility->dirty.items[visibility->dirty.count++] = visibility->order[i].index;
+    }
+  }
+  return err;
+}
+TCODFOV_Error TCODFOV_visibility_set_priority(TCODFOV_Visibility* visibility, int viewer, int priority) {
+  Viewer* changed = get_viewer(visibility, viewer);
+  if (!changed) return TCODFOV_E_INVALID_ARGUMENT;
+  changed->priority = priority;
+  return TCODFOV_E_OK;
+}
+int TCODFOV_visibility_get_staleness(const TCODFOV_Visibility* visibility, int viewer) {
+  const Viewer* checked = get_viewer(visibility, viewer);
+  if (!checked) return TCODFOV_E_INVALID_ARGUMENT;
+  return checked->dirty ? (int)(visibility->update_count - checked->dirty_since) : 0;
+}
+int TCODFOV_visibility_get_dirty_count(const TCODFOV_Visibility* visibility) {
+  return visibility ? visibility->dirty.count : 0;
+}
+const TCODFOV_Map2D* TCODFOV_visibility_get_fov(
+    const TCODFOV_Visibility* __restrict visibility, int viewer, TCODFOV_Rect* __restrict window) {
+  if (!visibility || viewer < 0 || viewer >= visibility->viewer_count || !visibility->viewers[viewer]->active) {
+    return NULL;
+  }
+  if (window) *window = visibility->viewers[viewer]->window;
+  return &visibility->viewers[viewer]->fov;
+}
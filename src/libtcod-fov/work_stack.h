@@ -0,0 +1,110 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef TCODFOV_WORK_STACK_H_
+#define TCODFOV_WORK_STACK_H_
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+/**
+    A LIFO stack of pending work items of a fixed size.
+
+    Items are first stored in a buffer given by the caller, usually on the C stack, and are moved to the heap only
+    once that buffer is full.  This keeps the engines which use it iterative, with bounded C stack use.
+ */
+typedef struct TCODFOV_WorkStack {
+  unsigned char* data;  // Item storage, either `inline_data` or a heap allocation.
+  unsigned char* inline_data;  // Initial storage given by the caller, not owned by this stack.
+  ptrdiff_t inline_capacity;  // Number of items which fit in `inline_data`.
+  size_t item_size;  // Size of each item in bytes.
+  ptrdiff_t count;  // Number of items on the stack.
+  ptrdiff_t capacity;  // Number of items which fit in `data`.
+} TCODFOV_WorkStack;
+/**
+    Return an empty stack using `inline_data` of `inline_capacity` items as its initial storage.
+ */
+static inline TCODFOV_WorkStack TCODFOV_work_stack_init(
+    void* inline_data, ptrdiff_t inline_capacity, size_t item_size) {
+  return (TCODFOV_WorkStack){
+      .data = inline_data,
+      .inline_data = inline_data,
+      .inline_capacity = inline_capacity,
+      .item_size = item_size,
+      .count = 0,
+      .capacity = inline_capacity,
+  };
+}
+/**
+    Push a copy of `item` onto `stack`.
+
+    Returns TCODFOV_E_OUT_OF_MEMORY and sets an error if the stack could not grow.
+ */
+static inline TCODFOV_Error TCODFOV_work_stack_push(TCODFOV_WorkStack* __restrict stack, const void* __restrict item) {
+  if (stack->count == stack->capacity) {
+    const ptrdiff_t new_capacity = stack->capacity * 2 + 16;
+    unsigned char* new_data = stack->data == stack->inline_data
+                                  ? malloc((size_t)new_capacity * stack->item_size)
+                                  : realloc(stack->data, (size_t)new_capacity * stack->item_size);
+    if (!new_data) {
+      TCODFOV_set_errorv("Out of memory.");
+      return TCODFOV_E_OUT_OF_MEMORY;
+    }
+    if (stack->data == stack->inline_data && stack->count) {
+      memcpy(new_data, stack->data, (size_t)stack->count * stack->item_size);
+    }
+    stack->data = new_data;
+    stack->capacity = new_capacity;
+  }
+  memcpy(stack->data + (size_t)stack->count++ * stack->item_size, item, stack->item_size);
+  return TCODFOV_E_OK;
+}
+/**
+    Remove the top item of `stack` and return a pointer to it, or return NULL if `stack` is empty.
+
+    The returned pointer is only valid until the next push.
+ */
+static inline const void* TCODFOV_work_stack_pop(TCODFOV_WorkStack* __restrict stack) {
+  if (!stack->count) return NULL;
+  return stack->data + (size_t)--stack->count * stack->item_size;
+}
+/**
+    Free any heap memory held by `stack`.
+ */
+static inline void TCODFOV_work_stack_free(TCODFOV_WorkStack* __restrict stack) {
+  if (stack->data != stack->inline_data) free(stack->data);
+  stack->data = stack->inline_data;
+  stack->capacity = stack->inline_capacity;
+  stack->count = 0;
+}
+#endif  // TCODFOV_WORK_STACK_H_
@@ -0,0 +1,77 @@
+/* BSD 3-Clause License
+ *
+ * Copyright © 2008-2023, Jice and the libtcod contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "workspace.h"
+
+#include <stdlib.h>
+
+#include "scratch.h"
+
+TCODFOV_Workspace* TCODFOV_workspace_new(void) {
+  TCODFOV_Workspace* workspace = calloc(1, sizeof(*workspace));
+  if (!workspace) TCODFOV_set_errorv("Out of memory.");
+  return workspace;
+}
+void TCODFOV_workspace_delete(TCODFOV_Workspace* workspace) {
+  if (!workspace) return;
+  TCODFOV_workspace_release_(workspace);
+  free(workspace);
+}
+void* TCODFOV_workspace_reserve_(TCODFOV_Workspace* __restrict workspace, enum TCODFOV_ScratchSlot slot, size_t size) {
+  if (size <= workspace->buffers[slot].capacity) return workspace->buffers[slot].data;
+  // Grow geometrically so that slowly increasing sizes do not reallocate every call.
+  const size_t grown = workspace->buffers[slot].capacity + workspace->buffers[slot].capacity / 2;
+  const size_t new_capacity = size > grown ? size : grown;
+  // Old contents are never kept, so skip the copy realloc would do.
+  free(workspace->buffers[slot].data);
+  workspace->buffers[slot].data = malloc(new_capacity);
+  if (!workspace->buffers[slot].data) {
+    workspace->buffers[slot].capacity = 0;
+    TCODFOV_set_errorv("Out of memory.");
+    return NULL;
+  }
+  workspace->buffers[slot].capacity = new_capacity;
+  return workspace->buffers[slot].data;
+}
+void TCODFOV_workspace_release_(TCODFOV_Workspace* __restrict workspace) {
+  for (int i = 0; i < TCODFOV_SCRATCH_COUNT; ++i) {
+    free(workspace->buffers[i].data);
+    workspace->buffers[i].data = NULL;
+    workspace->buffers[i].capacity = 0;
+  }
+  for (int i = 0; i < TCODFOV_RAY_TRIE_CACHE_SIZE; ++i) {
+    free(workspace->ray_tries[i].data);
+    workspace->ray_tries[i].data = NULL;
+    workspace->ray_tries[i].capacity = 0;
+    workspace->ray_tries[i].seen = false;
+    workspace->ray_tries[i].count = 0;
+  }
+}
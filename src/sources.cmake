@@ -3,17 +3,28 @@ target_sources(${PROJECT_NAME} PRIVATE
     libtcod-fov/bresenham_c.c
     libtcod-fov/dda.c
     libtcod-fov/error.c
+    libtcod-fov/fov_batch.c
     libtcod-fov/fov_c.c
+    libtcod-fov/fov_cache.c
     libtcod-fov/fov_circular_raycasting.c
     libtcod-fov/fov_diamond_raycasting.c
+    libtcod-fov/fov_parallel.c
     libtcod-fov/fov_pascal.c
     libtcod-fov/fov_permissive2.c
     libtcod-fov/fov_recursive_shadowcasting.c
     libtcod-fov/fov_restrictive.c
     libtcod-fov/fov_symmetric_shadowcast.c
+    libtcod-fov/fov_tracker.c
     libtcod-fov/fov_triage.c
     libtcod-fov/logging.c
+    libtcod-fov/map_access.h
+    libtcod-fov/parallel.h
+    libtcod-fov/scratch.h
+    libtcod-fov/thread_pool.c
     libtcod-fov/utility.h
+    libtcod-fov/visibility.c
+    libtcod-fov/work_stack.h
+    libtcod-fov/workspace.c
 )
 install(FILES
     ../include/libtcod-fov.h
@@ -29,7 +40,10 @@ install(FILES
     ../include/libtcod-fov/error.hpp
     ../include/libtcod-fov/fov.h
     ../include/libtcod-fov/fov.hpp
+    ../include/libtcod-fov/fov_cache.h
     ../include/libtcod-fov/fov_pascal.h
+    ../include/libtcod-fov/fov_resumable.h
+    ../include/libtcod-fov/fov_tracker.h
     ../include/libtcod-fov/fov_triage.h
     ../include/libtcod-fov/fov_types.h
     ../include/libtcod-fov/libtcod_int.h
@@ -37,7 +51,10 @@ install(FILES
     ../include/libtcod-fov/map.hpp
     ../include/libtcod-fov/map_inline.h
     ../include/libtcod-fov/map_types.h
+    ../include/libtcod-fov/thread_pool.h
     ../include/libtcod-fov/version.h
+    ../include/libtcod-fov/visibility.h
+    ../include/libtcod-fov/workspace.h
     DESTINATION ${CMAKE_INSTALL_INCLUDEDIR}/libtcod-fov
     COMPONENT IncludeFiles
 )
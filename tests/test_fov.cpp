@@ -1,6 +1,9 @@
 
 #include <algorithm>
+#include <array>
 #include <catch2/catch_all.hpp>
+#include <cfloat>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <gsl/gsl>
@@ -9,12 +12,20 @@
 #include <random>
 #include <ranges>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "libtcod-fov/fov.hpp"
+#include "libtcod-fov/fov_cache.h"
+#include "libtcod-fov/fov_pascal.h"
+#include "libtcod-fov/fov_resumable.h"
+#include "libtcod-fov/fov_tracker.h"
+#include "libtcod-fov/fov_triage.h"
 #include "libtcod-fov/libtcod_int.h"
 #include "libtcod-fov/map.hpp"
+#include "libtcod-fov/visibility.h"
+#include "libtcod-fov/workspace.h"
 
 struct MapInfo {
   std::string name{};
@@ -78,6 +89,57 @@ static auto new_forest_map(int radius) -> tcod::fov::Bitpacked2D {
   return map;
 }
 
+/// @brief Return a map where each tile is a wall with a 1 in `wall_one_in` chance.
+static auto random_map(int width, int height, int wall_one_in, uint32_t seed) -> tcod::fov::Bitpacked2D {
+  std::mt19937 rng(seed);
+  tcod::fov::Bitpacked2D map{{height, width}};
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) map.set_bool({y, x}, rng() % wall_one_in != 0);
+  }
+  return map;
+}
+/// @brief Return a callback map which reads and writes `data` one tile at a time.
+static auto callback_map(tcod::fov::Bitpacked2D& data) -> TCODFOV_Map2D {
+  const auto get_callback = [](void* userdata, int x, int y) {
+    return static_cast<tcod::fov::Bitpacked2D*>(userdata)->get_bool({y, x});
+  };
+  const auto set_callback = [](void* userdata, int x, int y, bool value) {
+    static_cast<tcod::fov::Bitpacked2D*>(userdata)->set_bool({y, x}, value);
+  };
+  const auto shape = data.get_shape();
+  return TCODFOV_Map2D{
+      .bool_callback{TCODFOV_MAP2D_CALLBACK, {shape.at(0), shape.at(1)}, &data, get_callback, set_callback}};
+}
+/// @brief Return a map of one byte per tile viewing `data`.
+static auto bytes_map(std::vector<uint8_t>& data, int width, int height) -> TCODFOV_Map2D {
+  return TCODFOV_Map2D{.contigious{TCODFOV_MAP2D_CONTIGIOUS, {height, width}, data.data(), TCODFOV_DATATYPE_UINT8}};
+}
+/// @brief Return a copy of the field-of-view of a `TCODFOV_Map`.
+static auto fov_of(const TCODFOV_Map* map) -> tcod::fov::Bitpacked2D {
+  tcod::fov::Bitpacked2D fov{{TCODFOV_map_get_height(map), TCODFOV_map_get_width(map)}};
+  for (int y = 0; y < TCODFOV_map_get_height(map); ++y) {
+    for (int x = 0; x < TCODFOV_map_get_width(map); ++x) fov.set_bool({y, x}, TCODFOV_map_is_in_fov(map, x, y));
+  }
+  return fov;
+}
+/// @brief Require two maps of the same shape to have the same tiles set.
+static void require_same_fov(const TCODFOV_Map2D* a, const TCODFOV_Map2D* b) {
+  const int width = TCODFOV_map2d_get_width(a);
+  const int height = TCODFOV_map2d_get_height(a);
+  REQUIRE(TCODFOV_map2d_get_width(b) == width);
+  REQUIRE(TCODFOV_map2d_get_height(b) == height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      if (TCODFOV_map2d_get_bool(a, x, y) == TCODFOV_map2d_get_bool(b, x, y)) continue;
+      CAPTURE(x, y);
+      REQUIRE(TCODFOV_map2d_get_bool(a, x, y) == TCODFOV_map2d_get_bool(b, x, y));
+    }
+  }
+}
+static void require_same_fov(const tcod::fov::Bitpacked2D& a, const tcod::fov::Bitpacked2D& b) {
+  require_same_fov(a.get_ptr(), b.get_ptr());
+}
+
 static auto center_of_radius(int radius) -> std::tuple<int, int> { return {radius, radius}; }
 
 TEST_CASE("FOV Benchmarks", "[.benchmark]") {
@@ -229,3 +291,1440 @@ TEST_CASE("restrictive FOV: larger non-square overflow envelope", "[fov][bug3]")
     TCODFOV_map_delete(map);
   }
 }
+
+TEST_CASE("restrictive FOV is symmetric under transposition", "[fov]") {
+  std::mt19937 rng(7);
+  for (int i = 0; i < 2000; ++i) {
+    const int w = 3 + rng() % 20;
+    const int h = 3 + rng() % 20;
+    const int pov_x = rng() % w;
+    const int pov_y = rng() % h;
+    const int radius = rng() % 8;
+    const bool light_walls = rng() % 2;
+    CAPTURE(i, w, h, pov_x, pov_y, radius, light_walls);
+    TCODFOV_Map* map = TCODFOV_map_new(w, h);
+    TCODFOV_Map* transposed = TCODFOV_map_new(h, w);
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        const bool transparent = (x == pov_x && y == pov_y) || rng() % 3 != 0;
+        TCODFOV_map_set_properties(map, x, y, transparent, transparent);
+        TCODFOV_map_set_properties(transposed, y, x, transparent, transparent);
+      }
+    }
+    REQUIRE(TCODFOV_map_compute_fov(map, pov_x, pov_y, radius, light_walls, TCODFOV_RESTRICTIVE) == TCODFOV_E_OK);
+    REQUIRE(
+        TCODFOV_map_compute_fov(transposed, pov_y, pov_x, radius, light_walls, TCODFOV_RESTRICTIVE) == TCODFOV_E_OK);
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) {
+        CAPTURE(x, y);
+        REQUIRE(TCODFOV_map_is_in_fov(map, x, y) == TCODFOV_map_is_in_fov(transposed, y, x));
+      }
+    }
+    TCODFOV_map_delete(map);
+    TCODFOV_map_delete(transposed);
+  }
+}
+
+/// @brief Call the FOV function matching `algorithm` on two 2D maps.
+static auto compute_fov_2d(
+    TCODFOV_fov_algorithm_t algorithm,
+    const TCODFOV_Map2D* transparent,
+    TCODFOV_Map2D* fov,
+    int pov_x,
+    int pov_y,
+    int max_radius,
+    bool light_walls) -> TCODFOV_Error {
+  switch (algorithm) {
+    case TCODFOV_BASIC:
+      return TCODFOV_map_compute_fov_circular_raycasting(transparent, fov, pov_x, pov_y, max_radius, light_walls);
+    case TCODFOV_DIAMOND:
+      return TCODFOV_map_compute_fov_diamond_raycasting(transparent, fov, pov_x, pov_y, max_radius, light_walls);
+    case TCODFOV_SHADOW:
+      return TCODFOV_map_compute_fov_recursive_shadowcasting(transparent, fov, pov_x, pov_y, max_radius, light_walls);
+    case TCODFOV_RESTRICTIVE:
+      return TCODFOV_map_compute_fov_restrictive_shadowcasting(transparent, fov, pov_x, pov_y, max_radius, light_walls);
+    case TCODFOV_SYMMETRIC_SHADOWCAST:
+      return TCODFOV_map_compute_fov_symmetric_shadowcast(transparent, fov, pov_x, pov_y, max_radius, light_walls);
+    default:
+      return TCODFOV_map_compute_fov_permissive2(
+          transparent, fov, pov_x, pov_y, max_radius, light_walls, algorithm - TCODFOV_PERMISSIVE_0);
+  }
+}
+
+TEST_CASE("FOV results match across map storage kinds", "[fov]") {
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(GENERATE(
+      TCODFOV_BASIC,
+      TCODFOV_DIAMOND,
+      TCODFOV_SHADOW,
+      TCODFOV_PERMISSIVE_0,
+      TCODFOV_PERMISSIVE_8,
+      TCODFOV_RESTRICTIVE,
+      TCODFOV_SYMMETRIC_SHADOWCAST));
+  const int max_radius = GENERATE(0, 6);
+  const bool light_walls = GENERATE(false, true);
+  static constexpr int WIDTH = 23;  // Non-square to catch mixed up strides.
+  static constexpr int HEIGHT = 17;
+  static constexpr int POV_X = 9;
+  static constexpr int POV_Y = 7;
+  auto transparent = random_map(WIDTH, HEIGHT, 4, 0);
+  transparent.set_bool({POV_Y, POV_X}, true);
+  auto transparent_u8 = std::vector<uint8_t>(WIDTH * HEIGHT);
+  auto legacy_map = tcod::fov::MapPtr_{TCODFOV_map_new(WIDTH, HEIGHT)};
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) {
+      transparent_u8.at(y * WIDTH + x) = transparent.get_bool({y, x});
+      TCODFOV_map_set_properties(legacy_map.get(), x, y, transparent.get_bool({y, x}), true);
+    }
+  }
+  auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(
+      compute_fov_2d(algorithm, transparent.get_ptr(), expected.get_ptr(), POV_X, POV_Y, max_radius, light_walls) ==
+      TCODFOV_E_OK);
+
+  auto fov_u8 = std::vector<uint8_t>(WIDTH * HEIGHT);
+  const TCODFOV_Map2D transparent_contigious = bytes_map(transparent_u8, WIDTH, HEIGHT);
+  TCODFOV_Map2D fov_contigious = bytes_map(fov_u8, WIDTH, HEIGHT);
+  REQUIRE(
+      compute_fov_2d(algorithm, &transparent_contigious, &fov_contigious, POV_X, POV_Y, max_radius, light_walls) ==
+      TCODFOV_E_OK);
+
+  auto fov_callback_data = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  const TCODFOV_Map2D transparent_callback = callback_map(transparent);
+  TCODFOV_Map2D fov_callback = callback_map(fov_callback_data);
+  REQUIRE(
+      compute_fov_2d(algorithm, &transparent_callback, &fov_callback, POV_X, POV_Y, max_radius, light_walls) ==
+      TCODFOV_E_OK);
+
+  // Mixed storage kinds fall back to the generic accessors.
+  auto fov_mixed = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(
+      compute_fov_2d(
+          algorithm, &transparent_contigious, fov_mixed.get_ptr(), POV_X, POV_Y, max_radius, light_walls) ==
+      TCODFOV_E_OK);
+
+  REQUIRE(TCODFOV_map_compute_fov(legacy_map.get(), POV_X, POV_Y, max_radius, light_walls, algorithm) == TCODFOV_E_OK);
+
+  require_same_fov(expected.get_ptr(), &fov_contigious);
+  require_same_fov(expected, fov_callback_data);
+  require_same_fov(expected, fov_mixed);
+  require_same_fov(expected, fov_of(legacy_map.get()));
+}
+
+TEST_CASE("Bitpacked span-skipping matches per-tile FOV on wide maps", "[fov]") {
+  const auto algorithm =
+      static_cast<TCODFOV_fov_algorithm_t>(GENERATE(TCODFOV_SHADOW, TCODFOV_SYMMETRIC_SHADOWCAST));
+  const int max_radius = GENERATE(0, 40);
+  const bool light_walls = GENERATE(false, true);
+  const uint32_t seed = GENERATE(range(0u, 8u));
+  const unsigned wall_chance = GENERATE(4u, 200u);  // Open maps have many rows without walls near the pov.
+  static constexpr int WIDTH = 150;  // Rows span multiple 64-tile words.
+  static constexpr int HEIGHT = 61;
+  std::mt19937 rng(seed);
+  auto transparent = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH;) {  // Long runs of floors and walls.
+      const bool is_transparent = rng() % wall_chance != 0;
+      for (int run = 1 + rng() % 80; run > 0 && x < WIDTH; --run, ++x) transparent.set_bool({y, x}, is_transparent);
+    }
+  }
+  const int pov_x = static_cast<int>(rng() % WIDTH);
+  const int pov_y = static_cast<int>(rng() % HEIGHT);
+  transparent.set_bool({pov_y, pov_x}, true);
+
+  auto fov_bitpacked = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(
+      compute_fov_2d(
+          algorithm, transparent.get_ptr(), fov_bitpacked.get_ptr(), pov_x, pov_y, max_radius, light_walls) ==
+      TCODFOV_E_OK);
+
+  // Callback maps are always processed one tile at a time.
+  auto fov_callback_data = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  const TCODFOV_Map2D transparent_callback = callback_map(transparent);
+  TCODFOV_Map2D fov_callback = callback_map(fov_callback_data);
+  REQUIRE(
+      compute_fov_2d(algorithm, &transparent_callback, &fov_callback, pov_x, pov_y, max_radius, light_walls) ==
+      TCODFOV_E_OK);
+  require_same_fov(fov_bitpacked, fov_callback_data);
+}
+
+TEST_CASE("Symmetric shadowcasting fills wall-free leading rows like a full scan", "[fov]") {
+  // Radii from 1 to 31 use the bitboard kernel, so these cover the row scan and its open-rows fast path.
+  const int max_radius = GENERATE(0, 40, 90);
+  const bool light_walls = GENERATE(false, true);
+  const int wall_count = GENERATE(0, 1, 6);
+  const uint32_t seed = GENERATE(range(0u, 6u));
+  static constexpr int WIDTH = 140;
+  static constexpr int HEIGHT = 100;
+  std::mt19937 rng(seed);
+  auto transparent = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}, true};
+  const int pov_x = seed % 3 == 0 ? 0 : static_cast<int>(rng() % WIDTH);  // Some on the edges of the map.
+  const int pov_y = seed % 2 == 0 ? HEIGHT - 1 : static_cast<int>(rng() % HEIGHT);
+  for (int i = 0; i < wall_count; ++i) {  // A few walls near the pov, on its axes and diagonals.
+    const int distance = 1 + static_cast<int>(rng() % 20);
+    const int dx = static_cast<int>(rng() % 3) - 1;
+    const int dy = static_cast<int>(rng() % 3) - 1;
+    const int x = std::clamp(pov_x + dx * distance + static_cast<int>(rng() % 3) - 1, 0, WIDTH - 1);
+    const int y = std::clamp(pov_y + dy * distance + static_cast<int>(rng() % 3) - 1, 0, HEIGHT - 1);
+    if (x != pov_x || y != pov_y) transparent.set_bool({y, x}, false);
+  }
+  CAPTURE(max_radius, light_walls, wall_count, seed, pov_x, pov_y);
+
+  auto fov_bitpacked = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(
+      TCODFOV_map_compute_fov_symmetric_shadowcast(
+          transparent.get_ptr(), fov_bitpacked.get_ptr(), pov_x, pov_y, max_radius, light_walls) == TCODFOV_E_OK);
+  // Byte maps are always scanned one tile at a time.
+  auto transparent_bytes = std::vector<uint8_t>(WIDTH * HEIGHT);
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) transparent_bytes.at(y * WIDTH + x) = transparent.get_bool({y, x});
+  }
+  auto fov_bytes = std::vector<uint8_t>(WIDTH * HEIGHT);
+  const auto transparent_bytes_map = bytes_map(transparent_bytes, WIDTH, HEIGHT);
+  auto fov_bytes_map = bytes_map(fov_bytes, WIDTH, HEIGHT);
+  REQUIRE(
+      TCODFOV_map_compute_fov_symmetric_shadowcast(
+          &transparent_bytes_map, &fov_bytes_map, pov_x, pov_y, max_radius, light_walls) == TCODFOV_E_OK);
+  require_same_fov(fov_bitpacked.get_ptr(), &fov_bytes_map);
+}
+
+/// @brief Symmetric shadowcasting as it was before it was bounded by the radius.
+///
+/// Every quadrant is scanned to the edges of the map, then walls and tiles outside of the radius are cleared from
+/// the whole output.
+static auto reference_symmetric_shadowcast(
+    const tcod::fov::Bitpacked2D& transparent, int pov_x, int pov_y, int max_radius, bool light_walls)
+    -> tcod::fov::Bitpacked2D {
+  const auto [height, width] = transparent.get_shape();
+  auto fov = tcod::fov::Bitpacked2D{{height, width}};
+  const auto in_bounds = [&](int x, int y) { return 0 <= x && x < width && 0 <= y && y < height; };
+  const auto slope = [](int depth, int column) { return (2.0f * column - 1.0f) / (2.0f * depth); };
+  struct Row {
+    int depth;
+    float slope_low;
+    float slope_high;
+  };
+  static constexpr int QUADRANTS[4][4] = {{1, 0, 0, 1}, {0, 1, 1, 0}, {0, -1, -1, 0}, {-1, 0, 0, -1}};
+  fov.set_bool({pov_y, pov_x}, true);
+  for (const auto& [xx, xy, yx, yy] : QUADRANTS) {
+    auto rows = std::vector<Row>{{1, -1.0f, 1.0f}};
+    while (!rows.empty()) {
+      Row row = rows.back();
+      rows.pop_back();
+      if (!in_bounds(pov_x + row.depth * xx, pov_y + row.depth * yx)) continue;
+      const int column_min = static_cast<int>(std::round(row.depth * row.slope_low * (1 + FLT_EPSILON)));
+      const int column_max = static_cast<int>(std::round(row.depth * row.slope_high * (1 - FLT_EPSILON)));
+      bool prev_tile_is_wall = false;
+      for (int column = column_min; column <= column_max; ++column) {
+        const int x = pov_x + row.depth * xx + column * xy;
+        const int y = pov_y + row.depth * yx + column * yy;
+        if (!in_bounds(x, y)) continue;
+        const bool is_wall = !transparent.get_bool({y, x});
+        if (is_wall || (column >= row.depth * row.slope_low && column <= row.depth * row.slope_high)) {
+          fov.set_bool({y, x}, true);
+        }
+        if (prev_tile_is_wall && !is_wall) row.slope_low = slope(row.depth, column);
+        if (column != column_min && !prev_tile_is_wall && is_wall) {
+          rows.push_back({row.depth + 1, row.slope_low, slope(row.depth, column)});
+        }
+        prev_tile_is_wall = is_wall;
+      }
+      if (!prev_tile_is_wall) rows.push_back({row.depth + 1, row.slope_low, row.slope_high});
+    }
+  }
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int dx = x - pov_x;
+      const int dy = y - pov_y;
+      if (!light_walls && !transparent.get_bool({y, x})) fov.set_bool({y, x}, false);
+      if (max_radius > 0 && dx * dx + dy * dy >= max_radius * max_radius) fov.set_bool({y, x}, false);
+    }
+  }
+  return fov;
+}
+
+TEST_CASE("Symmetric shadowcasting matches the full-map reference", "[fov]") {
+  // Covers the bitboard kernel, the row scan and its wall-free fast path, and byte maps scanned one tile at a time.
+  const int wall_one_in = GENERATE(3, 8, 200);
+  const bool light_walls = GENERATE(false, true);
+  const uint32_t seed = GENERATE(range(0u, 4u));
+  static constexpr int WIDTH = 110;
+  static constexpr int HEIGHT = 75;
+  CAPTURE(wall_one_in, light_walls, seed);
+  auto transparent = random_map(WIDTH, HEIGHT, wall_one_in, seed);
+  auto transparent_bytes = std::vector<uint8_t>(WIDTH * HEIGHT);
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) transparent_bytes.at(y * WIDTH + x) = transparent.get_bool({y, x});
+  }
+  const auto transparent_bytes_map = bytes_map(transparent_bytes, WIDTH, HEIGHT);
+  std::mt19937 rng(seed);
+  for (int i = 0; i < 6; ++i) {
+    // Corners and edges, then random points-of-view which may be walls.
+    const int pov_x = i == 0 ? 0 : i == 1 ? WIDTH - 1 : static_cast<int>(rng() % WIDTH);
+    const int pov_y = i == 0 ? 0 : i == 1 ? HEIGHT / 2 : static_cast<int>(rng() % HEIGHT);
+    for (int max_radius : {0, 1, 2, 9, 31, 32, 47, 200}) {
+      CAPTURE(pov_x, pov_y, max_radius);
+      const auto expected = reference_symmetric_shadowcast(transparent, pov_x, pov_y, max_radius, light_walls);
+      auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+      REQUIRE(
+          TCODFOV_map_compute_fov_symmetric_shadowcast(
+              transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, max_radius, light_walls) == TCODFOV_E_OK);
+      require_same_fov(fov, expected);
+      auto fov_bytes = std::vector<uint8_t>(WIDTH * HEIGHT);
+      auto fov_bytes_map = bytes_map(fov_bytes, WIDTH, HEIGHT);
+      REQUIRE(
+          TCODFOV_map_compute_fov_symmetric_shadowcast(
+              &transparent_bytes_map, &fov_bytes_map, pov_x, pov_y, max_radius, light_walls) == TCODFOV_E_OK);
+      require_same_fov(&fov_bytes_map, expected.get_ptr());
+    }
+  }
+}
+
+TEST_CASE("Symmetric shadowcasting bitboard kernel matches per-tile FOV", "[fov]") {
+  // Radii from 1 to 31 on bitpacked maps use the bitboard kernel, callback maps are scanned one tile at a time.
+  static constexpr int WIDTH = 90;
+  static constexpr int HEIGHT = 45;
+  const int density = GENERATE(3, 8, 40);
+  auto transparent = random_map(WIDTH, HEIGHT, density, 14);
+  const TCODFOV_Map2D transparent_callback = callback_map(transparent);
+  // Points of view near the edges of the map clip the window of the kernel.
+  for (auto [pov_x, pov_y] :
+       {std::array{45, 22}, std::array{0, 0}, std::array{WIDTH - 2, HEIGHT - 1}, std::array{30, 3}}) {
+    for (int radius = 1; radius <= 32; ++radius) {
+      for (bool light_walls : {false, true}) {
+        CAPTURE(pov_x, pov_y, radius, light_walls);
+        auto fov_bitpacked = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+        auto fov_callback_data = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+        // Tiles already set in the output are kept.
+        fov_bitpacked.set_bool({pov_y, WIDTH - 1 - pov_x}, true);
+        fov_callback_data.set_bool({pov_y, WIDTH - 1 - pov_x}, true);
+        TCODFOV_Map2D fov_callback = callback_map(fov_callback_data);
+        REQUIRE(
+            TCODFOV_map_compute_fov_symmetric_shadowcast(
+                transparent.get_ptr(), fov_bitpacked.get_ptr(), pov_x, pov_y, radius, light_walls) == TCODFOV_E_OK);
+        REQUIRE(
+            TCODFOV_map_compute_fov_symmetric_shadowcast(
+                &transparent_callback, &fov_callback, pov_x, pov_y, radius, light_walls) == TCODFOV_E_OK);
+        require_same_fov(fov_bitpacked, fov_callback_data);
+      }
+    }
+  }
+}
+
+TEST_CASE("Symmetric shadowcasting union matches separate calls", "[fov]") {
+  static constexpr int WIDTH = 80;
+  static constexpr int HEIGHT = 60;
+  static constexpr int COUNT = 24;
+  std::mt19937 rng(16);
+  const int density = GENERATE(4, 30);
+  const bool light_walls = GENERATE(false, true);
+  CAPTURE(density, light_walls);
+  // Scattered walls and a room, so that clustered points of view share most of what they see.
+  auto transparent = random_map(WIDTH, HEIGHT, density, 16);
+  for (int x = 20; x <= 50; ++x) {
+    transparent.set_bool({15, x}, false);
+    transparent.set_bool({40, x}, false);
+  }
+  for (int y = 15; y <= 40; ++y) {
+    transparent.set_bool({y, 20}, false);
+    transparent.set_bool({y, 50}, false);
+  }
+  transparent.set_bool({27, 20}, true);  // A door.
+  std::vector<int> pov_x(COUNT);
+  std::vector<int> pov_y(COUNT);
+  std::vector<int> radius(COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    pov_x[i] = i == 0 ? 0 : 21 + static_cast<int>(rng() % 8);
+    pov_y[i] = i == 0 ? HEIGHT - 1 : 16 + static_cast<int>(rng() % 8);
+    radius[i] = std::array{0, 4, 12, 20, 31, 40}[rng() % 6];
+  }
+  pov_x[COUNT - 1] = pov_x[COUNT - 2];  // The same point of view twice.
+  pov_y[COUNT - 1] = pov_y[COUNT - 2];
+  radius[COUNT - 1] = radius[COUNT - 2];
+
+  auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  auto fov_bitpacked = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  auto fov_callback_data = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  // Tiles already set in the output are kept.
+  expected.set_bool({0, WIDTH - 1}, true);
+  fov_bitpacked.set_bool({0, WIDTH - 1}, true);
+  fov_callback_data.set_bool({0, WIDTH - 1}, true);
+  TCODFOV_Map2D fov_callback = callback_map(fov_callback_data);
+  for (int i = 0; i < COUNT; ++i) {
+    REQUIRE(
+        TCODFOV_map_compute_fov_symmetric_shadowcast(
+            transparent.get_ptr(), expected.get_ptr(), pov_x[i], pov_y[i], radius[i], light_walls) == TCODFOV_E_OK);
+  }
+  REQUIRE(
+      TCODFOV_map_compute_fov_symmetric_shadowcast_union(
+          transparent.get_ptr(),
+          fov_bitpacked.get_ptr(),
+          COUNT,
+          pov_x.data(),
+          pov_y.data(),
+          radius.data(),
+          light_walls) == TCODFOV_E_OK);
+  REQUIRE(
+      TCODFOV_map_compute_fov_symmetric_shadowcast_union(
+          transparent.get_ptr(), &fov_callback, COUNT, pov_x.data(), pov_y.data(), radius.data(), light_walls) ==
+      TCODFOV_E_OK);
+  require_same_fov(fov_bitpacked, expected);
+  require_same_fov(fov_callback_data, expected);
+
+  // Every point of view is checked before the output is modified.
+  pov_x[COUNT - 1] = WIDTH;
+  auto unchanged = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  CHECK(
+      TCODFOV_map_compute_fov_symmetric_shadowcast_union(
+          transparent.get_ptr(),
+          unchanged.get_ptr(),
+          COUNT,
+          pov_x.data(),
+          pov_y.data(),
+          radius.data(),
+          light_walls) == TCODFOV_E_INVALID_ARGUMENT);
+  require_same_fov(unchanged, tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}});
+}
+
+TEST_CASE("TCODFOV_Map properties are stored independently", "[fov]") {
+  static constexpr int WIDTH = 13;  // Not a multiple of 8.
+  static constexpr int HEIGHT = 5;
+  auto map = tcod::fov::MapPtr_{TCODFOV_map_new(WIDTH, HEIGHT)};
+  REQUIRE(map);
+  CHECK(TCODFOV_map_get_nb_cells(map.get()) == WIDTH * HEIGHT);
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) {
+      TCODFOV_map_set_properties(map.get(), x, y, (x + y) % 2 == 0, (x * y) % 3 == 0);
+      TCODFOV_map_set_in_fov(map.get(), x, y, x % 5 == 0);
+    }
+  }
+  const auto check_pattern = [](const TCODFOV_Map* checked) {
+    for (int y = 0; y < HEIGHT; ++y) {
+      for (int x = 0; x < WIDTH; ++x) {
+        CAPTURE(x, y);
+        CHECK(TCODFOV_map_is_transparent(checked, x, y) == ((x + y) % 2 == 0));
+        CHECK(TCODFOV_map_is_walkable(const_cast<TCODFOV_Map*>(checked), x, y) == ((x * y) % 3 == 0));
+        CHECK(TCODFOV_map_is_in_fov(checked, x, y) == (x % 5 == 0));
+      }
+    }
+  };
+  check_pattern(map.get());
+
+  auto copy = tcod::fov::MapPtr_{TCODFOV_map_new(3, 40)};  // Different size, must be reallocated.
+  REQUIRE(TCODFOV_map_copy(map.get(), copy.get()) == TCODFOV_E_OK);
+  CHECK(TCODFOV_map_get_width(copy.get()) == WIDTH);
+  CHECK(TCODFOV_map_get_height(copy.get()) == HEIGHT);
+  check_pattern(copy.get());
+
+  TCODFOV_map_clear(map.get(), true, false);
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) {
+      CAPTURE(x, y);
+      CHECK(TCODFOV_map_is_transparent(map.get(), x, y));
+      CHECK(!TCODFOV_map_is_walkable(map.get(), x, y));
+      CHECK(!TCODFOV_map_is_in_fov(map.get(), x, y));
+    }
+  }
+  CHECK(!TCODFOV_map_is_transparent(map.get(), WIDTH, 0));  // Out-of-bounds.
+  check_pattern(copy.get());  // The copy does not share storage.
+}
+
+TEST_CASE("Epoch-stamped FOV output", "[fov]") {
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(GENERATE(
+      TCODFOV_BASIC,
+      TCODFOV_DIAMOND,
+      TCODFOV_SHADOW,
+      TCODFOV_PERMISSIVE_8,
+      TCODFOV_RESTRICTIVE,
+      TCODFOV_SYMMETRIC_SHADOWCAST));
+  static constexpr int WIDTH = 37;
+  static constexpr int HEIGHT = 29;
+  std::mt19937 rng(1);
+  auto transparent = random_map(WIDTH, HEIGHT, 5, 1);
+  auto fov_epoch = tcod::fov::Map2DPtr{TCODFOV_map2d_new_epoch(WIDTH, HEIGHT)};
+  REQUIRE(fov_epoch);
+  for (int i = 0; i < 4; ++i) {
+    if (i == 2) fov_epoch->epoch.epoch = UINT32_MAX;  // The next advance wraps around.
+    TCODFOV_map2d_epoch_advance(fov_epoch.get());
+    REQUIRE(fov_epoch->epoch.epoch != 0);
+    for (int y = 0; y < HEIGHT; ++y) {
+      for (int x = 0; x < WIDTH; ++x) REQUIRE(!TCODFOV_map2d_get_bool(fov_epoch.get(), x, y));
+    }
+    const int pov_x = static_cast<int>(rng() % WIDTH);
+    const int pov_y = static_cast<int>(rng() % HEIGHT);
+    const int max_radius = i * 4;
+    transparent.set_bool({pov_y, pov_x}, true);
+    auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    REQUIRE(
+        compute_fov_2d(algorithm, transparent.get_ptr(), expected.get_ptr(), pov_x, pov_y, max_radius, false) ==
+        TCODFOV_E_OK);
+    REQUIRE(
+        compute_fov_2d(algorithm, transparent.get_ptr(), fov_epoch.get(), pov_x, pov_y, max_radius, false) ==
+        TCODFOV_E_OK);
+    CAPTURE(i);
+    require_same_fov(fov_epoch.get(), expected.get_ptr());
+  }
+}
+
+TEST_CASE("FOV dirty rectangle and clearing it", "[fov]") {
+  static constexpr int WIDTH = 40;
+  static constexpr int HEIGHT = 30;
+  const int max_radius = GENERATE(0, 3, 7);
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(GENERATE(range(0, static_cast<int>(NB_FOV_ALGORITHMS))));
+  const auto transparent = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}, true};
+  auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  auto fov_epoch = tcod::fov::Map2DPtr{TCODFOV_map2d_new_epoch(WIDTH, HEIGHT)};
+  for (auto [pov_x, pov_y] : {std::array{2, 3}, std::array{20, 15}, std::array{39, 29}}) {
+    CAPTURE(pov_x, pov_y);
+    TCODFOV_Rect dirty{};
+    REQUIRE(
+        TCODFOV_map_compute_fov_2d(
+            transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, max_radius, true, algorithm, nullptr, &dirty) ==
+        TCODFOV_E_OK);
+    TCODFOV_Rect dirty_epoch{};
+    REQUIRE(
+        TCODFOV_map_compute_fov_2d(
+            transparent.get_ptr(),
+            fov_epoch.get(),
+            pov_x,
+            pov_y,
+            max_radius,
+            true,
+            algorithm,
+            nullptr,
+            &dirty_epoch) == TCODFOV_E_OK);
+    CHECK(dirty.x == dirty_epoch.x);
+    CHECK(dirty.width == dirty_epoch.width);
+    if (max_radius > 0) {
+      CHECK(dirty.width <= max_radius * 2 + 1);
+      CHECK(dirty.height <= max_radius * 2 + 1);
+    }
+    for (int y = 0; y < HEIGHT; ++y) {
+      for (int x = 0; x < WIDTH; ++x) {
+        const bool in_dirty = dirty.x <= x && x < dirty.x + dirty.width && dirty.y <= y && y < dirty.y + dirty.height;
+        if (!in_dirty) {
+          CAPTURE(x, y);
+          REQUIRE(!fov.get_bool({y, x}));
+        }
+      }
+    }
+    CHECK(fov.get_bool({pov_y, pov_x}));
+    REQUIRE(TCODFOV_map2d_clear_rect(fov.get_ptr(), dirty) == TCODFOV_E_OK);
+    REQUIRE(TCODFOV_map2d_clear_rect(fov_epoch.get(), dirty_epoch) == TCODFOV_E_OK);
+    const auto empty = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    require_same_fov(fov, empty);
+    require_same_fov(fov_epoch.get(), empty.get_ptr());
+  }
+  TCODFOV_Rect dirty{1, 1, 1, 1};
+  CHECK(
+      TCODFOV_map_compute_fov_2d(
+          transparent.get_ptr(), fov.get_ptr(), -1, 0, max_radius, true, algorithm, nullptr, &dirty) ==
+      TCODFOV_E_INVALID_ARGUMENT);
+  CHECK(dirty.width == 0);
+}
+
+TEST_CASE("FOV workspace reuse", "[fov]") {
+  auto workspace = tcod::fov::WorkspacePtr_{TCODFOV_workspace_new()};
+  REQUIRE(workspace);
+  std::mt19937 rng(2);
+  // Alternate between map sizes and algorithms so that buffers are both grown and reused with stale contents.
+  for (auto [width, height] : {std::array{20, 10}, std::array{64, 48}, std::array{7, 3}, std::array{64, 48}}) {
+    auto transparent = random_map(width, height, 4, rng());
+    const int pov_x = static_cast<int>(rng() % width);
+    const int pov_y = static_cast<int>(rng() % height);
+    for (int algorithm = 0; algorithm < static_cast<int>(NB_FOV_ALGORITHMS); ++algorithm) {
+      CAPTURE(width, height, algorithm);
+      auto expected = tcod::fov::Bitpacked2D{{height, width}};
+      auto fov = tcod::fov::Bitpacked2D{{height, width}};
+      const auto algo = static_cast<TCODFOV_fov_algorithm_t>(algorithm);
+      REQUIRE(
+          TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(), expected.get_ptr(), pov_x, pov_y, 0, true, algo, nullptr, nullptr) ==
+          TCODFOV_E_OK);
+      REQUIRE(
+          TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, 0, true, algo, workspace.get(), nullptr) ==
+          TCODFOV_E_OK);
+      require_same_fov(fov, expected);
+    }
+    auto triage_expected = std::vector<uint8_t>(width * height);
+    auto triage = std::vector<uint8_t>(width * height);
+    TCODFOV_Map2D triage_expected_map = bytes_map(triage_expected, width, height);
+    TCODFOV_Map2D triage_map = bytes_map(triage, width, height);
+    REQUIRE(TCODFOV_triage_2d(transparent.get_ptr(), &triage_expected_map, pov_x, pov_y) == TCODFOV_E_OK);
+    REQUIRE(TCODFOV_triage_2d_ex(transparent.get_ptr(), &triage_map, pov_x, pov_y, workspace.get()) == TCODFOV_E_OK);
+    CHECK(triage == triage_expected);
+  }
+}
+
+TEST_CASE("Circular raycasting with a cached ray trie", "[fov]") {
+  static constexpr int WIDTH = 40;
+  static constexpr int HEIGHT = 30;
+  auto workspace = tcod::fov::WorkspacePtr_{TCODFOV_workspace_new()};
+  REQUIRE(workspace);
+  auto transparent = random_map(WIDTH, HEIGHT, 5, 4);
+  // Points of view next to the edges of the map clip the bounds the rays are cast to.
+  for (auto [pov_x, pov_y] : {std::array{20, 15}, std::array{0, 0}, std::array{WIDTH - 1, 3}, std::array{21, 15}}) {
+    for (int radius : {0, 1, 6}) {
+      for (bool light_walls : {false, true}) {
+        CAPTURE(pov_x, pov_y, radius, light_walls);
+        transparent.set_bool({pov_y, pov_x}, true);
+        auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+        REQUIRE(
+            TCODFOV_map_compute_fov_2d(
+                transparent.get_ptr(),
+                expected.get_ptr(),
+                pov_x,
+                pov_y,
+                radius,
+                light_walls,
+                TCODFOV_BASIC,
+                nullptr,
+                nullptr) == TCODFOV_E_OK);
+        // The first call with the same bounds casts rays directly, later calls use the trie.
+        for (int repeat = 0; repeat < 3; ++repeat) {
+          CAPTURE(repeat);
+          auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+          REQUIRE(
+              TCODFOV_map_compute_fov_2d(
+                  transparent.get_ptr(),
+                  fov.get_ptr(),
+                  pov_x,
+                  pov_y,
+                  radius,
+                  light_walls,
+                  TCODFOV_BASIC,
+                  workspace.get(),
+                  nullptr) == TCODFOV_E_OK);
+          require_same_fov(fov, expected);
+        }
+      }
+    }
+  }
+  // Tries are kept for the unclipped bounds, so they are shared while walking along an edge or switching radii.
+  for (int step = 0; step < WIDTH + HEIGHT - 1; ++step) {  // Along the top edge, then down the right edge.
+    const int pov_x = std::min(step, WIDTH - 1);
+    const int pov_y = std::max(0, step - (WIDTH - 1));
+    for (int radius : {3, 8, 5, 8, 3, 13, 45}) {
+      const bool light_walls = step % 2 == 0;
+      CAPTURE(step, pov_x, pov_y, radius, light_walls);
+      transparent.set_bool({pov_y, pov_x}, true);
+      auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+      REQUIRE(
+          TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(),
+              expected.get_ptr(),
+              pov_x,
+              pov_y,
+              radius,
+              light_walls,
+              TCODFOV_BASIC,
+              nullptr,
+              nullptr) == TCODFOV_E_OK);
+      auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+      REQUIRE(
+          TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(),
+              fov.get_ptr(),
+              pov_x,
+              pov_y,
+              radius,
+              light_walls,
+              TCODFOV_BASIC,
+              workspace.get(),
+              nullptr) == TCODFOV_E_OK);
+      require_same_fov(fov, expected);
+    }
+  }
+}
+
+TEST_CASE("Small radius FOV on a large map matches a cropped map", "[fov]") {
+  static constexpr int WIDTH = 1000;
+  static constexpr int HEIGHT = 800;
+  static constexpr int RADIUS = 6;
+  static constexpr int CROP = RADIUS * 2 + 5;
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(GENERATE(range(0, static_cast<int>(NB_FOV_ALGORITHMS))));
+  auto transparent = random_map(WIDTH, HEIGHT, 4, 3);
+  for (auto [pov_x, pov_y] : {std::array{500, 400}, std::array{2, 3}, std::array{WIDTH - 1, HEIGHT - 2}}) {
+    CAPTURE(pov_x, pov_y);
+    transparent.set_bool({pov_y, pov_x}, true);
+    const int crop_x = std::clamp(pov_x - CROP / 2, 0, WIDTH - CROP);
+    const int crop_y = std::clamp(pov_y - CROP / 2, 0, HEIGHT - CROP);
+    auto cropped = tcod::fov::Bitpacked2D{{CROP, CROP}};
+    for (int y = 0; y < CROP; ++y) {
+      for (int x = 0; x < CROP; ++x) cropped.set_bool({y, x}, transparent.get_bool({crop_y + y, crop_x + x}));
+    }
+    auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    auto fov_cropped = tcod::fov::Bitpacked2D{{CROP, CROP}};
+    REQUIRE(
+        compute_fov_2d(algorithm, transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, RADIUS, true) == TCODFOV_E_OK);
+    REQUIRE(
+        compute_fov_2d(
+            algorithm, cropped.get_ptr(), fov_cropped.get_ptr(), pov_x - crop_x, pov_y - crop_y, RADIUS, true) ==
+        TCODFOV_E_OK);
+    auto fov_in_crop = tcod::fov::Bitpacked2D{{CROP, CROP}};
+    for (int y = 0; y < CROP; ++y) {
+      for (int x = 0; x < CROP; ++x) fov_in_crop.set_bool({y, x}, fov.get_bool({crop_y + y, crop_x + x}));
+    }
+    require_same_fov(fov_in_crop, fov_cropped);
+  }
+}
+
+TEST_CASE("Shadowcasting with many pending views", "[fov]") {
+  const auto algorithm =
+      static_cast<TCODFOV_fov_algorithm_t>(GENERATE(TCODFOV_SHADOW, TCODFOV_SYMMETRIC_SHADOWCAST));
+  static constexpr int SIZE = 400;
+  static constexpr int POV = SIZE / 2 + 1;
+  // A grid of pillars splits the view at almost every row.
+  auto transparent = tcod::fov::Bitpacked2D{{SIZE, SIZE}};
+  for (int y = 0; y < SIZE; ++y) {
+    for (int x = 0; x < SIZE; ++x) transparent.set_bool({y, x}, x % 3 != 0 || y % 3 != 0);
+  }
+  auto fov_bitpacked = tcod::fov::Bitpacked2D{{SIZE, SIZE}};
+  REQUIRE(
+      compute_fov_2d(algorithm, transparent.get_ptr(), fov_bitpacked.get_ptr(), POV, POV, 0, true) == TCODFOV_E_OK);
+
+  auto fov_callback_data = tcod::fov::Bitpacked2D{{SIZE, SIZE}};
+  const TCODFOV_Map2D transparent_callback = callback_map(transparent);
+  TCODFOV_Map2D fov_callback = callback_map(fov_callback_data);
+  REQUIRE(compute_fov_2d(algorithm, &transparent_callback, &fov_callback, POV, POV, 0, true) == TCODFOV_E_OK);
+  require_same_fov(fov_bitpacked, fov_callback_data);
+}
+
+TEST_CASE("Pascal and triage on tall maps", "[fov]") {
+  static constexpr int WIDTH = 3;
+  static constexpr int HEIGHT = 20000;
+  const auto transparent = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}, true};
+  auto triage = std::vector<uint8_t>(WIDTH * HEIGHT);
+  TCODFOV_Map2D triage_map = bytes_map(triage, WIDTH, HEIGHT);
+  REQUIRE(TCODFOV_triage_2d(transparent.get_ptr(), &triage_map, 1, HEIGHT / 2) == TCODFOV_E_OK);
+  // Both directions are scanned the same way, so the output mirrors around the POV.
+  for (int y = 1; y <= HEIGHT / 2 - 1; ++y) {
+    for (int x = 0; x < WIDTH; ++x) {
+      CAPTURE(x, y);
+      REQUIRE(triage.at((HEIGHT / 2 - y) * WIDTH + x) == triage.at((HEIGHT / 2 + y) * WIDTH + x));
+    }
+  }
+  CHECK(triage.front() != 0);
+  CHECK(triage.back() != 0);
+  auto pascal = std::vector<double>(WIDTH * HEIGHT);
+  TCODFOV_Map2D pascal_map{.contigious{
+      TCODFOV_MAP2D_CONTIGIOUS, {HEIGHT, WIDTH}, reinterpret_cast<uint8_t*>(pascal.data()), TCODFOV_DATATYPE_DOUBLE}};
+  REQUIRE(TCODFOV_pascal_diffusion_2d(transparent.get_ptr(), &pascal_map, 1, HEIGHT / 2) == TCODFOV_E_OK);
+  CHECK(std::ranges::all_of(pascal, [](double value) { return value == 1.0; }));
+}
+
+TEST_CASE("Batch FOV matches single FOV calls", "[fov]") {
+  static constexpr int WIDTH = 60;
+  static constexpr int HEIGHT = 40;
+  static constexpr int COUNT = 200;
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(
+      GENERATE(
+          TCODFOV_BASIC, TCODFOV_DIAMOND, TCODFOV_PERMISSIVE_4, TCODFOV_RESTRICTIVE, TCODFOV_SYMMETRIC_SHADOWCAST));
+  const int thread_count = GENERATE(0, 1, 4);
+  CAPTURE(algorithm, thread_count);
+  auto pool = tcod::fov::ThreadPoolPtr_{thread_count ? TCODFOV_thread_pool_new(thread_count) : nullptr};
+  if (thread_count) REQUIRE(TCODFOV_thread_pool_get_thread_count(pool.get()) == thread_count);
+  const auto copy_map = [](const tcod::fov::Bitpacked2D& map) {
+    auto copy = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    for (int y = 0; y < HEIGHT; ++y) {
+      for (int x = 0; x < WIDTH; ++x) copy.set_bool({y, x}, map.get_bool({y, x}));
+    }
+    return copy;
+  };
+  std::mt19937 rng(15);
+  auto transparent = random_map(WIDTH, HEIGHT, 4, 15);
+  auto pov_x = std::vector<int>(COUNT);
+  auto pov_y = std::vector<int>(COUNT);
+  auto radius = std::vector<int>(COUNT);
+  auto outputs = std::vector<tcod::fov::Bitpacked2D>{};
+  auto fov = std::vector<TCODFOV_Map2D*>{};
+  outputs.reserve(COUNT);
+  for (int i = 0; i < COUNT; ++i) {
+    // Few points-of-view so that many queries are duplicates.
+    pov_x.at(i) = static_cast<int>(rng() % 8) * 7;
+    pov_y.at(i) = static_cast<int>(rng() % 5) * 9;
+    // Basic and diamond FOV light different areas for each negative radius.
+    static constexpr std::array<int, 5> RADII{-2, -1, 0, 5, 10};
+    radius.at(i) = RADII.at(rng() % RADII.size());
+    auto& output = outputs.emplace_back(random_map(WIDTH, HEIGHT, 2, rng()));  // Stale results.
+    fov.emplace_back(output.get_ptr());
+  }
+  auto stale = std::vector<tcod::fov::Bitpacked2D>{};
+  for (const auto& output : outputs) stale.emplace_back(copy_map(output));
+  REQUIRE(
+      TCODFOV_map_compute_fov_batch(
+          transparent.get_ptr(),
+          COUNT,
+          pov_x.data(),
+          pov_y.data(),
+          radius.data(),
+          fov.data(),
+          true,
+          algorithm,
+          pool.get()) == TCODFOV_E_OK);
+  for (int i = 0; i < COUNT; ++i) {
+    CAPTURE(i, pov_x.at(i), pov_y.at(i), radius.at(i));
+    // The batch clears the area a single call could modify before computing, a single call does not clear it.
+    const int r = radius.at(i);
+    const int x_min = r > 0 ? std::max(0, pov_x.at(i) - r) : 0;
+    const int y_min = r > 0 ? std::max(0, pov_y.at(i) - r) : 0;
+    const int x_max = r > 0 ? std::min(WIDTH, pov_x.at(i) + r + 1) : WIDTH;
+    const int y_max = r > 0 ? std::min(HEIGHT, pov_y.at(i) + r + 1) : HEIGHT;
+    auto expected = copy_map(stale.at(i));
+    REQUIRE(
+        TCODFOV_map2d_clear_rect(expected.get_ptr(), {x_min, y_min, x_max - x_min, y_max - y_min}) == TCODFOV_E_OK);
+    REQUIRE(
+        TCODFOV_map_compute_fov_2d(
+            transparent.get_ptr(),
+            expected.get_ptr(),
+            pov_x.at(i),
+            pov_y.at(i),
+            r,
+            true,
+            algorithm,
+            nullptr,
+            nullptr) == TCODFOV_E_OK);
+    require_same_fov(outputs.at(i), expected);
+  }
+
+  // Invalid queries are rejected before any output is modified.
+  auto before = std::vector<tcod::fov::Bitpacked2D>{};
+  for (const auto& output : outputs) before.emplace_back(copy_map(output));
+  pov_x.at(COUNT - 1) = WIDTH;
+  REQUIRE(
+      TCODFOV_map_compute_fov_batch(
+          transparent.get_ptr(),
+          COUNT,
+          pov_x.data(),
+          pov_y.data(),
+          radius.data(),
+          fov.data(),
+          true,
+          algorithm,
+          pool.get()) == TCODFOV_E_INVALID_ARGUMENT);
+  for (int i = 0; i < COUNT; ++i) require_same_fov(outputs.at(i), before.at(i));
+}
+
+TEST_CASE("Parallel single FOV matches serial FOV", "[fov]") {
+  static constexpr int WIDTH = 205;  // Not a multiple of 8 to catch merges of partial bytes.
+  static constexpr int HEIGHT = 143;
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(GENERATE(TCODFOV_SHADOW, TCODFOV_SYMMETRIC_SHADOWCAST));
+  const int max_radius = GENERATE(0, 20, 64, 150, 300);
+  const bool light_walls = GENERATE(false, true);
+  const int thread_count = GENERATE(0, 4);
+  CAPTURE(algorithm, max_radius, light_walls, thread_count);
+  auto pool = tcod::fov::ThreadPoolPtr_{thread_count ? TCODFOV_thread_pool_new(thread_count) : nullptr};
+  auto transparent = random_map(WIDTH, HEIGHT, 16, 17);
+  const std::tuple<int, int> povs[] = {{101, 70}, {0, 0}, {WIDTH - 1, HEIGHT - 1}, {7, 100}, {8, 3}, {150, 0}};
+  for (const auto& [pov_x, pov_y] : povs) {
+    CAPTURE(pov_x, pov_y);
+    transparent.set_bool({pov_y, pov_x}, pov_x != 8);  // Also check an opaque point-of-view.
+    auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    REQUIRE(
+        TCODFOV_map_compute_fov_2d(
+            transparent.get_ptr(),
+            expected.get_ptr(),
+            pov_x,
+            pov_y,
+            max_radius,
+            light_walls,
+            algorithm,
+            nullptr,
+            nullptr) == TCODFOV_E_OK);
+    auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    REQUIRE(
+        TCODFOV_map_compute_fov_parallel(
+            transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, max_radius, light_walls, algorithm, pool.get()) ==
+        TCODFOV_E_OK);
+    // Outputs which are not bitpacked are merged one tile at a time.
+    auto fov_u8 = std::vector<uint8_t>(WIDTH * HEIGHT);
+    TCODFOV_Map2D fov_contigious = bytes_map(fov_u8, WIDTH, HEIGHT);
+    REQUIRE(
+        TCODFOV_map_compute_fov_parallel(
+            transparent.get_ptr(), &fov_contigious, pov_x, pov_y, max_radius, light_walls, algorithm, pool.get()) ==
+        TCODFOV_E_OK);
+    require_same_fov(fov, expected);
+    require_same_fov(&fov_contigious, expected.get_ptr());
+  }
+  auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(
+      TCODFOV_map_compute_fov_parallel(
+          transparent.get_ptr(), fov.get_ptr(), WIDTH, 0, max_radius, light_walls, algorithm, pool.get()) ==
+      TCODFOV_E_INVALID_ARGUMENT);
+}
+
+TEST_CASE("FOV calls on separate threads share an input map", "[fov]") {
+  static constexpr int WIDTH = 64;
+  static constexpr int HEIGHT = 48;
+  static constexpr int THREAD_COUNT = 4;
+  const auto transparent = random_map(WIDTH, HEIGHT, 5, 18);
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(
+      GENERATE(TCODFOV_BASIC, TCODFOV_SHADOW, TCODFOV_RESTRICTIVE, TCODFOV_SYMMETRIC_SHADOWCAST));
+  CAPTURE(algorithm);
+  auto outputs = std::vector<tcod::fov::Bitpacked2D>{};
+  auto errors = std::vector<std::string>(THREAD_COUNT);
+  auto results = std::vector<TCODFOV_Error>(THREAD_COUNT);
+  for (int i = 0; i < THREAD_COUNT; ++i) outputs.emplace_back(tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}});
+  {
+    auto threads = std::vector<std::thread>{};
+    for (int i = 0; i < THREAD_COUNT; ++i) {
+      threads.emplace_back([&, i]() {
+        auto workspace = tcod::fov::WorkspacePtr_{TCODFOV_workspace_new()};
+        for (int pov = 0; pov < 50 && results.at(i) >= 0; ++pov) {
+          results.at(i) = TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(),
+              outputs.at(i).get_ptr(),
+              8 + i * 13,
+              5 + pov % 40,
+              12,
+              true,
+              algorithm,
+              workspace.get(),
+              nullptr);
+        }
+        // Odd threads fail, their messages must not leak into the other threads.
+        if (i % 2) TCODFOV_set_errorf("Thread %i failed.", i);
+        errors.at(i) = TCODFOV_get_error();
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    CAPTURE(i);
+    REQUIRE(results.at(i) == TCODFOV_E_OK);
+    REQUIRE(errors.at(i) == (i % 2 ? "Thread " + std::to_string(i) + " failed." : ""));
+    auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    for (int pov = 0; pov < 50; ++pov) {
+      REQUIRE(
+          TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(),
+              expected.get_ptr(),
+              8 + i * 13,
+              5 + pov % 40,
+              12,
+              true,
+              algorithm,
+              nullptr,
+              nullptr) == TCODFOV_E_OK);
+    }
+    require_same_fov(outputs.at(i), expected);
+  }
+}
+
+TEST_CASE("Legacy map FOV into separate outputs", "[fov]") {
+  static constexpr int WIDTH = 37;
+  static constexpr int HEIGHT = 29;
+  static constexpr int THREAD_COUNT = 4;
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(
+      GENERATE(TCODFOV_BASIC, TCODFOV_SHADOW, TCODFOV_PERMISSIVE_2, TCODFOV_SYMMETRIC_SHADOWCAST));
+  CAPTURE(algorithm);
+  const auto transparent = random_map(WIDTH, HEIGHT, 4, 19);
+  auto map = tcod::fov::MapPtr_{TCODFOV_map_new(WIDTH, HEIGHT)};
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) {
+      TCODFOV_map_set_properties(map.get(), x, y, transparent.get_bool({y, x}), true);
+      TCODFOV_map_set_in_fov(map.get(), x, y, x == y);  // Must be left as it was.
+    }
+  }
+  const TCODFOV_Map* shared_map = map.get();
+  auto outputs = std::vector<tcod::fov::Bitpacked2D>{};
+  auto outputs_u8 = std::vector<std::vector<uint8_t>>(THREAD_COUNT, std::vector<uint8_t>(WIDTH * HEIGHT, 1));
+  auto results = std::vector<TCODFOV_Error>(THREAD_COUNT * 2);
+  for (int i = 0; i < THREAD_COUNT; ++i) outputs.emplace_back(tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}, true});
+  {
+    auto threads = std::vector<std::thread>{};
+    for (int i = 0; i < THREAD_COUNT; ++i) {
+      threads.emplace_back([&, i]() {
+        results.at(i * 2) = TCODFOV_map_compute_fov_into(
+            shared_map, outputs.at(i).get_ptr(), 3 + i * 9, 4 + i * 6, 10, true, algorithm, nullptr, nullptr);
+        TCODFOV_Map2D fov_u8 = bytes_map(outputs_u8.at(i), WIDTH, HEIGHT);
+        results.at(i * 2 + 1) = TCODFOV_map_compute_fov_into(
+            shared_map, &fov_u8, 3 + i * 9, 4 + i * 6, 10, true, algorithm, nullptr, nullptr);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) REQUIRE(TCODFOV_map_is_in_fov(shared_map, x, y) == (x == y));
+  }
+  auto copy = tcod::fov::MapPtr_{TCODFOV_map_new(WIDTH, HEIGHT)};
+  REQUIRE(TCODFOV_map_copy(shared_map, copy.get()) == TCODFOV_E_OK);
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    CAPTURE(i);
+    REQUIRE(results.at(i * 2) == TCODFOV_E_OK);
+    REQUIRE(results.at(i * 2 + 1) == TCODFOV_E_OK);
+    REQUIRE(TCODFOV_map_compute_fov(copy.get(), 3 + i * 9, 4 + i * 6, 10, true, algorithm) == TCODFOV_E_OK);
+    const auto expected = fov_of(copy.get());
+    const TCODFOV_Map2D fov_u8 = bytes_map(outputs_u8.at(i), WIDTH, HEIGHT);
+    require_same_fov(outputs.at(i), expected);
+    require_same_fov(&fov_u8, expected.get_ptr());
+  }
+  auto wrong_size = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH + 1}};
+  REQUIRE(
+      TCODFOV_map_compute_fov_into(shared_map, wrong_size.get_ptr(), 0, 0, 10, true, algorithm, nullptr, nullptr) ==
+      TCODFOV_E_INVALID_ARGUMENT);
+  // Repeated calls clear only the area of the previous call, or advance the epoch.
+  auto bytes = std::vector<uint8_t>(WIDTH * HEIGHT, 1);
+  TCODFOV_Map2D fov_u8 = bytes_map(bytes, WIDTH, HEIGHT);
+  auto fov_epoch = tcod::fov::Map2DPtr{TCODFOV_map2d_new_epoch(WIDTH, HEIGHT)};
+  REQUIRE(fov_epoch);
+  TCODFOV_Rect dirty{0, 0, WIDTH, HEIGHT};
+  for (int pov = 0; pov < 20; ++pov) {
+    const int pov_x = pov * 7 % WIDTH;
+    const int pov_y = pov * 5 % HEIGHT;
+    const int max_radius = pov % 4 == 0 ? 0 : 3 + pov % 7;
+    CAPTURE(pov_x, pov_y, max_radius);
+    REQUIRE(
+        TCODFOV_map_compute_fov_into(shared_map, &fov_u8, pov_x, pov_y, max_radius, true, algorithm, nullptr, &dirty) ==
+        TCODFOV_E_OK);
+    REQUIRE(
+        TCODFOV_map_compute_fov_into(
+            shared_map, fov_epoch.get(), pov_x, pov_y, max_radius, true, algorithm, nullptr, nullptr) == TCODFOV_E_OK);
+    REQUIRE(TCODFOV_map_compute_fov(copy.get(), pov_x, pov_y, max_radius, true, algorithm) == TCODFOV_E_OK);
+    const auto expected = fov_of(copy.get());
+    require_same_fov(&fov_u8, expected.get_ptr());
+    require_same_fov(fov_epoch.get(), expected.get_ptr());
+  }
+}
+
+TEST_CASE("FOV tracker reports the tiles entering and leaving view", "[fov]") {
+  static constexpr int WIDTH = 150;
+  static constexpr int HEIGHT = 90;
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(GENERATE(TCODFOV_SHADOW, TCODFOV_SYMMETRIC_SHADOWCAST));
+  const int max_radius = GENERATE(0, 12, 40);
+  CAPTURE(algorithm, max_radius);
+  std::mt19937 rng(20);
+  auto transparent = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) transparent.set_bool({y, x}, rng() % (x < WIDTH / 2 ? 6 : 300) != 0);
+  }
+  auto tracker = tcod::fov::FovTrackerPtr_{TCODFOV_fov_tracker_new(WIDTH, HEIGHT, max_radius, true, algorithm)};
+  REQUIRE(tracker);
+  auto previous = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  int pov_x = WIDTH / 2;
+  int pov_y = HEIGHT / 2;
+  for (int step = 0; step < 60; ++step) {
+    // Mostly single steps, with a teleport and a map edit without moving.
+    if (step == 30) {
+      pov_x = 3;
+      pov_y = HEIGHT - 2;
+    } else if (step == 45) {
+      transparent.set_bool({pov_y, pov_x + 1}, !transparent.get_bool({pov_y, pov_x + 1}));
+    } else if (step > 0) {
+      pov_x = std::clamp(pov_x + static_cast<int>(rng() % 3) - 1, 0, WIDTH - 1);
+      pov_y = std::clamp(pov_y + static_cast<int>(rng() % 3) - 1, 0, HEIGHT - 1);
+    }
+    CAPTURE(step, pov_x, pov_y);
+    REQUIRE(TCODFOV_fov_tracker_update(tracker.get(), transparent.get_ptr(), pov_x, pov_y) == TCODFOV_E_OK);
+    auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    REQUIRE(
+        TCODFOV_map_compute_fov_2d(
+            transparent.get_ptr(), expected.get_ptr(), pov_x, pov_y, max_radius, true, algorithm, nullptr, nullptr) ==
+        TCODFOV_E_OK);
+    require_same_fov(TCODFOV_fov_tracker_get_fov(tracker.get()), expected.get_ptr());
+    auto expected_entered = std::vector<std::pair<int, int>>{};
+    auto expected_left = std::vector<std::pair<int, int>>{};
+    for (int y = 0; y < HEIGHT; ++y) {
+      for (int x = 0; x < WIDTH; ++x) {
+        if (expected.get_bool({y, x}) && !previous.get_bool({y, x})) expected_entered.emplace_back(x, y);
+        if (!expected.get_bool({y, x}) && previous.get_bool({y, x})) expected_left.emplace_back(x, y);
+        previous.set_bool({y, x}, expected.get_bool({y, x}));
+      }
+    }
+    const auto get_points = [&](auto getter) {
+      const TCODFOV_Point* points = nullptr;
+      const int count = getter(tracker.get(), &points);
+      auto result = std::vector<std::pair<int, int>>{};
+      for (int i = 0; i < count; ++i) result.emplace_back(points[i].x, points[i].y);
+      return result;
+    };
+    // Both are sorted by row then column.
+    REQUIRE(get_points(TCODFOV_fov_tracker_get_entered) == expected_entered);
+    REQUIRE(get_points(TCODFOV_fov_tracker_get_left) == expected_left);
+  }
+  REQUIRE(TCODFOV_fov_tracker_update(tracker.get(), transparent.get_ptr(), WIDTH, 0) == TCODFOV_E_INVALID_ARGUMENT);
+}
+TEST_CASE("Resumable shadowcasting matches a full computation", "[fov]") {
+  static constexpr int WIDTH = 120;
+  static constexpr int HEIGHT = 80;
+  const int max_rows = GENERATE(1, 7, 1000000);
+  const int max_radius = GENERATE(0, 25);
+  const bool light_walls = GENERATE(false, true);
+  CAPTURE(max_rows, max_radius, light_walls);
+  auto transparent = random_map(WIDTH, HEIGHT, 5, 24);
+  auto transparent_bytes = std::vector<uint8_t>(WIDTH * HEIGHT);
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) transparent_bytes.at(y * WIDTH + x) = transparent.get_bool({y, x});
+  }
+  const auto transparent_bytes_map = bytes_map(transparent_bytes, WIDTH, HEIGHT);
+  const std::pair<int, int> povs[] = {{WIDTH / 2, HEIGHT / 2}, {0, 3}, {WIDTH - 1, HEIGHT - 1}};
+  for (const auto& [pov_x, pov_y] : povs) {
+    CAPTURE(pov_x, pov_y);
+    auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    REQUIRE(
+        TCODFOV_map_compute_fov_recursive_shadowcasting(
+            transparent.get_ptr(), expected.get_ptr(), pov_x, pov_y, max_radius, light_walls) == TCODFOV_E_OK);
+    // Bitpacked maps cast rows along the x-axis in runs, byte maps cast every tile.
+    auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    auto fov_bytes = std::vector<uint8_t>(WIDTH * HEIGHT);
+    auto fov_bytes_map = bytes_map(fov_bytes, WIDTH, HEIGHT);
+    auto job = tcod::fov::ResumableFovPtr_{
+        TCODFOV_resumable_fov_new(transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, max_radius, light_walls)};
+    auto job_bytes = tcod::fov::ResumableFovPtr_{
+        TCODFOV_resumable_fov_new(&transparent_bytes_map, &fov_bytes_map, pov_x, pov_y, max_radius, light_walls)};
+    REQUIRE(job);
+    REQUIRE(job_bytes);
+    int steps = 0;
+    while (!TCODFOV_resumable_fov_is_done(job.get())) {
+      REQUIRE(TCODFOV_resumable_fov_step(job.get(), max_rows) == TCODFOV_E_OK);
+      REQUIRE(++steps < 100000);
+    }
+    while (!TCODFOV_resumable_fov_is_done(job_bytes.get())) {
+      REQUIRE(TCODFOV_resumable_fov_step(job_bytes.get(), max_rows) == TCODFOV_E_OK);
+    }
+    if (max_rows == 1) REQUIRE(steps > 8);  // Split into many steps.
+    REQUIRE(TCODFOV_resumable_fov_step(job.get(), max_rows) == TCODFOV_E_OK);  // Steps after the end do nothing.
+    require_same_fov(fov, expected);
+    require_same_fov(&fov_bytes_map, expected.get_ptr());
+  }
+  auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(!TCODFOV_resumable_fov_new(transparent.get_ptr(), fov.get_ptr(), WIDTH, 0, max_radius, light_walls));
+  auto job = tcod::fov::ResumableFovPtr_{
+      TCODFOV_resumable_fov_new(transparent.get_ptr(), fov.get_ptr(), 0, 0, max_radius, light_walls)};
+  REQUIRE(TCODFOV_resumable_fov_step(job.get(), 0) == TCODFOV_E_INVALID_ARGUMENT);
+}
+TEST_CASE("FOV cache matches computed results and drops them when the map changes", "[fov]") {
+  static constexpr int WIDTH = 100;
+  static constexpr int HEIGHT = 70;
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(
+      GENERATE(TCODFOV_SHADOW, TCODFOV_SYMMETRIC_SHADOWCAST, TCODFOV_PERMISSIVE_4));
+  const bool bitpacked_output = GENERATE(false, true);
+  const size_t max_bytes = GENERATE(size_t{1200}, size_t{1} << 20);
+  CAPTURE(algorithm, bitpacked_output, max_bytes);
+  std::mt19937 rng(25);
+  auto transparent = random_map(WIDTH, HEIGHT, 6, 25);
+  auto cache = tcod::fov::FovCachePtr_{TCODFOV_fov_cache_new(WIDTH, HEIGHT, max_bytes)};
+  REQUIRE(cache);
+  auto workspace = tcod::fov::WorkspacePtr_{TCODFOV_workspace_new()};
+  // Output tiles outside of the radius are left as they were, so start with a different value in each.
+  auto fov_packed = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  auto fov_bytes = std::vector<uint8_t>(WIDTH * HEIGHT);
+  auto fov_bytes_map = bytes_map(fov_bytes, WIDTH, HEIGHT);
+  TCODFOV_Map2D* fov = bitpacked_output ? fov_packed.get_ptr() : &fov_bytes_map;
+  struct Guard {
+    int x;
+    int y;
+    int radius;
+  };
+  std::vector<Guard> guards;
+  for (int i = 0; i < 12; ++i) {
+    const int x = static_cast<int>(rng() % WIDTH);
+    const int y = static_cast<int>(rng() % HEIGHT);
+    guards.push_back({x, y, static_cast<int>(rng() % 12)});
+  }
+  for (int tick = 0; tick < 40; ++tick) {
+    if (tick % 5 == 4) {  // Open or close a few tiles.
+      TCODFOV_Point changed[2];
+      for (auto& point : changed) {
+        point = {static_cast<int>(rng() % WIDTH), static_cast<int>(rng() % HEIGHT)};
+        transparent.set_bool({point.y, point.x}, !transparent.get_bool({point.y, point.x}));
+      }
+      REQUIRE(TCODFOV_fov_cache_mark_changed(cache.get(), 2, changed) == TCODFOV_E_OK);
+    }
+    if (tick == 20) guards.at(0).x = (guards.at(0).x + 1) % WIDTH;
+    for (const auto& guard : guards) {
+      CAPTURE(tick, guard.x, guard.y, guard.radius);
+      for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) TCODFOV_map2d_set_bool(fov, x, y, (x + y + tick) % 3 == 0);
+      }
+      TCODFOV_Rect dirty{};
+      REQUIRE(
+          TCODFOV_fov_cache_compute(
+              cache.get(),
+              transparent.get_ptr(),
+              fov,
+              guard.x,
+              guard.y,
+              guard.radius,
+              true,
+              algorithm,
+              workspace.get(),
+              &dirty) == TCODFOV_E_OK);
+      // Tiles outside of the dirty area keep their old values.
+      auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+      for (int y = 0; y < HEIGHT; ++y) {
+        for (int x = 0; x < WIDTH; ++x) expected.set_bool({y, x}, (x + y + tick) % 3 == 0);
+      }
+      REQUIRE(TCODFOV_map2d_clear_rect(expected.get_ptr(), dirty) == TCODFOV_E_OK);
+      REQUIRE(
+          TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(),
+              expected.get_ptr(),
+              guard.x,
+              guard.y,
+              guard.radius,
+              true,
+              algorithm,
+              nullptr,
+              nullptr) == TCODFOV_E_OK);
+      require_same_fov(fov, expected.get_ptr());
+    }
+    REQUIRE(TCODFOV_fov_cache_get_stats(cache.get()).bytes <= max_bytes);
+  }
+  const TCODFOV_FovCacheStats stats = TCODFOV_fov_cache_get_stats(cache.get());
+  REQUIRE(stats.hits + stats.misses == 40 * 12);
+  if (max_bytes > 1200) {
+    REQUIRE(stats.hits > stats.misses * 4);  // Standing guards are only recomputed after nearby edits.
+    REQUIRE(stats.evictions == 0);
+    REQUIRE(stats.invalidations > 0);
+  } else {
+    REQUIRE(stats.evictions > 0);
+  }
+  TCODFOV_fov_cache_clear(cache.get());
+  REQUIRE(TCODFOV_fov_cache_get_stats(cache.get()).count == 0);
+  REQUIRE(TCODFOV_fov_cache_get_stats(cache.get()).bytes == 0);
+  const TCODFOV_Point out_of_bounds{WIDTH, 0};
+  REQUIRE(TCODFOV_fov_cache_mark_changed(cache.get(), 1, &out_of_bounds) == TCODFOV_E_INVALID_ARGUMENT);
+  REQUIRE(
+      TCODFOV_fov_cache_compute(
+          cache.get(), transparent.get_ptr(), fov, WIDTH, 0, 5, true, algorithm, nullptr, nullptr) ==
+      TCODFOV_E_INVALID_ARGUMENT);
+}
+TEST_CASE("Repaired symmetric shadowcasting matches a full recompute", "[fov]") {
+  static constexpr int WIDTH = 120;
+  static constexpr int HEIGHT = 80;
+  const int max_radius = GENERATE(0, 10, 40);
+  const bool light_walls = GENERATE(false, true);
+  CAPTURE(max_radius, light_walls);
+  std::mt19937 rng(21);
+  auto transparent = random_map(WIDTH, HEIGHT, 5, 21);
+  const int pov_x = WIDTH / 2;
+  const int pov_y = HEIGHT / 2;
+  auto fov = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(
+      TCODFOV_map_compute_fov_symmetric_shadowcast(
+          transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, max_radius, light_walls) == TCODFOV_E_OK);
+  for (int step = 0; step < 40; ++step) {
+    // Single doors on and off the diagonals, clouds of nearby tiles, and the point-of-view itself.
+    auto changed = std::vector<TCODFOV_Point>{};
+    if (step % 10 == 0) {
+      changed.push_back({pov_x, pov_y});
+    } else if (step % 3 == 0) {
+      const int center_x = static_cast<int>(rng() % WIDTH);
+      const int center_y = static_cast<int>(rng() % HEIGHT);
+      for (int i = 0; i < 12; ++i) {
+        changed.push_back(
+            {std::clamp(center_x + static_cast<int>(rng() % 5) - 2, 0, WIDTH - 1),
+             std::clamp(center_y + static_cast<int>(rng() % 5) - 2, 0, HEIGHT - 1)});
+      }
+    } else if (step % 2 == 0) {
+      const int distance = 1 + static_cast<int>(rng() % 30);
+      changed.push_back({pov_x + (rng() % 2 ? distance : -distance), pov_y + (rng() % 2 ? distance : -distance)});
+    } else {
+      changed.push_back({static_cast<int>(rng() % WIDTH), static_cast<int>(rng() % HEIGHT)});
+    }
+    for (const auto& point : changed) {
+      transparent.set_bool({point.y, point.x}, !transparent.get_bool({point.y, point.x}));
+    }
+    CAPTURE(step, changed.size(), changed.at(0).x, changed.at(0).y);
+    REQUIRE(
+        TCODFOV_map_repair_fov_symmetric_shadowcast(
+            transparent.get_ptr(),
+            fov.get_ptr(),
+            pov_x,
+            pov_y,
+            max_radius,
+            light_walls,
+            static_cast<int>(changed.size()),
+            changed.data()) == TCODFOV_E_OK);
+    auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    REQUIRE(
+        TCODFOV_map_compute_fov_symmetric_shadowcast(
+            transparent.get_ptr(), expected.get_ptr(), pov_x, pov_y, max_radius, light_walls) == TCODFOV_E_OK);
+    require_same_fov(fov, expected);
+  }
+  const TCODFOV_Point out_of_bounds = {WIDTH, 0};
+  REQUIRE(
+      TCODFOV_map_repair_fov_symmetric_shadowcast(
+          transparent.get_ptr(), fov.get_ptr(), pov_x, pov_y, max_radius, light_walls, 1, &out_of_bounds) ==
+      TCODFOV_E_INVALID_ARGUMENT);
+}
+
+/// @brief Return a `width` by `height` map holding `fov` placed at `window` with every other tile unset.
+static auto uncrop_fov(const TCODFOV_Map2D* fov, const TCODFOV_Rect& window, int width, int height)
+    -> tcod::fov::Bitpacked2D {
+  tcod::fov::Bitpacked2D result{{height, width}};
+  for (int y = 0; y < window.height; ++y) {
+    for (int x = 0; x < window.width; ++x) {
+      result.set_bool({window.y + y, window.x + x}, TCODFOV_map2d_get_bool(fov, x, y));
+    }
+  }
+  return result;
+}
+
+TEST_CASE("Visibility system recomputes only the viewers near changed tiles", "[fov]") {
+  static constexpr int WIDTH = 100;
+  static constexpr int HEIGHT = 70;
+  struct TestViewer {
+    int index;
+    int pov_x;
+    int pov_y;
+    int radius;
+  };
+  const auto algorithm = static_cast<TCODFOV_fov_algorithm_t>(GENERATE(TCODFOV_SHADOW, TCODFOV_SYMMETRIC_SHADOWCAST));
+  const int thread_count = GENERATE(0, 2);
+  CAPTURE(algorithm, thread_count);
+  auto pool = tcod::fov::ThreadPoolPtr_{thread_count ? TCODFOV_thread_pool_new(thread_count) : nullptr};
+  auto visibility = tcod::fov::VisibilityPtr_{TCODFOV_visibility_new(WIDTH, HEIGHT, true, algorithm)};
+  REQUIRE(visibility);
+  TCODFOV_Map2D* map = TCODFOV_visibility_get_map(visibility.get());
+  std::mt19937 rng(22);
+  const auto initial = random_map(WIDTH, HEIGHT, 5, 22);
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) TCODFOV_map2d_set_bool(map, x, y, initial.get_bool({y, x}));
+  }
+  auto viewers = std::vector<TestViewer>{};
+  for (int i = 0; i < 60; ++i) {
+    TestViewer viewer{
+        -1,
+        static_cast<int>(rng() % WIDTH),
+        static_cast<int>(rng() % HEIGHT),
+        i == 0 ? 0 : 3 + static_cast<int>(rng() % 12)};
+    viewer.index = TCODFOV_visibility_add_viewer(visibility.get(), viewer.pov_x, viewer.pov_y, viewer.radius);
+    REQUIRE(viewer.index >= 0);
+    viewers.push_back(viewer);
+  }
+  REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == 60);
+  const auto check_viewers = [&]() {
+    REQUIRE(TCODFOV_visibility_update(visibility.get(), pool.get()) == TCODFOV_E_OK);
+    REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == 0);
+    auto transparent = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+    for (int y = 0; y < HEIGHT; ++y) {
+      for (int x = 0; x < WIDTH; ++x) transparent.set_bool({y, x}, TCODFOV_map2d_get_bool(map, x, y));
+    }
+    for (const auto& viewer : viewers) {
+      CAPTURE(viewer.index, viewer.pov_x, viewer.pov_y, viewer.radius);
+      TCODFOV_Rect window{};
+      const TCODFOV_Map2D* fov = TCODFOV_visibility_get_fov(visibility.get(), viewer.index, &window);
+      REQUIRE(fov);
+      auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+      REQUIRE(
+          TCODFOV_map_compute_fov_2d(
+              transparent.get_ptr(),
+              expected.get_ptr(),
+              viewer.pov_x,
+              viewer.pov_y,
+              viewer.radius,
+              true,
+              algorithm,
+              nullptr,
+              nullptr) == TCODFOV_E_OK);
+      require_same_fov(uncrop_fov(fov, window, WIDTH, HEIGHT), expected);
+    }
+  };
+  const auto count_covering = [&](const std::vector<TCODFOV_Point>& points) {
+    int count = 0;
+    for (const auto& viewer : viewers) {
+      for (const auto& point : points) {
+        if (viewer.radius == 0 ||
+            (std::abs(point.x - viewer.pov_x) <= viewer.radius && std::abs(point.y - viewer.pov_y) <= viewer.radius)) {
+          ++count;
+          break;
+        }
+      }
+    }
+    return count;
+  };
+  check_viewers();
+  for (int step = 0; step < 20; ++step) {
+    CAPTURE(step);
+    const TCODFOV_Point point{static_cast<int>(rng() % WIDTH), static_cast<int>(rng() % HEIGHT)};
+    // Setting a tile to its current value changes nothing.
+    TCODFOV_map2d_set_bool(map, point.x, point.y, TCODFOV_map2d_get_bool(map, point.x, point.y));
+    REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == 0);
+    if (step % 2) {
+      TCODFOV_map2d_set_bool(map, point.x, point.y, !TCODFOV_map2d_get_bool(map, point.x, point.y));
+      REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == count_covering({point}));
+    } else {
+      const auto points = std::vector<TCODFOV_Point>{point, {(point.x + 7) % WIDTH, point.y}};
+      const bool values[] = {
+          !TCODFOV_map2d_get_bool(map, points[0].x, points[0].y),
+          !TCODFOV_map2d_get_bool(map, points[1].x, points[1].y)};
+      REQUIRE(TCODFOV_visibility_set_tiles(visibility.get(), 2, points.data(), values) == TCODFOV_E_OK);
+      REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == count_covering(points));
+    }
+    if (step % 5 == 0) {
+      auto& moved = viewers.at(rng() % viewers.size());
+      moved.pov_x = static_cast<int>(rng() % WIDTH);
+      moved.pov_y = static_cast<int>(rng() % HEIGHT);
+      REQUIRE(TCODFOV_visibility_move_viewer(visibility.get(), moved.index, moved.pov_x, moved.pov_y) == TCODFOV_E_OK);
+    }
+    if (step % 7 == 0) {
+      const int removed = viewers.back().index;
+      viewers.pop_back();
+      REQUIRE(TCODFOV_visibility_remove_viewer(visibility.get(), removed) == TCODFOV_E_OK);
+      REQUIRE(TCODFOV_visibility_get_fov(visibility.get(), removed, nullptr) == nullptr);
+      // The freed index is reused.
+      TestViewer added{-1, static_cast<int>(rng() % WIDTH), static_cast<int>(rng() % HEIGHT), 6};
+      added.index = TCODFOV_visibility_add_viewer(visibility.get(), added.pov_x, added.pov_y, added.radius);
+      REQUIRE(added.index == removed);
+      viewers.push_back(added);
+    }
+    check_viewers();
+  }
+  REQUIRE(TCODFOV_visibility_add_viewer(visibility.get(), WIDTH, 0, 5) == TCODFOV_E_INVALID_ARGUMENT);
+  REQUIRE(TCODFOV_visibility_move_viewer(visibility.get(), 1000, 0, 0) == TCODFOV_E_INVALID_ARGUMENT);
+}
+
+TEST_CASE("Budgeted visibility updates run viewers by priority", "[fov]") {
+  static constexpr int WIDTH = 60;
+  static constexpr int HEIGHT = 40;
+  auto visibility =
+      tcod::fov::VisibilityPtr_{TCODFOV_visibility_new(WIDTH, HEIGHT, true, TCODFOV_SYMMETRIC_SHADOWCAST)};
+  REQUIRE(visibility);
+  TCODFOV_Map2D* map = TCODFOV_visibility_get_map(visibility.get());
+  const auto initial = random_map(WIDTH, HEIGHT, 6, 23);
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) TCODFOV_map2d_set_bool(map, x, y, initial.get_bool({y, x}));
+  }
+  auto viewers = std::vector<int>{};
+  for (int i = 0; i < 6; ++i) {
+    viewers.push_back(TCODFOV_visibility_add_viewer(visibility.get(), 10 + i * 8, HEIGHT / 2, 8));
+    REQUIRE(viewers.back() >= 0);
+  }
+  REQUIRE(TCODFOV_visibility_set_priority(visibility.get(), viewers.at(4), 10) == TCODFOV_E_OK);
+  REQUIRE(TCODFOV_visibility_set_priority(visibility.get(), viewers.at(2), 5) == TCODFOV_E_OK);
+  // A zero budget computes one viewer per update, the highest priority first and then the oldest.
+  const int expected_order[] = {4, 2, 0, 1, 3, 5};
+  for (int update = 0; update < 6; ++update) {
+    CAPTURE(update);
+    REQUIRE(TCODFOV_visibility_update_budget(visibility.get(), 0) == TCODFOV_E_OK);
+    REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == 5 - update);
+    for (int i = 0; i < 6; ++i) {
+      CAPTURE(i);
+      bool computed = false;
+      for (int j = 0; j <= update; ++j) computed = computed || expected_order[j] == i;
+      REQUIRE(TCODFOV_visibility_get_staleness(visibility.get(), viewers.at(i)) == (computed ? 0 : update + 1));
+    }
+  }
+  // Moved viewers are dirty again until an update computes them, a large budget computes all of them.
+  REQUIRE(TCODFOV_visibility_move_viewer(visibility.get(), viewers.at(0), 5, 5) == TCODFOV_E_OK);
+  REQUIRE(TCODFOV_visibility_update_budget(visibility.get(), 0) == TCODFOV_E_OK);
+  REQUIRE(TCODFOV_visibility_move_viewer(visibility.get(), viewers.at(1), 6, 6) == TCODFOV_E_OK);
+  REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == 1);
+  REQUIRE(TCODFOV_visibility_update_budget(visibility.get(), 1000000) == TCODFOV_E_OK);
+  REQUIRE(TCODFOV_visibility_get_dirty_count(visibility.get()) == 0);
+  auto transparent = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  for (int y = 0; y < HEIGHT; ++y) {
+    for (int x = 0; x < WIDTH; ++x) transparent.set_bool({y, x}, TCODFOV_map2d_get_bool(map, x, y));
+  }
+  auto expected = tcod::fov::Bitpacked2D{{HEIGHT, WIDTH}};
+  REQUIRE(
+      TCODFOV_map_compute_fov_symmetric_shadowcast(transparent.get_ptr(), expected.get_ptr(), 6, 6, 8, true) ==
+      TCODFOV_E_OK);
+  TCODFOV_Rect window{};
+  const TCODFOV_Map2D* fov = TCODFOV_visibility_get_fov(visibility.get(), viewers.at(1), &window);
+  REQUIRE(fov);
+  require_same_fov(uncrop_fov(fov, window, WIDTH, HEIGHT), expected);
+  REQUIRE(TCODFOV_visibility_get_staleness(visibility.get(), 1000) == TCODFOV_E_INVALID_ARGUMENT);
+}